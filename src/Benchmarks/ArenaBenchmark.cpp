@@ -0,0 +1,124 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <stdio.h>
+
+#include <QtConcurrent/QtConcurrent>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+
+#include "Benchmarks/Benchmarks.h"
+#include "Misc/TempFolder.h"
+#include "Misc/Utility.h"
+#include "Parsers/GumboInterface.h"
+
+static const QStringList CHAPTER_SUFFIXES = QStringList() << "xhtml" << "html" << "htm";
+
+
+static QStringList ReadChapters(const QString &folderpath)
+{
+    QStringList texts;
+    QDirIterator it(folderpath, QDir::Files | QDir::NoDotAndDotDot | QDir::Readable, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        if (CHAPTER_SUFFIXES.contains(it.fileInfo().suffix().toLower())) {
+            texts.append(Utility::ReadUnicodeTextFile(it.filePath()));
+        }
+    }
+    return texts;
+}
+
+
+// Parses the text and tears the tree down again, the way the
+// importers, reports and checks go through a book's chapters.
+static void ParseAndDestroy(const QString &text)
+{
+    GumboInterface gi(text, "3.0");
+    gi.parse();
+}
+
+
+int RunArenaBenchmark(const QStringList &args, bool use_arena)
+{
+    if (args.isEmpty() || !QFileInfo::exists(args.at(0))) {
+        fprintf(stderr, "sigil-benchmarks arena needs a folder of chapters or an epub\n");
+        return 1;
+    }
+    int runs = (args.count() > 1) ? qMax(1, args.at(1).toInt()) : 5;
+
+    QStringList texts;
+    if (QFileInfo(args.at(0)).isDir()) {
+        texts = ReadChapters(args.at(0));
+    } else {
+        TempFolder tempfolder;
+        if (!Utility::UnZip(args.at(0), tempfolder.GetPath())) {
+            fprintf(stderr, "can not unzip %s\n", qPrintable(args.at(0)));
+            return 1;
+        }
+        texts = ReadChapters(tempfolder.GetPath());
+    }
+    if (texts.isEmpty()) {
+        fprintf(stderr, "no xhtml or html files found\n");
+        return 1;
+    }
+    qint64 total_chars = 0;
+    foreach(const QString &text, texts) {
+        total_chars += text.length();
+    }
+
+    // warm up, so the arena blocks and the heap are in their steady state
+    foreach(const QString &text, texts) {
+        ParseAndDestroy(text);
+    }
+
+    double parse_ms = 1e12, destroy_ms = 1e12, parallel_ms = 1e12;
+    for (int run = 0; run < runs; ++run) {
+        double run_parse_ms = 0;
+        double run_destroy_ms = 0;
+        foreach(const QString &text, texts) {
+            GumboInterface *gi = new GumboInterface(text, "3.0");
+            qint64 start = NowNs();
+            gi->parse();
+            run_parse_ms += ElapsedMs(start);
+            start = NowNs();
+            delete gi;
+            run_destroy_ms += ElapsedMs(start);
+        }
+        parse_ms = qMin(parse_ms, run_parse_ms);
+        destroy_ms = qMin(destroy_ms, run_destroy_ms);
+
+        qint64 start = NowNs();
+        QtConcurrent::blockingMap(texts, ParseAndDestroy);
+        parallel_ms = qMin(parallel_ms, ElapsedMs(start));
+    }
+
+    // Peak RSS covers the whole process, compare it between a run
+    // with and one without --no-arena on the same chapters.
+    printf("%d chapters, %.2f M characters, best of %d runs, gumbo allocating from %s\n",
+           texts.count(), total_chars / 1048576.0, runs, use_arena ? "the arena" : "the heap (--no-arena)");
+    printf("  one thread:  parse %9.1f ms  destroy %8.1f ms\n", parse_ms, destroy_ms);
+    printf("  %2d threads:  parse and destroy %9.1f ms\n", QThreadPool::globalInstance()->maxThreadCount(), parallel_ms);
+    printf("  peak RSS:    %lld KB\n", (long long)PeakResidentKB());
+    return 0;
+}
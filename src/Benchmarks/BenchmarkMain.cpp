@@ -0,0 +1,161 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+
+#include "Benchmarks/Benchmarks.h"
+#include "EmbedPython/EmbeddedPython.h"
+#include "MainUI/MainApplication.h"
+#include "Misc/PluginDB.h"
+#include "Parsers/GumboArena.h"
+
+static const char *USAGE =
+    "usage: sigil-benchmarks replace [kilobytes ...]\n"
+    "       sigil-benchmarks export <book.epub> [runs]\n"
+    "       sigil-benchmarks arena <chapters folder or epub> [runs] [--no-arena]\n";
+
+
+qint64 NowNs()
+{
+    static QElapsedTimer clock;
+    if (!clock.isValid()) {
+        clock.start();
+    }
+    return clock.nsecsElapsed();
+}
+
+
+double ElapsedMs(qint64 start_ns)
+{
+    return (NowNs() - start_ns) / 1000000.0;
+}
+
+
+std::pair<qint64, qint64> ProcessIOBytes()
+{
+    qint64 read = -1;
+    qint64 written = -1;
+    QFile io("/proc/self/io");
+    if (io.open(QIODevice::ReadOnly)) {
+        // rchar and wchar count every byte passed through read() and write(),
+        // whether it hit the disk or only the page cache
+        foreach(QByteArray line, io.readAll().split('\n')) {
+            if (line.startsWith("rchar:")) {
+                read = line.mid(6).trimmed().toLongLong();
+            } else if (line.startsWith("wchar:")) {
+                written = line.mid(6).trimmed().toLongLong();
+            }
+        }
+    }
+    return std::make_pair(read, written);
+}
+
+
+qint64 PeakResidentKB()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize / 1024;
+    }
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#if defined(__APPLE__)
+    // macOS reports it in bytes
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fputs(USAGE, stderr);
+        return 1;
+    }
+
+    // As in Sigil itself, before gumbo allocates anything. "--no-arena"
+    // leaves gumbo on malloc and free for the figures to compare against.
+    bool use_arena = true;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--no-arena") == 0) {
+            use_arena = false;
+        }
+    }
+    if (use_arena) {
+        GumboArena::InstallAllocator();
+    }
+
+    QCoreApplication::setOrganizationName("sigil-ebook");
+    QCoreApplication::setOrganizationDomain("sigil-ebook.com");
+    QCoreApplication::setApplicationName("sigil");
+
+    // no windows are shown, and as in Sigil the QRegularExpression JIT stays off
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    qputenv("QT_ENABLE_REGEXP_JIT", "0");
+
+    MainApplication app(argc, argv);
+
+    // the import and export clean up the xhtml in the embedded python
+    EmbeddedPython::instance().addToPythonSysPath(EmbeddedPython::instance().embeddedRoot());
+    EmbeddedPython::instance().addToPythonSysPath(PluginDB::launcherRoot() + "/python");
+
+    QStringList args = app.arguments().mid(1);
+    args.removeAll("--no-arena");
+    QString benchmark = args.isEmpty() ? QString() : args.takeFirst();
+
+    if (benchmark == "replace") {
+        return RunReplaceBenchmark(args);
+    }
+    if (benchmark == "export") {
+        return RunExportBenchmark(args);
+    }
+    if (benchmark == "arena") {
+        return RunArenaBenchmark(args, use_arena);
+    }
+    fputs(USAGE, stderr);
+    return 1;
+}
@@ -0,0 +1,56 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <utility>
+
+#include <QtCore/QStringList>
+
+// Developer benchmarks for the hot paths that were rewritten for speed,
+// built as sigil-benchmarks when configured with -DBUILD_BENCHMARKS=1.
+// Every run prints the figures of the current code next to those of the
+// code it replaced (for the gumbo arena the heap figures come from a second
+// run with --no-arena), so changes to these paths can be measured again.
+//
+//   sigil-benchmarks replace [kilobytes ...]
+//   sigil-benchmarks export <book.epub> [runs]
+//   sigil-benchmarks arena <chapters folder or epub> [runs] [--no-arena]
+
+int RunReplaceBenchmark(const QStringList &args);
+int RunExportBenchmark(const QStringList &args);
+int RunArenaBenchmark(const QStringList &args, bool use_arena);
+
+// a monotonic clock in nanoseconds, and the milliseconds since start_ns
+qint64 NowNs();
+double ElapsedMs(qint64 start_ns);
+
+// the peak resident set size of the process in kilobytes
+qint64 PeakResidentKB();
+
+// bytes read and written by the process so far, -1 where
+// the platform does not report them (only Linux does)
+std::pair<qint64, qint64> ProcessIOBytes();
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,302 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zip.h>
+#include <unzip.h>
+#ifdef _WIN32
+#include <iowin32.h>
+#endif
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QThreadPool>
+
+#include "Benchmarks/Benchmarks.h"
+#include "BookManipulation/Book.h"
+#include "BookManipulation/FolderKeeper.h"
+#include "Exporters/EncryptionXmlWriter.h"
+#include "Exporters/ExportEPUB.h"
+#include "Importers/ImportEPUB.h"
+#include "Misc/FontObfuscation.h"
+#include "Misc/TempFolder.h"
+#include "Misc/Utility.h"
+#include "ResourceObjects/FontResource.h"
+#include "ResourceObjects/OPFResource.h"
+#include "sigil_constants.h"
+
+#ifndef MAX_PATH
+// Set Max length to 256 because that's the max path size on many systems.
+#define MAX_PATH 256
+#endif
+
+#define BUFF_SIZE 8192
+
+static const char *EPUB_MIME_DATA = "application/epub+zip";
+
+struct ExportFigures {
+    double ms;
+    qint64 read;
+    qint64 written;
+    qint64 size;
+};
+
+
+static zipFile OpenZip(const QString &path)
+{
+#ifdef Q_OS_WIN32
+    zlib_filefunc64_def ffunc;
+    fill_win32_filefunc64W(&ffunc);
+    return zipOpen2_64(Utility::QStringToStdWString(QDir::toNativeSeparators(path)).c_str(), APPEND_STATUS_CREATE, NULL, &ffunc);
+#else
+    return zipOpen64(QDir::toNativeSeparators(path).toUtf8().constData(), APPEND_STATUS_CREATE);
+#endif
+}
+
+
+static unzFile OpenUnzip(const QString &path)
+{
+#ifdef Q_OS_WIN32
+    zlib_filefunc64_def ffunc;
+    fill_win32_filefunc64W(&ffunc);
+    return unzOpen2_64(Utility::QStringToStdWString(QDir::toNativeSeparators(path)).c_str(), &ffunc);
+#else
+    return unzOpen64(QDir::toNativeSeparators(path).toUtf8().constData());
+#endif
+}
+
+
+static void SetZipDate(zip_fileinfo &fileInfo, const QDateTime &date)
+{
+    memset(&fileInfo, 0, sizeof(fileInfo));
+    fileInfo.tmz_date.tm_sec  = date.time().second();
+    fileInfo.tmz_date.tm_min  = date.time().minute();
+    fileInfo.tmz_date.tm_hour = date.time().hour();
+    fileInfo.tmz_date.tm_mday = date.date().day();
+    fileInfo.tmz_date.tm_mon  = date.date().month() - 1;
+    fileInfo.tmz_date.tm_year = date.date().year();
+}
+
+
+// The export as it was before: the book folder was copied into a TempFolder,
+// fonts were obfuscated and encryption.xml written there, everything was
+// deflated on one thread into a temp epub, which was then copied over the
+// destination 8 KB at a time.
+static bool OldWriteBook(QSharedPointer<Book> book, const QString &fullfilepath)
+{
+    TempFolder tempfolder;
+    QString fullfolderpath = tempfolder.GetPath();
+    Utility::CopyFiles(book->GetFolderKeeper()->GetFullPathToMainFolder(), fullfolderpath);
+
+    if (book->HasObfuscatedFonts()) {
+        QFile encryption(fullfolderpath + "/META-INF/encryption.xml");
+        if (!encryption.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return false;
+        }
+        EncryptionXmlWriter enc(book.data(), encryption);
+        enc.WriteXML();
+        encryption.close();
+
+        QString uuid_id = book->GetOPF()->GetUUIDIdentifierValue();
+        QString main_id = book->GetPublicationIdentifier();
+        foreach(FontResource *font_resource, book->GetFolderKeeper()->GetResourceTypeList<FontResource>()) {
+            QString algorithm = font_resource->GetObfuscationAlgorithm();
+            if (algorithm.isEmpty()) {
+                continue;
+            }
+            FontObfuscation::ObfuscateFile(fullfolderpath + "/" + font_resource->GetRelativePath(), algorithm,
+                                           algorithm == ADOBE_FONT_ALGO_ID ? uuid_id : main_id);
+        }
+    }
+
+    QString tempFile = fullfolderpath + "-tmp.epub";
+    zipFile zfile = OpenZip(tempFile);
+    if (zfile == NULL) {
+        return false;
+    }
+    zip_fileinfo fileInfo;
+    SetZipDate(fileInfo, QDateTime::currentDateTime());
+    zipOpenNewFileInZip64(zfile, "mimetype", &fileInfo, NULL, 0, NULL, 0, NULL, Z_NO_COMPRESSION, 0, 0);
+    zipWriteInFileInZip(zfile, EPUB_MIME_DATA, (unsigned int)strlen(EPUB_MIME_DATA));
+    zipCloseFileInZip(zfile);
+
+    bool ok = true;
+    char buff[BUFF_SIZE] = {0};
+    QDirIterator it(fullfolderpath, QDir::Files | QDir::NoDotAndDotDot | QDir::Readable | QDir::Hidden, QDirIterator::Subdirectories);
+    while (ok && it.hasNext()) {
+        it.next();
+        QString relpath = it.filePath().remove(fullfolderpath);
+        while (relpath.startsWith("/")) {
+            relpath = relpath.remove(0, 1);
+        }
+        if (relpath == "mimetype") continue;
+
+        // the checksum was read for the saved date bookkeeping
+        Utility::FileCRC32(it.filePath());
+        SetZipDate(fileInfo, QFileInfo(it.filePath()).lastModified());
+        QFile dfile(it.filePath());
+        if (!dfile.open(QIODevice::ReadOnly) ||
+            (zipOpenNewFileInZip4_64(zfile, relpath.toUtf8().constData(), &fileInfo, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 8, 0, 15, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 1<<11, 0) != ZIP_OK)) {
+            ok = false;
+            break;
+        }
+        qint64 read = 0;
+        while ((read = dfile.read(buff, BUFF_SIZE)) > 0) {
+            if (zipWriteInFileInZip(zfile, buff, read) != ZIP_OK) {
+                ok = false;
+                break;
+            }
+        }
+        ok = ok && (read == 0) && (zipCloseFileInZip(zfile) == ZIP_OK);
+    }
+    zipClose(zfile, NULL);
+
+    QFile temp_epub(tempFile);
+    QFile real_epub(fullfilepath);
+    if (ok && temp_epub.open(QFile::ReadOnly) && real_epub.open(QFile::WriteOnly | QFile::Truncate)) {
+        qint64 read = 0;
+        while ((read = temp_epub.read(buff, BUFF_SIZE)) > 0) {
+            if (real_epub.write(buff, read) != read) {
+                ok = false;
+                break;
+            }
+        }
+    } else {
+        ok = false;
+    }
+    temp_epub.close();
+    real_epub.close();
+    QFile::remove(tempFile);
+    return ok;
+}
+
+
+// Entry names with the checksum and size of their uncompressed data
+static QHash<QString, std::pair<quint32, quint64> > ReadEntries(const QString &zippath)
+{
+    QHash<QString, std::pair<quint32, quint64> > entries;
+    unzFile zfile = OpenUnzip(zippath);
+    if (zfile == NULL) {
+        return entries;
+    }
+    int res = unzGoToFirstFile(zfile);
+    while (res == UNZ_OK) {
+        char file_name[MAX_PATH] = {0};
+        unz_file_info64 file_info;
+        if (unzGetCurrentFileInfo64(zfile, &file_info, file_name, MAX_PATH, NULL, 0, NULL, 0) == UNZ_OK) {
+            entries.insert(QString::fromUtf8(file_name), std::make_pair((quint32)file_info.crc, (quint64)file_info.uncompressed_size));
+        }
+        res = unzGoToNextFile(zfile);
+    }
+    unzClose(zfile);
+    return entries;
+}
+
+
+template <typename Export>
+static ExportFigures Measure(int runs, const QString &destination, Export run_export)
+{
+    ExportFigures best = { 1e12, -1, -1, 0 };
+    for (int run = 0; run < runs; ++run) {
+        std::pair<qint64, qint64> io_before = ProcessIOBytes();
+        qint64 start = NowNs();
+        run_export();
+        double ms = ElapsedMs(start);
+        std::pair<qint64, qint64> io_after = ProcessIOBytes();
+        if (ms < best.ms) {
+            best.ms = ms;
+            best.read = (io_before.first < 0) ? -1 : io_after.first - io_before.first;
+            best.written = (io_before.second < 0) ? -1 : io_after.second - io_before.second;
+        }
+    }
+    best.size = QFileInfo(destination).size();
+    return best;
+}
+
+
+static void PrintFigures(const char *name, const ExportFigures &figures)
+{
+    printf("  %-28s %9.1f ms  %7.2f MB  read %8.2f MB  written %8.2f MB\n", name, figures.ms,
+           figures.size / 1048576.0, figures.read / 1048576.0, figures.written / 1048576.0);
+}
+
+
+int RunExportBenchmark(const QStringList &args)
+{
+    if (args.isEmpty() || !QFileInfo(args.at(0)).isFile()) {
+        fprintf(stderr, "sigil-benchmarks export needs an epub to export\n");
+        return 1;
+    }
+    int runs = (args.count() > 1) ? qMax(1, args.at(1).toInt()) : 3;
+
+    try {
+        ImportEPUB importer(args.at(0));
+        QSharedPointer<Book> book = importer.GetBook(false);
+        TempFolder outfolder;
+        QString old_path = outfolder.GetPath() + "/old.epub";
+        QString new_path = outfolder.GetPath() + "/new.epub";
+
+        // A first export saves all resources and brings the OPF metadata
+        // up to date, so the timed exports below all start from the same book.
+        ExportEPUB(new_path, book).WriteBook();
+
+        printf("%s: %d files, best of %d runs, %d threads\n", qPrintable(QFileInfo(args.at(0)).fileName()),
+               book->GetFolderKeeper()->GetResourceList().count(), runs,
+               QThreadPool::globalInstance()->maxThreadCount());
+
+        bool old_ok = true;
+        ExportFigures old_figures = Measure(runs, old_path, [&]() {
+            old_ok = OldWriteBook(book, old_path) && old_ok;
+        });
+        ExportFigures unchanged_figures = Measure(runs, new_path, [&]() {
+            ExportEPUB(new_path, book).WriteBook();
+        });
+        bool same = old_ok && (ReadEntries(old_path) == ReadEntries(new_path));
+
+        // Without a source epub every file has to be deflated again, which
+        // is what a book that was edited throughout does to the exporter.
+        book->SetSourceArchive(QString(), QHash<QString, QByteArray>());
+        ExportFigures deflated_figures = Measure(runs, new_path, [&]() {
+            ExportEPUB(new_path, book).WriteBook();
+        });
+        same = same && (ReadEntries(old_path) == ReadEntries(new_path));
+
+        PrintFigures("temp copy, one thread (old)", old_figures);
+        PrintFigures("streamed, unchanged entries", unchanged_figures);
+        PrintFigures("streamed, all deflated", deflated_figures);
+        printf("  %s\n", same ? "same entries and checksums" : "ENTRIES DIFFER");
+        return same ? 0 : 2;
+    } catch (std::exception &e) {
+        fprintf(stderr, "export failed: %s\n", e.what());
+        return 1;
+    }
+}
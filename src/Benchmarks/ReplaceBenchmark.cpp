@@ -0,0 +1,205 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <stdio.h>
+#include <tuple>
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+
+#include "Benchmarks/Benchmarks.h"
+#include "Misc/SearchOperations.h"
+#include "Misc/TempFolder.h"
+#include "Misc/Utility.h"
+#include "PCRE2/PCRECache.h"
+#include "PCRE2/SPCRE.h"
+#include "ResourceObjects/TextResource.h"
+
+static const int RUNS = 3;
+static const int BOOK_FILES = 200;
+static const int BOOK_FILE_KB = 32;
+
+struct ReplaceCase {
+    const char *name;
+    QString regex;
+    QString replacement;
+};
+
+static const QString PARAGRAPH =
+    "<p class=\"calibre%1\">It was the best of times, it was the worst of times, "
+    "it was the age of wisdom, it was the age of foolishness.</p>\n";
+
+
+static QString MakeText(int kilobytes)
+{
+    QString text;
+    text.reserve(kilobytes * 1024 + PARAGRAPH.length() + 32);
+    int i = 0;
+    while (text.length() < kilobytes * 1024) {
+        text.append(PARAGRAPH.arg(i++ % 7));
+    }
+    return text;
+}
+
+
+// The global replace as it was before, every match was replaced inside the
+// full text starting from the last one so the earlier offsets stay valid.
+static std::tuple<QString, int> OldGlobalReplace(const QString &text, SPCRE *spcre, const QString &replacement)
+{
+    QString new_text = text;
+    int count = 0;
+    QList<SPCRE::MatchInfo> match_info = spcre->getEveryMatchInfo(text);
+
+    for (int i = match_info.count() - 1; i >= 0; i--) {
+        QString match_segement = Utility::Substring(match_info.at(i).offset.first, match_info.at(i).offset.second, new_text);
+        QString replacement_text;
+
+        if (spcre->replaceText(match_segement, match_info.at(i).capture_groups_offsets, replacement, replacement_text)) {
+            new_text.replace(match_info.at(i).offset.first, match_info.at(i).offset.second - match_info.at(i).offset.first, replacement_text);
+            count++;
+        }
+    }
+
+    return std::make_tuple(new_text, count);
+}
+
+
+static void ResetTexts(const QList<Resource *> &resources, const QList<QString> &texts)
+{
+    for (int i = 0; i < resources.count(); ++i) {
+        qobject_cast<TextResource *>(resources.at(i))->SetText(texts.at(i));
+    }
+}
+
+
+// Counts and replaces over all the files, first one file after the other with
+// the old replace, then through SearchOperations as Find & Replace does it.
+// Returns false if both do not end up with the same texts and counts.
+static bool RunCase(const ReplaceCase &rcase, const QList<Resource *> &resources, const QList<QString> &texts)
+{
+    QSharedPointer<SPCRE> spcre = PCRECache::instance().getObject(rcase.regex);
+    double old_count_ms = 1e12, new_count_ms = 1e12;
+    double old_replace_ms = 1e12, new_replace_ms = 1e12;
+    int old_count = 0, new_count = 0;
+    int old_replaced = 0, new_replaced = 0;
+    QList<QString> old_texts;
+
+    for (int run = 0; run < RUNS; ++run) {
+        qint64 start = NowNs();
+        old_count = 0;
+        foreach(const QString &text, texts) {
+            old_count += spcre->getEveryMatchInfo(text).count();
+        }
+        old_count_ms = qMin(old_count_ms, ElapsedMs(start));
+
+        start = NowNs();
+        new_count = SearchOperations::CountInFiles(rcase.regex, resources);
+        new_count_ms = qMin(new_count_ms, ElapsedMs(start));
+
+        start = NowNs();
+        old_replaced = 0;
+        old_texts.clear();
+        foreach(const QString &text, texts) {
+            QString new_text;
+            int count;
+            std::tie(new_text, count) = OldGlobalReplace(text, spcre.data(), rcase.replacement);
+            old_texts.append(new_text);
+            old_replaced += count;
+        }
+        old_replace_ms = qMin(old_replace_ms, ElapsedMs(start));
+
+        ResetTexts(resources, texts);
+        start = NowNs();
+        new_replaced = SearchOperations::ReplaceInAllFIles(rcase.regex, rcase.replacement, resources);
+        new_replace_ms = qMin(new_replace_ms, ElapsedMs(start));
+    }
+
+    bool same = (old_count == new_count) && (old_replaced == new_replaced);
+    for (int i = 0; same && i < resources.count(); ++i) {
+        same = qobject_cast<TextResource *>(resources.at(i))->GetText() == old_texts.at(i);
+    }
+    ResetTexts(resources, texts);
+
+    printf("  %-10s %8d matches  count %9.2f -> %9.2f ms  replace %9.2f -> %9.2f ms  %s\n",
+           rcase.name, new_count, old_count_ms, new_count_ms, old_replace_ms, new_replace_ms,
+           same ? "same result" : "RESULTS DIFFER");
+    return same;
+}
+
+
+static bool RunScenario(const QString &title, int files, int kilobytes, const QList<ReplaceCase> &cases)
+{
+    TempFolder tempfolder;
+    QList<Resource *> resources;
+    QList<QString> texts;
+    QString text = MakeText(kilobytes);
+    for (int i = 0; i < files; ++i) {
+        QString path = tempfolder.GetPath() + QString("/file%1.xhtml").arg(i);
+        TextResource *resource = new TextResource(tempfolder.GetPath(), path);
+        resource->SetText(text);
+        resources.append(resource);
+        texts.append(text);
+    }
+
+    printf("%s: %d file(s) of %d KB, best of %d runs, old -> new\n", qPrintable(title), files, kilobytes, RUNS);
+    bool same = true;
+    foreach(const ReplaceCase &rcase, cases) {
+        same = RunCase(rcase, resources, texts) && same;
+    }
+    qDeleteAll(resources);
+    return same;
+}
+
+
+int RunReplaceBenchmark(const QStringList &args)
+{
+    QList<int> sizes;
+    foreach(QString arg, args) {
+        bool ok = false;
+        int kilobytes = arg.toInt(&ok);
+        if (!ok || kilobytes <= 0) {
+            fprintf(stderr, "not a size in kilobytes: %s\n", qPrintable(arg));
+            return 1;
+        }
+        sizes.append(kilobytes);
+    }
+    if (sizes.isEmpty()) {
+        sizes << 64 << 512 << 4096;
+    }
+
+    // few long matches, many short ones and a replacement using a capture
+    QList<ReplaceCase> cases;
+    cases.append({ "sparse",   "worst of times",          "worst of all times" });
+    cases.append({ "dense",    "\\bit\\b",                "It" });
+    cases.append({ "capture",  "class=\"calibre(\\d)\"",  "class=\"c\\1\"" });
+
+    printf("thread pool: %d threads\n", QThreadPool::globalInstance()->maxThreadCount());
+    bool same = true;
+    // the replace itself, growing with the length of a single file
+    foreach(int kilobytes, sizes) {
+        same = RunScenario("single file", 1, kilobytes, cases) && same;
+    }
+    // a whole book, where the files are counted and replaced in parallel
+    same = RunScenario("book", BOOK_FILES, BOOK_FILE_KB, cases) && same;
+    return same ? 0 : 2;
+}
@@ -31,6 +31,7 @@
 #include "BookManipulation/Book.h"
 #include "BookManipulation/CleanSource.h"
 #include "BookManipulation/FolderKeeper.h"
+#include "BookManipulation/ReferenceIndex.h"
 #include "Parsers/GumboInterface.h"
 #include "Parsers/CSSToolbox.h"
 #include "Parsers/CSSInfo.h"
@@ -227,8 +228,12 @@ const QString HTML5_COVER_SOURCE =
 Book::Book()
     :
     m_Mainfolder(new FolderKeeper(this)),
+    m_ReferenceIndex(new ReferenceIndex(m_Mainfolder, this)),
     m_IsModified(false)
 {
+    m_LastSaveStatistics.files_written = 0;
+    m_LastSaveStatistics.files_skipped = 0;
+    m_LastSaveStatistics.bytes_written = 0;
 }
 
 Book::~Book()
@@ -243,6 +248,12 @@ FolderKeeper *Book::GetFolderKeeper()
 }
 
 
+ReferenceIndex *Book::GetReferenceIndex()
+{
+    return m_ReferenceIndex;
+}
+
+
 const FolderKeeper *Book::GetFolderKeeper() const
 {
     return m_Mainfolder;
@@ -838,7 +849,7 @@ std::tuple<QString, QStringList> Book::GetStyleUrlsInHTMLFileMapped(HTMLResource
     QString html_bookpath = html_resource->GetRelativePath();
     QString startdir = html_resource->GetFolder();
     // we need to convert this hreflist to bookpaths if possible
-    QStringList urllist = XhtmlDoc::GetAllDescendantStyleUrls(html_resource->GetText());
+    QStringList urllist = XhtmlDoc::GetAllDescendantStyleUrls(*html_resource->GetParsedTree());
     QStringList bookpaths;
     QRegularExpression url_file_search("url\\s*\\(\\s*['\"]?([^\\(\\)'\"]*)[\"']?\\)");
     foreach (QString url, urllist) {
@@ -873,12 +884,12 @@ QHash<QString, QStringList> Book::GetIdsInHTMLFiles()
 std::tuple<QString, QStringList> Book::GetIdsInHTMLFileMapped(HTMLResource *html_resource)
 {
     return std::make_tuple(html_resource->GetRelativePath(),
-                           XhtmlDoc::GetAllDescendantIDs(html_resource->GetText()));
+                           XhtmlDoc::GetAllDescendantIDs(*html_resource->GetParsedTree()));
 }
 
 QStringList Book::GetIdsInHTMLFile(HTMLResource *html_resource)
 {
-    return XhtmlDoc::GetAllDescendantIDs(html_resource->GetText());
+    return XhtmlDoc::GetAllDescendantIDs(*html_resource->GetParsedTree());
 }
 
 
@@ -926,12 +937,12 @@ QHash<QString, QStringList> Book::GetHrefsInHTMLFiles()
 std::tuple<QString, QStringList> Book::GetHrefsInHTMLFileMapped(HTMLResource *html_resource)
 {
     return std::make_tuple(html_resource->GetRelativePath(),
-                           XhtmlDoc::GetAllDescendantHrefs(html_resource->GetText()));
+                           XhtmlDoc::GetAllDescendantHrefs(*html_resource->GetParsedTree()));
 }
 
 QStringList Book::GetClassesInHTMLFile(HTMLResource *html_resource)
 {
-    return XhtmlDoc::GetAllDescendantClasses(html_resource->GetText());
+    return XhtmlDoc::GetAllDescendantClasses(*html_resource->GetParsedTree());
 }
 
 QHash<QString, QStringList> Book::GetImagesInHTMLFiles()
@@ -1083,7 +1094,7 @@ std::tuple<QString, QStringList> Book::GetMediaInHTMLFileMapped(HTMLResource *ht
 {
     QString html_bookpath = html_resource->GetRelativePath();
     QString startdir = html_resource->GetFolder();
-    QStringList media_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(html_resource->GetText(), 
+    QStringList media_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(*html_resource->GetParsedTree(), 
                                                                        GIMAGE_TAGS + GVIDEO_TAGS + GAUDIO_TAGS);
     QStringList media_bookpaths;
     foreach(QString ahref, media_hrefs) {
@@ -1119,7 +1130,7 @@ std::tuple<QString, QStringList> Book::GetImagesInHTMLFileMapped(HTMLResource *h
 {
     QString html_bookpath = html_resource->GetRelativePath();
     QString startdir = html_resource->GetFolder();
-    QStringList image_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(html_resource->GetText(), GIMAGE_TAGS);
+    QStringList image_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(*html_resource->GetParsedTree(), GIMAGE_TAGS);
     QStringList image_bookpaths;
     foreach(QString ahref, image_hrefs) {
         if (ahref.indexOf(":") == -1) {
@@ -1133,7 +1144,7 @@ std::tuple<QString, QStringList> Book::GetVideoInHTMLFileMapped(HTMLResource *ht
 {
     QString html_bookpath = html_resource->GetRelativePath();
     QString startdir = html_resource->GetFolder();
-    QStringList video_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(html_resource->GetText(), GVIDEO_TAGS);
+    QStringList video_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(*html_resource->GetParsedTree(), GVIDEO_TAGS);
     QStringList video_bookpaths;
     foreach(QString ahref, video_hrefs) {
         if (ahref.indexOf(":") == -1) {
@@ -1147,7 +1158,7 @@ std::tuple<QString, QStringList> Book::GetAudioInHTMLFileMapped(HTMLResource *ht
 {
     QString html_bookpath = html_resource->GetRelativePath();
     QString startdir = html_resource->GetFolder();
-    QStringList audio_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(html_resource->GetText(), GAUDIO_TAGS);
+    QStringList audio_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(*html_resource->GetParsedTree(), GAUDIO_TAGS);
     QStringList audio_bookpaths;
     foreach(QString ahref, audio_hrefs) {
         if (ahref.indexOf(":") == -1) {
@@ -1446,9 +1457,49 @@ QList <Resource *> Book::GetAllResources()
 void Book::SaveAllResourcesToDisk()
 {
     QList<Resource *> resources = m_Mainfolder->GetResourceList();
+    QList<Resource *> changed_resources;
+    foreach(Resource * resource, resources) {
+        if (resource->HasUnsavedChanges()) {
+            changed_resources.append(resource);
+        }
+    }
+    m_LastSaveStatistics.files_written = changed_resources.count();
+    m_LastSaveStatistics.files_skipped = resources.count() - changed_resources.count();
+    m_LastSaveStatistics.bytes_written = 0;
+    if (changed_resources.isEmpty()) {
+        return;
+    }
     m_Mainfolder->SuspendWatchingResources();
-    QtConcurrent::blockingMap(resources, SaveOneResourceToDisk);
+    QtConcurrent::blockingMap(changed_resources, SaveOneResourceToDisk);
     m_Mainfolder->ResumeWatchingResources();
+    foreach(Resource * resource, changed_resources) {
+        m_LastSaveStatistics.bytes_written += QFileInfo(resource->GetFullPath()).size();
+    }
+}
+
+
+Book::SaveStatistics Book::GetLastSaveStatistics() const
+{
+    return m_LastSaveStatistics;
+}
+
+
+void Book::SetSourceArchive(const QString &zippath, const QHash<QString, QByteArray> &entry_names)
+{
+    m_SourceArchivePath = zippath;
+    m_SourceArchiveEntries = entry_names;
+}
+
+
+QString Book::GetSourceArchivePath() const
+{
+    return m_SourceArchivePath;
+}
+
+
+QByteArray Book::GetSourceArchiveEntryName(const QString &bookpath) const
+{
+    return m_SourceArchiveEntries.value(bookpath);
 }
 
 
@@ -1607,11 +1658,10 @@ QPair<QString, QStringList> Book::GetRelLinksInOneFile(HTMLResource *html_resour
     Q_ASSERT(html_resource);
     QReadLocker locker(&html_resource->GetLock());
     QString htmldir = html_resource->GetFolder();
-    GumboInterface gi = GumboInterface(html_resource->GetText(), html_resource->GetEpubVersion());
-    gi.parse();
+    QSharedPointer<const GumboInterface> gi = html_resource->GetParsedTree();
     QPair<QString, QStringList> link_pair;
     QStringList hreflist;
-    const QList<GumboNode*> anchor_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_A);
+    const QList<GumboNode*> anchor_nodes = gi->get_all_nodes_with_tag(GUMBO_TAG_A);
     for (int i = 0; i < anchor_nodes.length(); ++i) {
         GumboNode* node = anchor_nodes.at(i);
         GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "href");
@@ -1630,12 +1680,9 @@ QPair<QString, QStringList> Book::GetOneFileIDs(HTMLResource *html_resource)
 {
     Q_ASSERT(html_resource);
     QReadLocker locker(&html_resource->GetLock());
-    QString newsource = html_resource->GetText();
-    QString version = html_resource->GetEpubVersion();
-    GumboInterface gi = GumboInterface(newsource, version);
-    gi.parse();
+    QSharedPointer<const GumboInterface> gi = html_resource->GetParsedTree();
     QPair<QString, QStringList> id_pair;
-    QStringList ids = gi.get_all_values_for_attribute(QString("id"));
+    QStringList ids = gi->get_all_values_for_attribute(QString("id"));
     id_pair.first = html_resource->GetRelativePath();
     id_pair.second = ids;
     return id_pair;
@@ -1645,15 +1692,14 @@ QPair<QString, QStringList> Book::GetOneFileIDs(HTMLResource *html_resource)
 bool Book::XhtmlUsesStyleProperty(HTMLResource* html_resource, QString property)
 {
     QString newsource;
+    QSharedPointer<const GumboInterface> gi;
     // first check all internal style attributes
     {
         QReadLocker locker(&html_resource->GetLock());
         newsource = html_resource->GetText();
+        gi = html_resource->GetParsedTree();
     }
-    QString version = html_resource->GetEpubVersion();
-    GumboInterface gi = GumboInterface(newsource, version);
-    gi.parse();
-    QStringList styles = gi.get_all_values_for_attribute(QString("style"));
+    QStringList styles = gi->get_all_values_for_attribute(QString("style"));
     foreach(QString style_value, styles){
         if (style_value.indexOf(property) >= 0) return true;
     }
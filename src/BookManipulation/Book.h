@@ -38,6 +38,7 @@ class SVGResource;
 class FolderKeeper;
 class HTMLResource;
 class NCXResource;
+class ReferenceIndex;
 class OPFResource;
 class MiscTextResource;
 class Resource;
@@ -74,6 +75,15 @@ public:
      */
     const FolderKeeper *GetFolderKeeper() const;
 
+    /**
+     * Returns the index of which files refer to which,
+     * used to limit rename and move updates to the
+     * files that are actually affected.
+     *
+     * @return The book's reference index.
+     */
+    ReferenceIndex *GetReferenceIndex();
+
     /**
      * Returns the book's OPF file.
      *
@@ -270,12 +280,52 @@ public:
 
     QList <Resource *> GetAllResources();
 
+    // Describes the work done by the last SaveAllResourcesToDisk.
+    struct SaveStatistics {
+        // Resources that had unsaved changes and were written.
+        int files_written;
+
+        // Resources that were already in sync with the disk.
+        int files_skipped;
+
+        // Size on disk of the files that were written.
+        qint64 bytes_written;
+    };
+
     /**
      * Makes sure that all the resources have saved the state of
-     * their caches to the disk.
+     * their caches to the disk. Resources without unsaved changes
+     * are left untouched.
      */
     void SaveAllResourcesToDisk();
 
+    /**
+     * Returns what the last call to SaveAllResourcesToDisk() did.
+     */
+    SaveStatistics GetLastSaveStatistics() const;
+
+    /**
+     * Remembers the epub the book was imported from, along with the
+     * zip entry name used for each book path, so that exporters can
+     * copy unchanged files from it without recompressing them.
+     *
+     * @param zippath The full path to the source epub.
+     * @param entry_names The raw zip entry name keyed by book path.
+     */
+    void SetSourceArchive(const QString &zippath, const QHash<QString, QByteArray> &entry_names);
+
+    /**
+     * Returns the full path to the epub the book was imported from,
+     * or an empty string if it was not imported from one.
+     */
+    QString GetSourceArchivePath() const;
+
+    /**
+     * Returns the raw zip entry name in the source epub for a book path,
+     * or an empty QByteArray if there is none.
+     */
+    QByteArray GetSourceArchiveEntryName(const QString &bookpath) const;
+
 
     /**
      * Returns the modified state of the book. A book
@@ -447,11 +497,28 @@ private:
      */
     FolderKeeper *m_Mainfolder;
 
+    /**
+     * The reverse index of references between the book's files.
+     */
+    ReferenceIndex *m_ReferenceIndex;
+
     /**
      * Stores the modified state of the book.
      */
     bool m_IsModified;
 
+    /**
+     * Statistics of the last SaveAllResourcesToDisk.
+     */
+    SaveStatistics m_LastSaveStatistics;
+
+    /**
+     * The epub the book was imported from and its zip entry
+     * names keyed by book path. @see SetSourceArchive().
+     */
+    QString m_SourceArchivePath;
+    QHash<QString, QByteArray> m_SourceArchiveEntries;
+
 };
 
 #endif // BOOK_H
@@ -37,6 +37,7 @@
 #include "Parsers/HTMLStyleInfo.h"
 #include "Parsers/GumboInterface.h"
 #include "Query/CSelection.h"
+#include "Query/CSelectorIndex.h"
 #include "Query/CNode.h"
 #include "Misc/SettingsStore.h"
 #include "Misc/Utility.h"
@@ -91,7 +92,7 @@ QList<BookReports::StyleData *> BookReports::ClassesUsedInHTMLFileMapped(HTMLRes
 
     // Get the unique list of classes in this file
     // list of element_name.class_name
-    QStringList classes_in_file = XhtmlDoc::GetAllDescendantClasses(html_resource->GetText());
+    QStringList classes_in_file = XhtmlDoc::GetAllDescendantClasses(*html_resource->GetParsedTree());
     classes_in_file.removeDuplicates();
 
     // Get the linked stylesheets for this file
@@ -166,12 +167,19 @@ QList<BookReports::StyleData *> BookReports::GetAllCSSSelectorsUsed(QSharedPoint
     QList<CSSResource *> css_resources = book->GetFolderKeeper()->GetResourceTypeList<CSSResource>(false);
 
     // Parse each css file once and store its parser object
+    // along with its selectors compiled for matching
     QHash<QString, CSSInfo * > css_parsers;
+    QHash<QString, CSelectorIndex * > css_indexes;
     foreach(CSSResource * css_resource, css_resources) {
         QString css_filename = css_resource->GetRelativePath();
         if (!css_parsers.contains(css_filename)) {
             CSSInfo * cp = new CSSInfo(css_resource->GetText());
             css_parsers[css_filename] = cp;
+            CSelectorIndex * ci = new CSelectorIndex();
+            foreach(CSSInfo::CSSSelector * selector, cp->getAllSelectors()) {
+                ci->add(selector->text.toStdString());
+            }
+            css_indexes[css_filename] = ci;
         }
     }
 
@@ -180,7 +188,7 @@ QList<BookReports::StyleData *> BookReports::GetAllCSSSelectorsUsed(QSharedPoint
     QFuture< QList< std::pair<QString,QString> > > usage_future;
     usage_future = QtConcurrent::mapped(html_resources,
                                         std::bind(AllSelectorsUsedInHTMLFileMapped,
-                                                  std::placeholders::_1, css_parsers));
+                                                  std::placeholders::_1, css_parsers, css_indexes));
 
     int num_futures = usage_future.results().count();
     for (int i = 0; i < num_futures; ++i) {
@@ -238,39 +246,52 @@ QList<BookReports::StyleData *> BookReports::GetAllCSSSelectorsUsed(QSharedPoint
         delete cp;
     }
     css_parsers.clear();
+    foreach(CSelectorIndex * ci, css_indexes) {
+        delete ci;
+    }
+    css_indexes.clear();
 
     return css_selector_usage;
 }
 
 
 QList< std::pair<QString,QString> > BookReports::AllSelectorsUsedInHTMLFileMapped(HTMLResource* html_resource,
-                                                                          const QHash<QString, CSSInfo *> &css_parsers)
+                                                                          const QHash<QString, CSSInfo *> &css_parsers,
+                                                                          const QHash<QString, CSelectorIndex *> &css_indexes)
 {
     QList< std::pair<QString, QString> > selectors_used;
 
     QStringList linked_stylesheets = html_resource->GetLinkedStylesheets();
     
-    GumboInterface gi = GumboInterface(html_resource->GetText(), "any_version");
+    QSharedPointer<const GumboInterface> tree = html_resource->GetParsedTree();
+    const GumboInterface &gi = *tree;
     
     // Look at each selector from linked CSS files and internal html style tags
     // and see if they match something in this html file
     // file names are all bookpaths
+    // Each set of compiled selectors is tested in a single walk of the tree
+    // and an empty result means there is nothing to search
 
+    QString foundin = html_resource->GetRelativePath();
+    QHash<QString, std::vector<bool> > sheet_matches;
     foreach(QString css_filename, linked_stylesheets) {
-        if (css_parsers.contains(css_filename)) {
+        if (css_parsers.contains(css_filename) && css_indexes.contains(css_filename)) {
+            CSelectorIndex * ci = css_indexes[css_filename];
+            if (!sheet_matches.contains(css_filename)) {
+                sheet_matches[css_filename] = gi.findmatches(*ci);
+            }
+            const std::vector<bool> &found = sheet_matches[css_filename];
+            if (found.empty()) continue;
             CSSInfo * cp = css_parsers[css_filename];
             QList<CSSInfo::CSSSelector *> selectors = cp->getAllSelectors();
-            foreach(CSSInfo::CSSSelector * selector, selectors) {
-                // Use Gumbo Query Library to see if selector is found
-                CSelection c = gi.find(selector->text);
+            for (int i = 0; i < selectors.size(); i++) {
+                CSSInfo::CSSSelector * selector = selectors.at(i);
                 // if Query selector parse error occurs to be most safe
                 // assume this selector is used in this file
-                std::pair<QString, QString> res;
-                QString foundin = html_resource->GetRelativePath();
-                if (c.parseError()) foundin = "*** Selector Parse Error ***";
-                if (c.parseError() || (c.nodeNum() > 0 && c.nodeAt(0).valid())) {
+                if (ci->parseError(i) || found[i]) {
+                    std::pair<QString, QString> res;
                     res.first = css_filename + USEP + QString::number(selector->pos) + USEP + selector->text;
-                    res.second = foundin;
+                    res.second = ci->parseError(i) ? "*** Selector Parse Error ***" : foundin;
                     selectors_used.append(res);
                 }
             }
@@ -281,17 +302,22 @@ QList< std::pair<QString,QString> > BookReports::AllSelectorsUsedInHTMLFileMappe
     HTMLStyleInfo hp(html_resource->GetText());
     if (hp.hasStyles()) {
         QList<CSSInfo::CSSSelector *> selectors = hp.getAllSelectors();
+        CSelectorIndex ci;
         foreach(CSSInfo::CSSSelector * selector, selectors) {
-            CSelection c = gi.find(selector->text);
-            // if Query selector parse error occurs to be most safe
-            // assume this selector is used in this file
-            std::pair<QString, QString> res;
-            QString foundin = html_resource->GetRelativePath();
-            if (c.parseError()) foundin = "*** Selector Parse Error ***";
-            if (c.parseError() || (c.nodeNum() > 0 && c.nodeAt(0).valid())) {
-                res.first = html_resource->GetRelativePath() + USEP + QString::number(selector->pos) + USEP + selector->text;
-                res.second = foundin;
-                selectors_used.append(res);
+            ci.add(selector->text.toStdString());
+        }
+        std::vector<bool> found = gi.findmatches(ci);
+        if (!found.empty()) {
+            for (int i = 0; i < selectors.size(); i++) {
+                CSSInfo::CSSSelector * selector = selectors.at(i);
+                // if Query selector parse error occurs to be most safe
+                // assume this selector is used in this file
+                if (ci.parseError(i) || found[i]) {
+                    std::pair<QString, QString> res;
+                    res.first = html_resource->GetRelativePath() + USEP + QString::number(selector->pos) + USEP + selector->text;
+                    res.second = ci.parseError(i) ? "*** Selector Parse Error ***" : foundin;
+                    selectors_used.append(res);
+                }
             }
         }
     }
@@ -72,10 +72,8 @@ QList<Headings::Heading> Headings::GetHeadingListForOneFile(HTMLResource *html_r
         bool include_unwanted_headings)
 {
     Q_ASSERT(html_resource);
-    QString source = html_resource->GetText();
-    QString version = html_resource->GetEpubVersion();
-    GumboInterface gi = GumboInterface(source, version);
-    gi.parse();
+    QSharedPointer<const GumboInterface> tree = html_resource->GetParsedTree();
+    const GumboInterface &gi = *tree;
 
     // get original source line number of body element
     unsigned int body_line = 0;
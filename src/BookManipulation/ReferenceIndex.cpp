@@ -0,0 +1,244 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford Ontario Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#include <tuple>
+
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrent>
+
+#include "BookManipulation/FolderKeeper.h"
+#include "BookManipulation/ReferenceIndex.h"
+#include "Misc/Utility.h"
+#include "Parsers/GumboInterface.h"
+#include "ResourceObjects/CSSResource.h"
+#include "ResourceObjects/HTMLResource.h"
+
+// the attributes GumboInterface::perform_source_updates rewrites,
+// xlink:href included as gumbo stores it by its local name
+static const QStringList LINK_ATTRIBUTES = QStringList() << "href" << "src" << "poster"
+                                                         << "data" << "srcset" << "altimg";
+
+ReferenceIndex::ReferenceIndex(FolderKeeper *keeper, QObject *parent)
+    : QObject(parent),
+      m_Keeper(keeper)
+{
+    connect(m_Keeper, SIGNAL(ResourceRemoved(const Resource *)),
+            this,     SLOT(ResourceRemoved(const Resource *)));
+}
+
+
+QSet<QString> ReferenceIndex::GetReferencingIdentifiers(const QString &bookpath)
+{
+    Refresh();
+    return m_ReferencedBy.value(bookpath);
+}
+
+
+QList<Resource *> ReferenceIndex::GetResourcesToUpdate(const QHash<QString, QString> &updates)
+{
+    Refresh();
+    QSet<QString> referencing;
+    foreach(QString oldbookpath, updates.keys()) {
+        referencing.unite(m_ReferencedBy.value(oldbookpath));
+    }
+    QList<Resource *> resources;
+    foreach(Resource *resource, m_Keeper->GetResourceList()) {
+        Resource::ResourceType type = resource->Type();
+        if ((type != Resource::HTMLResourceType) && (type != Resource::CSSResourceType)) {
+            resources << resource;
+            continue;
+        }
+        // a moved file has to update its own relative links
+        if (referencing.contains(resource->GetIdentifier()) ||
+            updates.contains(resource->GetCurrentBookRelPath())) {
+            resources << resource;
+        }
+    }
+    return resources;
+}
+
+
+void ReferenceIndex::ResourceRemoved(const Resource *resource)
+{
+    RemoveEntry(resource->GetIdentifier());
+}
+
+
+static std::tuple<QString, QString, QSet<QString>> CollectTargetsMapped(Resource *resource,
+        QSet<QString> (*collect)(Resource *, const QString &))
+{
+    // the location the links in the text are relative to, the
+    // old one while a rename or move is being applied
+    QString bookpath = resource->GetCurrentBookRelPath();
+    return std::make_tuple(resource->GetIdentifier(), bookpath, collect(resource, bookpath));
+}
+
+
+void ReferenceIndex::Refresh()
+{
+    QList<Resource *> stale;
+    QHash<QString, quint64> revisions;
+    foreach(Resource *resource, m_Keeper->GetResourceList()) {
+        if ((resource->Type() != Resource::HTMLResourceType) && (resource->Type() != Resource::CSSResourceType)) {
+            continue;
+        }
+        TextResource *text_resource = qobject_cast<TextResource *>(resource);
+        if (!text_resource) {
+            continue;
+        }
+        // read the revision before the text is, a racing edit can only
+        // make us collect that file again on the next query
+        quint64 revision = text_resource->GetTextRevision();
+        QHash<QString, Entry>::const_iterator it = m_Entries.constFind(resource->GetIdentifier());
+        if ((it != m_Entries.constEnd()) &&
+            (it->revision == revision) &&
+            (it->bookpath == resource->GetCurrentBookRelPath())) {
+            continue;
+        }
+        stale << resource;
+        revisions[resource->GetIdentifier()] = revision;
+    }
+    if (stale.isEmpty()) {
+        return;
+    }
+
+    const QList<std::tuple<QString, QString, QSet<QString>>> results =
+        QtConcurrent::blockingMapped(stale, std::bind(CollectTargetsMapped, std::placeholders::_1, CollectTargets));
+
+    for (const std::tuple<QString, QString, QSet<QString>> &result : results) {
+        QString identifier = std::get<0>(result);
+        RemoveEntry(identifier);
+        Entry entry;
+        entry.revision = revisions.value(identifier);
+        entry.bookpath = std::get<1>(result);
+        entry.targets = std::get<2>(result);
+        foreach(QString target, entry.targets) {
+            m_ReferencedBy[target].insert(identifier);
+        }
+        m_Entries.insert(identifier, entry);
+    }
+}
+
+
+void ReferenceIndex::RemoveEntry(const QString &identifier)
+{
+    QHash<QString, Entry>::iterator it = m_Entries.find(identifier);
+    if (it == m_Entries.end()) {
+        return;
+    }
+    foreach(QString target, it->targets) {
+        QHash<QString, QSet<QString> >::iterator rit = m_ReferencedBy.find(target);
+        if (rit != m_ReferencedBy.end()) {
+            rit->remove(identifier);
+            if (rit->isEmpty()) {
+                m_ReferencedBy.erase(rit);
+            }
+        }
+    }
+    m_Entries.erase(it);
+}
+
+
+// Resolves references exactly the way the universal updates do, so every
+// file they would change is found.  A reference that does not resolve to
+// a file of the book only costs an unused key.
+QSet<QString> ReferenceIndex::CollectTargets(Resource *resource, const QString &bookpath)
+{
+    QSet<QString> targets;
+    QString folder = QFileInfo(bookpath).dir().path();
+
+    if (resource->Type() == Resource::CSSResourceType) {
+        CSSResource *css_resource = qobject_cast<CSSResource *>(resource);
+        if (css_resource) {
+            CollectStyleTargets(css_resource->GetText(), folder, targets);
+        }
+        return targets;
+    }
+
+    HTMLResource *html_resource = qobject_cast<HTMLResource *>(resource);
+    if (!html_resource) {
+        return targets;
+    }
+    QSharedPointer<const GumboInterface> gi = html_resource->GetParsedTree();
+    foreach(QString attname, LINK_ATTRIBUTES) {
+        foreach(QString value, gi->get_all_values_for_attribute(attname)) {
+            // see GumboInterface::update_attribute_value
+            if (value.contains(':')) {
+                continue;
+            }
+            QString attpath = QUrl(value).path();
+            if (!attpath.isEmpty()) {
+                targets.insert(Utility::buildBookPath(attpath, folder));
+            }
+        }
+    }
+    foreach(QString style, gi->get_all_values_for_attribute("style")) {
+        CollectStyleTargets(style, folder, targets);
+    }
+    foreach(GumboNode *node, gi->get_all_nodes_with_tag(GUMBO_TAG_STYLE)) {
+        GumboVector *children = &node->v.element.children;
+        for (unsigned int i = 0; i < children->length; ++i) {
+            GumboNode *child = static_cast<GumboNode *>(children->data[i]);
+            if ((child->type == GUMBO_NODE_TEXT) || (child->type == GUMBO_NODE_CDATA) ||
+                (child->type == GUMBO_NODE_WHITESPACE)) {
+                CollectStyleTargets(QString::fromUtf8(child->v.text.text), folder, targets);
+            }
+        }
+    }
+    return targets;
+}
+
+
+// Takes every url() and every quoted string, a superset of what
+// PerformCSSUpdates and GumboInterface::update_style_urls match
+// after their property names.
+void ReferenceIndex::CollectStyleTargets(const QString &style, const QString &folder, QSet<QString> &targets)
+{
+    if (!style.contains("url(", Qt::CaseInsensitive) && !style.contains('"') && !style.contains('\'')) {
+        return;
+    }
+    QRegularExpression reference(
+        "url\\([\"']?([^\\(\\)\"']*)[\"']?\\)"
+        "|"
+        "[\"']([^\\(\\)\"']*)[\"']",
+        QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatchIterator mi = reference.globalMatch(style);
+    while (mi.hasNext()) {
+        QRegularExpressionMatch mo = mi.next();
+        for (int i = 1; i <= reference.captureCount(); ++i) {
+            QString captured = mo.captured(i);
+            if (captured.trimmed().isEmpty()) {
+                continue;
+            }
+            QString apath = Utility::URLDecodePath(captured);
+            targets.insert(Utility::buildBookPath(apath, folder));
+            if (apath.contains('#')) {
+                apath = Utility::parseRelativeHREF(apath).first;
+                if (!apath.isEmpty()) {
+                    targets.insert(Utility::buildBookPath(apath, folder));
+                }
+            }
+        }
+    }
+}
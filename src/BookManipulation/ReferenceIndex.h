@@ -0,0 +1,127 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford Ontario Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#pragma once
+#ifndef REFERENCEINDEX_H
+#define REFERENCEINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+class FolderKeeper;
+class Resource;
+
+/**
+ * A book wide reverse index of references: for every book path,
+ * the html and css files whose hrefs, srcs, url()s, @imports or
+ * xlink:hrefs point at it.
+ *
+ * Entries are kept per file together with the text revision and
+ * location they were collected at, so only files that changed or
+ * moved since the last query are parsed again.
+ */
+class ReferenceIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param keeper The folder keeper of the book to index.
+     * @param parent The object's parent.
+     */
+    ReferenceIndex(FolderKeeper *keeper, QObject *parent = 0);
+
+    /**
+     * Returns the identifiers of the html and css files that
+     * refer to the given book path.
+     *
+     * @param bookpath The book path of the referenced file.
+     */
+    QSet<QString> GetReferencingIdentifiers(const QString &bookpath);
+
+    /**
+     * Returns the resources that have to go through the universal updates
+     * for a rename or move: the html and css files that refer to one of the
+     * old book paths or were moved themselves, and all other text resources
+     * (opf, ncx, xml) as before. Call after the resources were renamed and
+     * given their old path with SetCurrentBookRelPath().
+     *
+     * @param updates The old book paths mapped to the new ones.
+     * @return The resources in folder keeper order.
+     */
+    QList<Resource *> GetResourcesToUpdate(const QHash<QString, QString> &updates);
+
+private slots:
+
+    /**
+     * Drops the entry of a resource that left the book.
+     */
+    void ResourceRemoved(const Resource *resource);
+
+private:
+
+    struct Entry {
+        quint64 revision;
+        QString bookpath;
+        QSet<QString> targets;
+    };
+
+    /**
+     * Collects the references again for every html and css
+     * file whose text or location changed since the last time.
+     */
+    void Refresh();
+
+    /**
+     * Returns the book paths the resource refers to, resolved from
+     * the given location. Safe to call from worker threads.
+     */
+    static QSet<QString> CollectTargets(Resource *resource, const QString &bookpath);
+
+    /**
+     * Adds the book paths referenced from css text (a stylesheet,
+     * a style element or a style attribute) to targets.
+     */
+    static void CollectStyleTargets(const QString &style, const QString &folder, QSet<QString> &targets);
+
+    void RemoveEntry(const QString &identifier);
+
+    FolderKeeper *m_Keeper;
+
+    /**
+     * The collected references keyed by resource identifier.
+     */
+    QHash<QString, Entry> m_Entries;
+
+    /**
+     * The reverse index: book path to the identifiers
+     * of the resources that refer to it.
+     */
+    QHash<QString, QSet<QString> > m_ReferencedBy;
+};
+
+#endif // REFERENCEINDEX_H
@@ -184,6 +184,12 @@ QList<QString> XhtmlDoc::GetAllDescendantClasses(const QString & source)
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllDescendantClasses(gi);
+}
+
+
+QList<QString> XhtmlDoc::GetAllDescendantClasses(const GumboInterface & gi)
+{
     QList<GumboNode*> nodes = gi.get_all_nodes_with_attribute(QString("class"));
     QStringList classes;
     foreach(GumboNode * node, nodes) {
@@ -228,6 +234,12 @@ QList<QString> XhtmlDoc::GetAllDescendantStyleUrls(const QString & source)
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllDescendantStyleUrls(gi);
+}
+
+
+QList<QString> XhtmlDoc::GetAllDescendantStyleUrls(const GumboInterface & gi)
+{
     QList<GumboNode*> nodes = gi.get_all_nodes_with_attribute(QString("style"));
     QStringList styles;
     foreach(GumboNode * node, nodes) {
@@ -249,6 +261,12 @@ QList<QString> XhtmlDoc::GetAllDescendantIDs(const QString & source)
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllDescendantIDs(gi);
+}
+
+
+QList<QString> XhtmlDoc::GetAllDescendantIDs(const GumboInterface & gi)
+{
     QList<GumboNode*> nodes = gi.get_all_nodes_with_attribute(QString("id"));
     nodes.append(gi.get_all_nodes_with_attribute(QString("name")));
     QStringList IDs;
@@ -275,6 +293,12 @@ QList<QString> XhtmlDoc::GetAllDescendantHrefs(const QString & source)
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllDescendantHrefs(gi);
+}
+
+
+QList<QString> XhtmlDoc::GetAllDescendantHrefs(const GumboInterface & gi)
+{
     QList<GumboNode*> nodes = gi.get_all_nodes_with_attribute(QString("href"));
     QStringList hrefs;
     foreach(GumboNode * node, nodes) {
@@ -700,6 +724,12 @@ QStringList XhtmlDoc::GetAllMediaPathsFromMediaChildren(const QString & source,
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllMediaPathsFromMediaChildren(gi, tags);
+}
+
+
+QStringList XhtmlDoc::GetAllMediaPathsFromMediaChildren(const GumboInterface & gi, QList<GumboTag> tags)
+{
     QStringList media_paths;
     QList<GumboNode*> nodes = gi.get_all_nodes_with_tags(tags);
     for (int i = 0; i < nodes.count(); ++i) {
@@ -78,6 +78,13 @@ public:
     static QList<QString> GetAllDescendantHrefs(const QString & source);
     static QList<QString> GetAllDescendantIDs(const QString & );
     static QList<QString> GetAllDescendantClasses(const QString & source);
+
+    // overloads that query an already parsed tree (see HTMLResource::GetParsedTree)
+    static QList<QString> GetAllDescendantStyleUrls(const GumboInterface & gi);
+    static QList<QString> GetAllDescendantHrefs(const GumboInterface & gi);
+    static QList<QString> GetAllDescendantIDs(const GumboInterface & gi);
+    static QList<QString> GetAllDescendantClasses(const GumboInterface & gi);
+
     static int GetFirstUseOfClass(const QString& source, const QString& class_name_to_find);
 
     struct WellFormedError {
@@ -150,6 +157,7 @@ public:
     static QStringList GetAllURLPathsFromStylesheet(const QString & source, const QString & csspath);
 
     static QStringList GetAllMediaPathsFromMediaChildren(const QString &source, QList<GumboTag> tags);
+    static QStringList GetAllMediaPathsFromMediaChildren(const GumboInterface &gi, QList<GumboTag> tags);
 
     static QStringList GetUnmatchedTagsForPosition(int split_position, TagLister& m_TagList);
 
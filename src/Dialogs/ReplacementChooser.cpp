@@ -142,7 +142,7 @@ void ReplacementChooser::CreateTable()
         PythonRoutines pr;
         fsp = pr.SetupInitialFunctionSearchEnvInPython(functionname);
     }
-    SPCRE *spcre = PCRECache::instance().getObject(search_regex);
+    QSharedPointer<SPCRE> spcre = PCRECache::instance().getObject(search_regex);
     
     m_current_count = 0;
     foreach(Resource* resource, resources ) {
@@ -32,6 +32,7 @@
 #include "sigil_exception.h"
 #include "BookManipulation/FolderKeeper.h"
 #include "Dialogs/ReportsWidgets/ImageFilesWidget.h"
+#include "Misc/ImageInfoCache.h"
 #include "Misc/NumericItem.h"
 #include "Misc/SettingsStore.h"
 #include "Misc/Utility.h"
@@ -110,15 +111,13 @@ void ImageFilesWidget::SetupTable(int sort_column, Qt::SortOrder sort_order)
     QHash<QString, QStringList> image_html_files_hash = m_Book->GetHTMLFilesUsingImages();
     QHash<QString, QStringList> image_html2_files_hash = m_Book->GetHTMLFilesUsingMediaInStyleUrls();
     QHash<QString, QStringList> image_css_files_hash = m_Book->GetCSSFilesUsingUrls();
-    foreach(Resource * resource, m_AllImageResources) {
+    // decoding every image is slow so it is done in parallel and remembered
+    QList<ImageInfoCache::ImageInfo> image_infos = ImageInfoCache::instance().GetImageInfo(m_AllImageResources, m_ThumbnailSize);
+    for (int row = 0; row < m_AllImageResources.count(); row++) {
+        Resource *resource = m_AllImageResources.at(row);
+        const ImageInfoCache::ImageInfo &image = image_infos.at(row);
         QString filepath = resource->GetRelativePath();
         QString path = resource->GetFullPath();
-        QImage image;
-        if (resource->Type() == Resource::SVGResourceType) {
-            image = Utility::RenderSvgToImage(path);
-        } else {
-            image.load(path);
-        }
         QList<QStandardItem *> rowItems;
         // Filename
         QStandardItem *name_item = new QStandardItem();
@@ -150,30 +149,27 @@ void ImageFilesWidget::SetupTable(int sort_column, Qt::SortOrder sort_order)
         rowItems << link_item;
         // Width
         NumericItem *width_item = new NumericItem();
-        width_item->setText(QString("%L1").arg(image.width()));
+        width_item->setText(QString("%L1").arg(image.width));
         width_item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
         rowItems << width_item;
         // Height
         NumericItem *height_item = new NumericItem();
-        height_item->setText(QString("%L1").arg(image.height()));
+        height_item->setText(QString("%L1").arg(image.height));
         height_item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
         rowItems << height_item;
         // Pixels
         NumericItem *pixel_item = new NumericItem();
-        pixel_item->setText(QString("%L1").arg(image.width() * image.height()));
+        pixel_item->setText(QString("%L1").arg(image.width * image.height));
         pixel_item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
         rowItems << pixel_item;
         // Color
         QStandardItem *color_item = new QStandardItem();
-        color_item->setText(image.allGray() ? "Grayscale" : "Color");
+        color_item->setText(image.gray ? "Grayscale" : "Color");
         rowItems << color_item;
 
-        // Thumbnail
-        QPixmap pixmap = QPixmap::fromImage(image);
+        // Thumbnail (already scaled to fit)
         if (m_ThumbnailSize) {
-            if (pixmap.height() > m_ThumbnailSize || pixmap.width() > m_ThumbnailSize) {
-                pixmap = pixmap.scaled(QSize(m_ThumbnailSize, m_ThumbnailSize), Qt::KeepAspectRatio);
-            }
+            QPixmap pixmap = QPixmap::fromImage(image.thumbnail);
             QStandardItem *icon_item = new QStandardItem();
             icon_item->setData(QVariant(pixmap), Qt::DecorationRole);
             rowItems << icon_item;
@@ -268,6 +268,7 @@ void SpellcheckEditor::CreateModel(int sort_column, Qt::SortOrder sort_order)
     header.append(tr("Misspelled?"));
 
     QHash<QString, int> unique_words = m_Book->GetUniqueWordsInHTMLFiles();
+    QSet<QString> misspelled_words = SpellCheck::instance().misspelledWords(unique_words.keys());
 
     int total_misspelled_words = 0;
 
@@ -279,7 +280,7 @@ void SpellcheckEditor::CreateModel(int sort_column, Qt::SortOrder sort_order)
         QString lang = Language::instance().GetLanguageName(code, code);
         QString word = HTMLSpellCheckML::textOf(lcword);
         int count = unique_words.value(lcword);
-        bool misspelled = !SpellCheck::instance().spell(lcword);
+        bool misspelled = misspelled_words.contains(lcword);
         if (misspelled) {
             total_misspelled_words++;
         }
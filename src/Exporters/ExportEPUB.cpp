@@ -24,21 +24,35 @@
 #define NOMINMAX
 #endif
 
+#include <algorithm>
 #include <string>
 #include <string.h>
+#include <vector>
 
 #include <zip.h>
+#include <unzip.h>
 #ifdef _WIN32
 #include <iowin32.h>
+#include <windows.h>
+#else
+#include <stdio.h>
+#endif
+#if defined(__APPLE__)
+#include <copyfile.h>
+#elif defined(__linux__)
+#include <sys/xattr.h>
 #endif
 
+#include <QBuffer>
+#include <QByteArray>
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
-#include <QTemporaryFile>
 #include <QTextStream>
+#include <QtConcurrent/QtConcurrent>
 
 #include "BookManipulation/CleanSource.h"
 #include "BookManipulation/FolderKeeper.h"
@@ -46,7 +60,6 @@
 #include "Exporters/EncryptionXmlWriter.h"
 #include "Exporters/ExportEPUB.h"
 #include "Misc/Utility.h"
-#include "Misc/TempFolder.h"
 #include "Misc/FontObfuscation.h"
 #include "ResourceObjects/Resource.h"
 #include "ResourceObjects/FontResource.h"
@@ -55,6 +68,11 @@
 
 #define BUFF_SIZE 8192
 
+#ifndef MAX_PATH
+// Set Max length to 256 because that's the max path size on many systems.
+#define MAX_PATH 256
+#endif
+
 const QString BODY_START = "<\\s*body[^>]*>";
 const QString BODY_END   = "</\\s*body\\s*>";
 
@@ -65,6 +83,283 @@ static const QString METAINF_FOLDER_SUFFIX = "/META-INF";
 
 static const char * EPUB_MIME_DATA = "application/epub+zip";
 
+// Deflating is split into blocks that are compressed concurrently. Each block
+// is primed with the tail of the data before it as dictionary (the way pigz
+// does it) so the result stays close to that of compressing the file in one go.
+static const qint64 DEFLATE_BLOCK_SIZE = 1024 * 1024;
+static const qint64 DEFLATE_DICT_SIZE = 32768;
+
+// Upper bound on the uncompressed data handed to the workers in one batch
+static const qint64 DEFLATE_BATCH_SIZE = 32 * 1024 * 1024;
+
+// A file to be stored in the archive
+struct ExportEntry {
+    QString relpath;
+
+    // where the data comes from, a file on disk or generated contents
+    QString filepath;
+    QByteArray contents;
+
+    // the book's resource for the file, if any, which caches its checksum
+    Resource *resource;
+
+    // font obfuscation to apply while streaming the data
+    QString algorithm;
+    QString identifier;
+
+    size_t filesize;
+    QString filecrc;
+
+    // copy the already compressed entry from the source epub
+    bool raw_copy;
+    unz64_file_pos source_pos;
+
+    // the range of deflate blocks holding its compressed data
+    int first_block;
+    int block_count;
+};
+
+// One independently deflated piece of a file
+struct DeflateBlock {
+    const ExportEntry *entry;
+    qint64 offset;
+    qint64 length;
+    bool last;
+    QByteArray data;
+    bool ok;
+};
+
+
+static bool ExportEntryLessThan(const ExportEntry &e1, const ExportEntry &e2)
+{
+    return e1.relpath < e2.relpath;
+}
+
+
+// Reads a piece of an entry's data exactly as it is to be stored in the archive
+static bool ReadEntryData(const ExportEntry &entry, qint64 offset, qint64 length, QByteArray &data)
+{
+    if (entry.filepath.isEmpty()) {
+        data = entry.contents.mid(offset, length);
+    } else {
+        QFile file(entry.filepath);
+        if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) {
+            return false;
+        }
+        data = file.read(length);
+    }
+    if (data.size() != length) {
+        return false;
+    }
+    if (!entry.algorithm.isEmpty()) {
+        FontObfuscation::ObfuscateBuffer(data, offset, entry.algorithm, entry.identifier);
+    }
+    return true;
+}
+
+
+static void ComputeEntryCRC(ExportEntry &entry)
+{
+    if (!entry.filepath.isEmpty() && entry.algorithm.isEmpty()) {
+        entry.filecrc = entry.resource ? entry.resource->GetFileCRC32() : Utility::FileCRC32(entry.filepath);
+        return;
+    }
+    // generated or obfuscated data differs from what is on disk
+    uLong crc = crc32(0L, Z_NULL, 0);
+    for (qint64 offset = 0; offset < (qint64)entry.filesize; offset += DEFLATE_BLOCK_SIZE) {
+        QByteArray data;
+        qint64 length = qMin<qint64>(DEFLATE_BLOCK_SIZE, (qint64)entry.filesize - offset);
+        if (!ReadEntryData(entry, offset, length, data)) {
+            entry.filecrc = QString();
+            return;
+        }
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(data.constData()), data.size());
+    }
+    entry.filecrc = QString("%1").arg(crc, 8, 16, QLatin1Char('0'));
+}
+
+
+// Produces a raw deflate stream for the block. All blocks but the last of a file
+// end with a sync flush so that their outputs can simply be concatenated.
+static void DeflateOneBlock(DeflateBlock &block)
+{
+    block.ok = false;
+    qint64 dict_start = qMax<qint64>(0, block.offset - DEFLATE_DICT_SIZE);
+    QByteArray dict;
+    QByteArray input;
+    if (!ReadEntryData(*block.entry, dict_start, block.offset - dict_start, dict) ||
+        !ReadEntryData(*block.entry, block.offset, block.length, input)) {
+        return;
+    }
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    // same parameters minizip uses when it deflates our entries itself
+    if (deflateInit2(&strm, 8, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return;
+    }
+    if (!dict.isEmpty()) {
+        deflateSetDictionary(&strm, reinterpret_cast<const Bytef *>(dict.constData()), dict.size());
+    }
+    // leave room for the empty stored block a sync flush appends
+    block.data.resize(deflateBound(&strm, input.size()) + 16);
+    strm.next_in   = reinterpret_cast<Bytef *>(input.data());
+    strm.avail_in  = input.size();
+    strm.next_out  = reinterpret_cast<Bytef *>(block.data.data());
+    strm.avail_out = block.data.size();
+    int res = deflate(&strm, block.last ? Z_FINISH : Z_SYNC_FLUSH);
+    if (block.last) {
+        block.ok = (res == Z_STREAM_END);
+    } else {
+        block.ok = (res == Z_OK) && (strm.avail_in == 0) && (strm.avail_out > 0);
+    }
+    block.data.resize(strm.total_out);
+    deflateEnd(&strm);
+    if (!block.ok) {
+        block.data.clear();
+    }
+}
+
+
+// Opens the epub the book was imported from and records where each of
+// its entries lives so they can be located without rescanning the archive.
+static unzFile OpenSourceArchive(const QString &zippath, QHash<QByteArray, unz64_file_pos> &entries)
+{
+    if (zippath.isEmpty() || !QFileInfo::exists(zippath)) {
+        return NULL;
+    }
+#ifdef Q_OS_WIN32
+    zlib_filefunc64_def ffunc;
+    fill_win32_filefunc64W(&ffunc);
+    unzFile sfile = unzOpen2_64(Utility::QStringToStdWString(QDir::toNativeSeparators(zippath)).c_str(), &ffunc);
+#else
+    unzFile sfile = unzOpen64(QDir::toNativeSeparators(zippath).toUtf8().constData());
+#endif
+    if (sfile == NULL) {
+        return NULL;
+    }
+    int res = unzGoToFirstFile(sfile);
+    while (res == UNZ_OK) {
+        char file_name[MAX_PATH] = {0};
+        unz_file_info64 file_info;
+        unz64_file_pos file_pos;
+        if ((unzGetCurrentFileInfo64(sfile, &file_info, file_name, MAX_PATH, NULL, 0, NULL, 0) == UNZ_OK) &&
+            (unzGetFilePos64(sfile, &file_pos) == UNZ_OK)) {
+            entries.insert(QByteArray(file_name), file_pos);
+        }
+        res = unzGoToNextFile(sfile);
+    }
+    if (res != UNZ_END_OF_LIST_OF_FILE) {
+        unzClose(sfile);
+        entries.clear();
+        return NULL;
+    }
+    return sfile;
+}
+
+
+// An entry of the source epub can be reused as is only if it still holds
+// exactly the same data (size and crc) as the file we are about to store.
+static bool SourceEntryMatches(unzFile sfile, const unz64_file_pos &file_pos,
+                               size_t afilesize, const QString &afilecrc)
+{
+    unz_file_info64 file_info;
+    if ((unzGoToFilePos64(sfile, &file_pos) != UNZ_OK) ||
+        (unzGetCurrentFileInfo64(sfile, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)) {
+        return false;
+    }
+    // skip encrypted entries and anything not simply stored or deflated
+    if ((file_info.flag & 1) ||
+        ((file_info.compression_method != 0) && (file_info.compression_method != Z_DEFLATED))) {
+        return false;
+    }
+    return (file_info.uncompressed_size == afilesize) &&
+           (QString("%1").arg(file_info.crc, 8, 16, QLatin1Char('0')) == afilecrc);
+}
+
+
+// Copies an entry from the source epub into the new archive in its
+// already compressed form.
+static bool CopyRawEntry(zipFile zfile, unzFile sfile, const unz64_file_pos &file_pos,
+                         const QString &relpath, const zip_fileinfo &fileInfo)
+{
+    unz_file_info64 file_info;
+    int method = 0;
+    int level = 0;
+    if ((unzGoToFilePos64(sfile, &file_pos) != UNZ_OK) ||
+        (unzGetCurrentFileInfo64(sfile, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK) ||
+        (unzOpenCurrentFile2(sfile, &method, &level, 1) != UNZ_OK)) {
+        return false;
+    }
+    int zip64 = (file_info.uncompressed_size >= 0xffffffff) ? 1 : 0;
+    if (zipOpenNewFileInZip4_64(zfile, relpath.toUtf8().constData(), &fileInfo, NULL, 0, NULL, 0, NULL,
+                                method, level, 1, 15, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 1<<11, zip64) != ZIP_OK) {
+        unzCloseCurrentFile(sfile);
+        return false;
+    }
+
+    // In raw mode this reads and writes the compressed data as is.
+    char buff[BUFF_SIZE] = {0};
+    int read = 0;
+    while ((read = unzReadCurrentFile(sfile, buff, BUFF_SIZE)) > 0) {
+        if (zipWriteInFileInZip(zfile, buff, read) != ZIP_OK) {
+            unzCloseCurrentFile(sfile);
+            zipCloseFileInZipRaw64(zfile, file_info.uncompressed_size, file_info.crc);
+            return false;
+        }
+    }
+    unzCloseCurrentFile(sfile);
+    if (zipCloseFileInZipRaw64(zfile, file_info.uncompressed_size, file_info.crc) != ZIP_OK) {
+        return false;
+    }
+    return read == 0;
+}
+
+
+// Moves the finished archive over the destination in one step, so the
+// destination is never seen half written.
+static bool ReplaceFile(const QString &source, const QString &destination)
+{
+#ifdef Q_OS_WIN32
+    return MoveFileExW(Utility::QStringToStdWString(QDir::toNativeSeparators(source)).c_str(),
+                       Utility::QStringToStdWString(QDir::toNativeSeparators(destination)).c_str(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return ::rename(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData()) == 0;
+#endif
+}
+
+
+// Carries the permissions and extended attributes (such as labels on macOS)
+// of the file being replaced over to its replacement.
+static void CopyFileAttributes(const QString &source, const QString &destination)
+{
+    QFile::setPermissions(destination, QFile::permissions(source));
+#if defined(Q_OS_MAC)
+    copyfile(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData(), NULL, COPYFILE_XATTR);
+#elif defined(Q_OS_LINUX)
+    QByteArray src = QFile::encodeName(source);
+    QByteArray dst = QFile::encodeName(destination);
+    ssize_t len = listxattr(src.constData(), NULL, 0);
+    if (len <= 0) {
+        return;
+    }
+    QByteArray names(len, '\0');
+    len = listxattr(src.constData(), names.data(), names.size());
+    for (const char *name = names.constData(); (len > 0) && (name < names.constData() + len); name += strlen(name) + 1) {
+        ssize_t vlen = getxattr(src.constData(), name, NULL, 0);
+        if (vlen < 0) {
+            continue;
+        }
+        QByteArray value(vlen, '\0');
+        vlen = getxattr(src.constData(), name, value.data(), value.size());
+        if (vlen >= 0) {
+            setxattr(dst.constData(), name, value.constData(), vlen, 0);
+        }
+    }
+#endif
+}
+
 
 // Constructor;
 // the first parameter is the location where the book
@@ -97,30 +392,34 @@ void ExportEPUB::WriteBook()
     }
     m_Book->GetOPF()->AddModificationDateMeta();
     m_Book->SaveAllResourcesToDisk();
-    TempFolder tempfolder;
-    CreatePublication(tempfolder.GetPath());
 
+    // The archive is streamed straight from the book's folder. Fonts are
+    // obfuscated and the encryption.xml is generated on the fly.
+    QHash<QString, std::pair<QString, QString> > font_obfuscations;
+    QHash<QString, QByteArray> generated_files;
     if (m_Book->HasObfuscatedFonts()) {
-        ObfuscateFonts(tempfolder.GetPath());
+        font_obfuscations = GetFontObfuscations();
+        generated_files[METAINF_FOLDER_SUFFIX.mid(1) + "/" + ENCRYPTION_XML_FILE_NAME] = CreateEncryptionXML();
     }
 
-    SaveFolderAsEpubToLocation(tempfolder.GetPath(), m_FullFilePath);
+    SaveFolderAsEpubToLocation(m_Book->GetFolderKeeper()->GetFullPathToMainFolder(), m_FullFilePath,
+                               font_obfuscations, generated_files);
 }
 
-// Creates the publication from the Book
-// (creates XHTML, CSS, OPF, NCX files etc.)
-void ExportEPUB::CreatePublication(const QString &fullfolderpath)
-{
-    Utility::CopyFiles(m_Book->GetFolderKeeper()->GetFullPathToMainFolder(), fullfolderpath);
-
-    if (m_Book->HasObfuscatedFonts()) {
-        CreateEncryptionXML(fullfolderpath + METAINF_FOLDER_SUFFIX);
-    }
-}
-
-void ExportEPUB::SaveFolderAsEpubToLocation(const QString &fullfolderpath, const QString &fullfilepath)
+void ExportEPUB::SaveFolderAsEpubToLocation(const QString &fullfolderpath, const QString &fullfilepath,
+                                            const QHash<QString, std::pair<QString, QString> > &font_obfuscations,
+                                            const QHash<QString, QByteArray> &generated_files)
 {
+    // Write the archive next to the destination so that it can be renamed over it
+    // once complete. A symlinked destination is written through instead, as is done
+    // when the rename is not possible, from a temp file alongside the book folder.
+    QFileInfo destination_info(fullfilepath);
+    bool rename_into_place = !destination_info.isSymLink();
     QString tempFile = fullfolderpath + "-tmp.epub";
+    if (rename_into_place) {
+        tempFile = destination_info.absolutePath() + "/." + destination_info.fileName() + "." +
+                   QString::number(QCoreApplication::applicationPid()) + ".tmp";
+    }
     QDateTime timeNow = QDateTime::currentDateTime();
     QString modified_now = timeNow.toString("yyyy-MM-dd hh:mm:ss");
     zip_fileinfo fileInfo;
@@ -159,7 +458,10 @@ void ExportEPUB::SaveFolderAsEpubToLocation(const QString &fullfolderpath, const
     }
 
     zipCloseFileInZip(zfile);
-    // Write all the files in our directory path to the archive.
+
+    // Gather all the files in our directory path. They are stored sorted so that
+    // the archive layout does not depend on the order the file system lists them in.
+    std::vector<ExportEntry> entries;
     QDirIterator it(fullfolderpath, QDir::Files | QDir::NoDotAndDotDot | QDir::Readable | QDir::Hidden, QDirIterator::Subdirectories);
 
     while (it.hasNext()) {
@@ -170,26 +472,124 @@ void ExportEPUB::SaveFolderAsEpubToLocation(const QString &fullfolderpath, const
             relpath = relpath.remove(0, 1);
         }
 
-        // do not double add the mimetype file
+        // do not double add the mimetype file, generated files replace any on disk
         if (relpath == "mimetype") continue;
+        if (generated_files.contains(relpath)) continue;
+
+        ExportEntry entry;
+        entry.relpath = relpath;
+        entry.filepath = it.filePath();
+        entry.filesize = QFileInfo(it.filePath()).size();
+        entry.resource = m_Book->GetFolderKeeper()->GetResourceByBookPathNoThrow(relpath);
+        if (font_obfuscations.contains(relpath)) {
+            entry.algorithm = font_obfuscations.value(relpath).first;
+            entry.identifier = font_obfuscations.value(relpath).second;
+        }
+        entry.raw_copy = false;
+        entry.first_block = 0;
+        entry.block_count = 0;
+        entries.push_back(entry);
+    }
+    QHashIterator<QString, QByteArray> generated(generated_files);
+    while (generated.hasNext()) {
+        generated.next();
+        ExportEntry entry;
+        entry.relpath = generated.key();
+        entry.contents = generated.value();
+        entry.resource = NULL;
+        entry.filesize = entry.contents.size();
+        entry.raw_copy = false;
+        entry.first_block = 0;
+        entry.block_count = 0;
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(), ExportEntryLessThan);
+    QtConcurrent::blockingMap(entries, ComputeEntryCRC);
+
+    // Files that have not changed since the book was imported are copied
+    // from the source epub as is instead of being deflated all over again.
+    QHash<QByteArray, unz64_file_pos> source_entries;
+    unzFile sfile = OpenSourceArchive(m_Book->GetSourceArchivePath(), source_entries);
+
+    // Everything else is split into blocks for the deflate workers.
+    std::vector<DeflateBlock> blocks;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        ExportEntry &entry = entries[i];
+        if (sfile) {
+            QByteArray entry_name = m_Book->GetSourceArchiveEntryName(entry.relpath);
+            if (!entry_name.isEmpty() && source_entries.contains(entry_name) &&
+                SourceEntryMatches(sfile, source_entries.value(entry_name), entry.filesize, entry.filecrc)) {
+                entry.raw_copy = true;
+                entry.source_pos = source_entries.value(entry_name);
+                continue;
+            }
+        }
+        entry.first_block = blocks.size();
+        qint64 offset = 0;
+        do {
+            DeflateBlock block;
+            block.entry = &entry;
+            block.offset = offset;
+            block.length = qMin<qint64>(DEFLATE_BLOCK_SIZE, (qint64)entry.filesize - offset);
+            block.last = (offset + block.length >= (qint64)entry.filesize);
+            block.ok = false;
+            blocks.push_back(block);
+            offset += block.length;
+        } while (offset < (qint64)entry.filesize);
+        entry.block_count = blocks.size() - entry.first_block;
+    }
+
+    // The workers deflate batches of blocks ahead of the writer below,
+    // which appends the results to the archive strictly in order.
+    QList<QFuture<void> > running;
+    QList<size_t> running_ends;
+    size_t scheduled = 0;
+    size_t completed = 0;
+    auto schedule_batch = [&]() {
+        if (scheduled >= blocks.size()) return;
+        size_t start = scheduled;
+        qint64 batch_size = 0;
+        while ((scheduled < blocks.size()) &&
+               ((scheduled == start) || (batch_size + blocks[scheduled].length <= DEFLATE_BATCH_SIZE))) {
+            batch_size += blocks[scheduled].length;
+            scheduled++;
+        }
+        running.append(QtConcurrent::map(blocks.begin() + start, blocks.begin() + scheduled, DeflateOneBlock));
+        running_ends.append(scheduled);
+    };
+    // The workers must be finished with the blocks before we bail out
+    auto abandon = [&]() {
+        foreach(QFuture<void> future, running) {
+            future.waitForFinished();
+        }
+        if (sfile) unzClose(sfile);
+        zipClose(zfile, NULL);
+        QFile::remove(tempFile);
+    };
+    schedule_batch();
+    schedule_batch();
 
-        QFileInfo tfile(it.filePath());
+    for (size_t e = 0; e < entries.size(); ++e) {
+        const ExportEntry &entry = entries[e];
+
+        if (entry.filecrc.isEmpty()) {
+            abandon();
+            throw(CannotOpenFile(entry.relpath.toStdString()));
+        }
 
         // Set the proper zip file info if possible
         QString amodified = modified_now;
-        size_t afilesize = tfile.size();
-        QString afilecrc = Utility::FileCRC32(it.filePath());
-        Resource* resource = m_Book->GetFolderKeeper()->GetResourceByBookPathNoThrow(relpath);
+        Resource* resource = entry.resource;
         if (resource) {
             QString savedcrc  = resource->GetSavedCRC32();
             QString saveddate = resource->GetSavedDate();
             size_t savedsize = resource->GetSavedSize();
-            if ( (savedsize == afilesize) && (savedcrc == afilecrc) ) {
+            if ( (savedsize == entry.filesize) && (savedcrc == entry.filecrc) ) {
                 amodified = saveddate;
             } else {
                 resource->SetSavedDate(amodified);
-                resource->SetSavedSize(afilesize);
-                resource->SetSavedCRC32(afilecrc);
+                resource->SetSavedSize(entry.filesize);
+                resource->SetSavedCRC32(entry.filecrc);
             }
         }
         QDateTime moddate = QDateTime::fromString(amodified, "yyyy-MM-dd hh:mm:ss");
@@ -201,56 +601,63 @@ void ExportEPUB::SaveFolderAsEpubToLocation(const QString &fullfolderpath, const
         fileInfo.tmz_date.tm_mon  = moddate.date().month() - 1;
         fileInfo.tmz_date.tm_year = moddate.date().year();
 
-        // Add the file entry to the archive.
-        // We should check the uncompressed file size. If it's over >= 0xffffffff the last parameter (zip64) should be 1.
-        if (zipOpenNewFileInZip4_64(zfile, relpath.toUtf8().constData(), &fileInfo, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 8, 0, 15, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 1<<11, 0) != ZIP_OK) {
-            zipClose(zfile, NULL);
-            QFile::remove(tempFile);
-            throw(CannotStoreFile(relpath.toStdString()));
+        if (entry.raw_copy) {
+            if (!CopyRawEntry(zfile, sfile, entry.source_pos, entry.relpath, fileInfo)) {
+                abandon();
+                throw(CannotStoreFile(entry.relpath.toStdString()));
+            }
+            continue;
         }
 
-        // the file on disk to write
-        QFile dfile(it.filePath());
-
-        if (!dfile.open(QIODevice::ReadOnly)) {
-            zipCloseFileInZip(zfile);
-            zipClose(zfile, NULL);
-            QFile::remove(tempFile);
-            throw(CannotOpenFile(it.fileName().toStdString()));
+        // Add the file entry to the archive. The data is already deflated so it is
+        // written in raw mode. If the uncompressed file size is >= 0xffffffff zip64 is needed.
+        int zip64 = (entry.filesize >= 0xffffffff) ? 1 : 0;
+        if (zipOpenNewFileInZip4_64(zfile, entry.relpath.toUtf8().constData(), &fileInfo, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 8, 1, 15, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 1<<11, zip64) != ZIP_OK) {
+            abandon();
+            throw(CannotStoreFile(entry.relpath.toStdString()));
         }
 
-        // Write the data from the file on disk into the archive.
-        char buff[BUFF_SIZE] = {0};
-        qint64 read = 0;
-
-        while ((read = dfile.read(buff, BUFF_SIZE)) > 0) {
-            if (zipWriteInFileInZip(zfile, buff, read) != ZIP_OK) {
-                dfile.close();
-                zipCloseFileInZip(zfile);
-                zipClose(zfile, NULL);
-                QFile::remove(tempFile);
-                throw(CannotStoreFile(relpath.toStdString()));
+        for (int i = entry.first_block; i < entry.first_block + entry.block_count; ++i) {
+            // wait for the batch holding this block
+            while (((size_t)i >= completed) && !running.isEmpty()) {
+                running.first().waitForFinished();
+                running.removeFirst();
+                completed = running_ends.takeFirst();
+                schedule_batch();
+            }
+            DeflateBlock &block = blocks[i];
+            if (!block.ok || (zipWriteInFileInZip(zfile, block.data.constData(), block.data.size()) != ZIP_OK)) {
+                zipCloseFileInZipRaw64(zfile, entry.filesize, entry.filecrc.toULong(NULL, 16));
+                abandon();
+                throw(CannotStoreFile(entry.relpath.toStdString()));
             }
+            // release the memory as soon as it has been written
+            block.data = QByteArray();
         }
 
-        dfile.close();
-
-        // There was an error reading the file on disk.
-        if (read < 0) {
-            zipCloseFileInZip(zfile);
-            zipClose(zfile, NULL);
-            QFile::remove(tempFile);
-            throw(CannotStoreFile(relpath.toStdString()));
+        if (zipCloseFileInZipRaw64(zfile, entry.filesize, entry.filecrc.toULong(NULL, 16)) != ZIP_OK) {
+            abandon();
+            throw(CannotStoreFile(entry.relpath.toStdString()));
         }
+    }
 
-        if (zipCloseFileInZip(zfile) != ZIP_OK) {
-            zipClose(zfile, NULL);
-            QFile::remove(tempFile);
-            throw(CannotStoreFile(relpath.toStdString()));
+    if (sfile) unzClose(sfile);
+    if (zipClose(zfile, NULL) != ZIP_OK) {
+        QFile::remove(tempFile);
+        throw(CannotWriteFile(tempFile.toStdString()));
+    }
+
+    if (rename_into_place) {
+        if (destination_info.exists()) {
+            CopyFileAttributes(fullfilepath, tempFile);
+        }
+        if (ReplaceFile(tempFile, fullfilepath)) {
+            return;
         }
+        // some file systems (or sharing violations) refuse the rename,
+        // so fall back to writing the data through the existing file
     }
 
-    zipClose(zfile, NULL);
     // Overwrite the contents of the real file with the contents from the temp
     // file we saved the data do. We do this instead of simply copying the file
     // because a file copy will lose extended attributes such as labels on OS X.
@@ -296,25 +703,24 @@ void ExportEPUB::SaveFolderAsEpubToLocation(const QString &fullfolderpath, const
 }
 
 
-void ExportEPUB::CreateEncryptionXML(const QString &fullfolderpath)
+QByteArray ExportEPUB::CreateEncryptionXML()
 {
-    QTemporaryFile file;
+    QBuffer buffer;
 
-    if (!file.open()) {
-    std::string msg = file.fileName().toStdString() + ": " + file.errorString().toStdString();
-        throw (CannotOpenFile(msg));
+    if (!buffer.open(QIODevice::WriteOnly)) {
+        throw (CannotOpenFile(ENCRYPTION_XML_FILE_NAME.toStdString()));
     }
 
-    EncryptionXmlWriter enc(m_Book.data(), file);
+    EncryptionXmlWriter enc(m_Book.data(), buffer);
     enc.WriteXML();
-    // Write to disk immediately
-    file.flush();
-    QFile::copy(file.fileName(), fullfolderpath + "/" + ENCRYPTION_XML_FILE_NAME);
+    buffer.close();
+    return buffer.data();
 }
 
 
-void ExportEPUB::ObfuscateFonts(const QString &fullfolderpath)
+QHash<QString, std::pair<QString, QString> > ExportEPUB::GetFontObfuscations()
 {
+    QHash<QString, std::pair<QString, QString> > font_obfuscations;
     QString uuid_id = m_Book->GetOPF()->GetUUIDIdentifierValue();
     QString main_id = m_Book->GetPublicationIdentifier();
     QList<FontResource *> font_resources = m_Book->GetFolderKeeper()->GetResourceTypeList<FontResource>();
@@ -325,12 +731,16 @@ void ExportEPUB::ObfuscateFonts(const QString &fullfolderpath)
             continue;
         }
 
-        QString font_path = fullfolderpath + "/" + font_resource->GetRelativePath();
+        QString identifier = (algorithm == ADOBE_FONT_ALGO_ID) ? uuid_id : main_id;
 
-        if (algorithm == ADOBE_FONT_ALGO_ID) {
-            FontObfuscation::ObfuscateFile(font_path, algorithm, uuid_id);
-        } else {
-            FontObfuscation::ObfuscateFile(font_path, algorithm, main_id);
+        // the fonts are only obfuscated while being written out,
+        // so refuse anything that could not be up front
+        if (((algorithm != ADOBE_FONT_ALGO_ID) && (algorithm != IDPF_FONT_ALGO_ID)) || identifier.isEmpty()) {
+            std::string msg = font_resource->GetRelativePath().toStdString() + ": " + algorithm.toStdString() + ": " + identifier.toStdString();
+            throw(FontObfuscationError(msg));
         }
+
+        font_obfuscations[font_resource->GetRelativePath()] = std::make_pair(algorithm, identifier);
     }
+    return font_obfuscations;
 }
@@ -24,6 +24,11 @@
 #ifndef EXPORTEPUB_H
 #define EXPORTEPUB_H
 
+#include <utility>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+
 #include "BookManipulation/FolderKeeper.h"
 #include "BookManipulation/Book.h"
 #include "Exporters/Exporter.h"
@@ -47,22 +52,23 @@ public:
 
 private:
 
-    // Creates the publication from the Book
-    // (creates XHTML, CSS, OPF, NCX files etc.)
-    void virtual CreatePublication(const QString &fullfolderpath);
-
     // Saves the publication in the specified folder
     // to the specified file path as an epub;
-    // the second optional parameter specifies the
-    // mimetype to write to the special "mimetype" file
-    void SaveFolderAsEpubToLocation(const QString &fullfolderpath, const QString &fullfilepath);
-
-    // Creates the publication's encryption.xml file,
-    // if there are any fonts to obfuscate
-    void CreateEncryptionXML(const QString &fullfolderpath);
-
-    // Obfuscates the fonts marked for obfuscation
-    void ObfuscateFonts(const QString &fullfolderpath);
+    // fonts listed in font_obfuscations (book relative path to
+    // algorithm and key) are obfuscated as they are written, and
+    // generated_files (book relative path to contents) are added
+    // in place of any file with the same path in the folder
+    void SaveFolderAsEpubToLocation(const QString &fullfolderpath, const QString &fullfilepath,
+                                    const QHash<QString, std::pair<QString, QString> > &font_obfuscations,
+                                    const QHash<QString, QByteArray> &generated_files);
+
+    // Returns the publication's encryption.xml file,
+    // used when there are any fonts to obfuscate
+    QByteArray CreateEncryptionXML();
+
+    // Returns the algorithm and key of the fonts marked
+    // for obfuscation, keyed by their book relative path
+    QHash<QString, std::pair<QString, QString> > GetFontObfuscations();
 
     ///////////////////////////////
     // PROTECTED MEMBER VARIABLES
@@ -73,8 +73,6 @@
 // Set Max length to 256 because that's the max path size on many systems.
 #define MAX_PATH 256
 #endif
-// This is the same read buffer size used by Java and Perl.
-#define BUFF_SIZE 8192
 
 const QString DUBLIN_CORE_NS             = "http://purl.org/dc/elements/1.1/";
 static const QString OEBPS_MIMETYPE      = "application/oebps-package+xml";
@@ -418,6 +416,8 @@ void ImportEPUB::ProcessFontFiles(const QList<Resource *> &resources,
     }
 }
 
+// The central directory is read first, validating every name and creating
+// the folders, then the entries are inflated in parallel, see Utility::UnZipTargets().
 void ImportEPUB::ExtractContainer()
 {
     int res = 0;
@@ -436,6 +436,13 @@ void ImportEPUB::ExtractContainer()
         throw (EPUBLoadParseError(QString(QObject::tr("Cannot unzip EPUB: %1")).arg(QDir::toNativeSeparators(m_FullFilePath)).toStdString()));
     }
 
+    QList<Utility::UnZipTarget> targets;
+    QStringList target_names;
+    QHash<QString, int> target_index;
+    QList<std::pair<QString, QString> > cp437_copies;
+    QHash<QString, std::tuple<size_t, QString, QString> > file_info_from_zip;
+    QHash<QString, QByteArray> zip_entry_names;
+
     // Note: zip archives can do utf-8 but they do NOT have a standard for Unicode NormalizationForm
     // we will choose to use NFC
     res = unzGoToFirstFile(zfile);
@@ -507,7 +514,6 @@ void ImportEPUB::ExtractContainer()
                 }
 
                 if (evil_or_corrupt_epub) {
-                    unzCloseCurrentFile(zfile);
                     unzClose(zfile);
                     throw (EPUBLoadParseError(QString(QObject::tr("Possible evil or corrupt epub file name: %1")).arg(original_path).toStdString()));
                 }
@@ -537,63 +543,62 @@ void ImportEPUB::ExtractContainer()
                     }
                 }
 
-                // Open the file entry in the archive for reading.
-                if (unzOpenCurrentFile(zfile) != UNZ_OK) {
+                unz64_file_pos file_pos;
+                if (unzGetFilePos64(zfile, &file_pos) != UNZ_OK) {
                     unzClose(zfile);
                     throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(qfile_name).toStdString()));
                 }
-
-                // Open the file on disk to write the entry in the archive to.
-                QFile entry(file_path);
-
-                if (!entry.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-                    unzCloseCurrentFile(zfile);
-                    unzClose(zfile);
-                    throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(qfile_name).toStdString()));
-                }
-
-                // Buffered reading and writing.
-                char buff[BUFF_SIZE] = {0};
-                int read = 0;
-
-                while ((read = unzReadCurrentFile(zfile, buff, BUFF_SIZE)) > 0) {
-                    entry.write(buff, read);
-                }
-
-                entry.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner |
-                                     QFileDevice::ReadUser  | QFileDevice::WriteUser  |
-                                     QFileDevice::ReadOther);
-                entry.close();
-
-                // Read errors are marked by a negative read amount.
-                if (read < 0) {
-                    unzCloseCurrentFile(zfile);
-                    unzClose(zfile);
-                    throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(qfile_name).toStdString()));
+                Utility::UnZipTarget target;
+                target.pos_in_zip_directory = file_pos.pos_in_zip_directory;
+                target.num_of_file = file_pos.num_of_file;
+                target.uncompressed_size = file_info.uncompressed_size;
+                target.file_path = file_path;
+
+                // a later entry of the same name overwrote the earlier one
+                if (target_index.contains(file_path)) {
+                    targets[target_index.value(file_path)] = target;
+                    target_names[target_index.value(file_path)] = qfile_name;
+                } else {
+                    target_index.insert(file_path, targets.count());
+                    targets.append(target);
+                    target_names.append(qfile_name);
                 }
 
-                // The file was read but the CRC did not match.
-                // We don't check the read file size vs the uncompressed file size
-                // because if they're different there should be a CRC error.
-                if (unzCloseCurrentFile(zfile) == UNZ_CRCERROR) {
-                    unzClose(zfile);
-                    throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(qfile_name).toStdString()));
-                }
                 if (!cp437_file_name.isEmpty() && cp437_file_name != qfile_name) {
-                    QString cp437_file_path = m_ExtractedFolderPath + "/" + cp437_file_name;
-                    QFile::copy(file_path, cp437_file_path);
+                    cp437_copies.append(std::make_pair(file_path, m_ExtractedFolderPath + "/" + cp437_file_name));
                 }
-                m_FileInfoFromZip[bookpath] = std::make_tuple(afilesize, afilecrc, modified);
+                file_info_from_zip[bookpath] = std::make_tuple(afilesize, afilecrc, modified);
+                zip_entry_names[bookpath] = QByteArray(file_name);
             }
         } while ((res = unzGoToNextFile(zfile)) == UNZ_OK);
     }
 
+    unzClose(zfile);
+
     if (res != UNZ_END_OF_LIST_OF_FILE) {
-        unzClose(zfile);
         throw (EPUBLoadParseError(QString(QObject::tr("Cannot open EPUB: %1")).arg(QDir::toNativeSeparators(m_FullFilePath)).toStdString()));
     }
 
-    unzClose(zfile);
+    int failed = Utility::UnZipTargets(m_FullFilePath, targets,
+                                       QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                                       QFileDevice::ReadUser  | QFileDevice::WriteUser  |
+                                       QFileDevice::ReadOther);
+    if (failed != -1) {
+        throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(target_names.at(failed)).toStdString()));
+    }
+
+    for (const std::pair<QString, QString> &copy : cp437_copies) {
+        QFile::copy(copy.first, copy.second);
+    }
+
+    // only recorded once every entry was extracted, as before
+    for (auto it = file_info_from_zip.constBegin(); it != file_info_from_zip.constEnd(); ++it) {
+        m_FileInfoFromZip[it.key()] = it.value();
+    }
+    for (auto it = zip_entry_names.constBegin(); it != zip_entry_names.constEnd(); ++it) {
+        m_ZipEntryNames[it.key()] = it.value();
+    }
+    m_Book->SetSourceArchive(m_FullFilePath, m_ZipEntryNames);
 }
 
 void ImportEPUB::LocateOPF()
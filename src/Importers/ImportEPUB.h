@@ -240,6 +240,10 @@ private:
 
     QHash<QString, std::tuple<size_t, QString, QString> > m_FileInfoFromZip;
 
+    // the raw zip entry name for each bookpath, used on export
+    // to copy unchanged entries straight from the source epub
+    QHash<QString, QByteArray> m_ZipEntryNames;
+
     bool m_HasSpineItems;
     bool m_NCXNotInManifest;
     QString m_NCXId;
@@ -94,6 +94,7 @@
 #include "MainUI/ValidationResultsView.h"
 #include "Misc/HTMLSpellCheck.h"
 #include "Misc/HTMLSpellCheckML.h"
+#include "Misc/ImageInfoCache.h"
 #include "Misc/KeyboardShortcutManager.h"
 #include "Misc/Landmarks.h"
 #include "Misc/AriaRoles.h"
@@ -296,6 +297,9 @@ MainWindow::~MainWindow()
         m_ViewImage = NULL;
     }
 
+    // our book is closed, drop the Images report info kept for it
+    ImageInfoCache::instance().Clear();
+
 #ifdef Q_OS_MAC  // speeds cleaningup of old modal dialogs
     if (m_ClipboardHistorySelector) delete m_ClipboardHistorySelector;
     if (m_LinkOrStyleBookmark) delete m_LinkOrStyleBookmark;
@@ -5591,6 +5595,8 @@ void MainWindow::SetNewBook(QSharedPointer<Book> new_book)
     m_ClipEditor->SetBook(m_Book);
     m_SpellcheckEditor->SetBook(m_Book);
     SpellCheck::instance().clearIgnoredWords();
+    // the images of the old book are of no more use
+    ImageInfoCache::instance().Clear();
     ResetLinkOrStyleBookmark();
     SettingsStore settings;
     settings.setRenameTemplate("");
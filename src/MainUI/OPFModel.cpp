@@ -20,14 +20,17 @@
 **
 *************************************************************************/
 
+#include <algorithm>
 #include <limits>
 
+#include <QtCore/QSet>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QFileIconProvider>
 #include <QMessageBox>
 #include <QDebug>
 #include "BookManipulation/Book.h"
 #include "BookManipulation/FolderKeeper.h"
+#include "BookManipulation/ReferenceIndex.h"
 #include "MainUI/OPFModel.h"
 #include "MainUI/OPFModelItem.h"
 #include "Misc/SettingsStore.h"
@@ -95,9 +98,7 @@ void OPFModel::SetBook(QSharedPointer<Book> book)
 void OPFModel::Refresh()
 {
     m_RefreshInProgress = true;
-    InitializeModel();
-    SortFilesByFilenames();
-    SortHTMLFilesByReadingOrder();
+    UpdateModel();
     m_RefreshInProgress = false;
 }
 
@@ -176,57 +177,34 @@ QList <Resource *> OPFModel::GetResourceListInFolder(Resource::ResourceType reso
 // Get the index of the given resource regardless of folder
 QModelIndex OPFModel::GetModelItemIndex(Resource *resource, IndexChoice indexChoice)
 {
-    Resource::ResourceType resourceType = resource->Type();
-    QStandardItem *folder = NULL;
+    QStandardItem *item = GetItemForResource(resource);
 
-    if (resourceType == Resource::OPFResourceType || resourceType == Resource::NCXResourceType) {
-        folder = invisibleRootItem();
-    } else {
-        for (int i = 0; i < invisibleRootItem()->rowCount() && folder == NULL; ++i) {
-            QStandardItem *child = invisibleRootItem()->child(i);
-
-            if ((child == m_TextFolderItem && resourceType == Resource::HTMLResourceType) ||
-                (child == m_ImagesFolderItem &&
-                 (resourceType == Resource::ImageResourceType || resourceType == Resource::SVGResourceType)) ||
-                (child == m_StylesFolderItem &&
-                 (resourceType == Resource::CSSResourceType)) ||
-                (child == m_FontsFolderItem && resourceType == Resource::FontResourceType) ||
-                (child == m_MiscFolderItem &&
-                 (resourceType == Resource::PdfResourceType || resourceType == Resource::GenericResourceType || resourceType == Resource::XMLResourceType)) ||
-                (child == m_AudioFolderItem && resourceType == Resource::AudioResourceType) ||
-                (child == m_VideoFolderItem && resourceType == Resource::VideoResourceType)
-               ) {
-                folder = child;
-            }
-        }
+    if (item == NULL) {
+        return index(0, 0);
     }
 
-    return GetModelFolderItemIndex(folder, resource, indexChoice);
+    return GetModelFolderItemIndex(ParentItem(item), resource, indexChoice);
 }
 
 
 // Get the index of the given resource in a specific folder
 QModelIndex OPFModel::GetModelFolderItemIndex(QStandardItem const *folder, Resource *resource, IndexChoice indexChoice)
 {
-    if (folder != NULL) {
-        int rowCount = folder->rowCount();
+    QStandardItem *item = GetItemForResource(resource);
 
-        for (int i = 0; i < rowCount ; ++i) {
-            QStandardItem *item = folder->child(i);
-            const QString &identifier = item->data().toString();
-
-            if (!identifier.isEmpty() && identifier == resource->GetIdentifier()) {
-                if (folder != invisibleRootItem()) {
-                    if (indexChoice == IndexChoice_Previous && i > 0) {
-                        i--;
-                    } else if (indexChoice == IndexChoice_Next && (i + 1 < rowCount)) {
-                        i++;
-                    }
-                }
+    if (folder != NULL && item != NULL && ParentItem(item) == folder) {
+        int rowCount = folder->rowCount();
+        int i = item->row();
 
-                return index(i, 0, folder->index());
+        if (folder != invisibleRootItem()) {
+            if (indexChoice == IndexChoice_Previous && i > 0) {
+                i--;
+            } else if (indexChoice == IndexChoice_Next && (i + 1 < rowCount)) {
+                i++;
             }
         }
+
+        return index(i, 0, folder->index());
     }
 
     return index(0, 0);
@@ -307,6 +285,12 @@ void OPFModel::RowsRemovedHandler(const QModelIndex &parent, int start, int end)
 void OPFModel::ItemChangedHandler(QStandardItem *item)
 {
     Q_ASSERT(item);
+
+    // Refresh updates items in place, that is not a rename
+    if (m_RefreshInProgress) {
+        return;
+    }
+
     const QString &identifier = item->data().toString();
 
     if (!identifier.isEmpty()) {
@@ -433,7 +417,8 @@ bool OPFModel:: RenameResourceList(const QList<Resource *> &resources, const QSt
     }
 
     if (update.count() > 0) {
-        UniversalUpdates::PerformUniversalUpdates(true, m_Book->GetFolderKeeper()->GetResourceList(), update);
+        // only the files that refer to what was renamed, or were renamed themselves
+        UniversalUpdates::PerformUniversalUpdates(true, m_Book->GetReferenceIndex()->GetResourcesToUpdate(update), update);
         emit BookContentModified();
     }
 
@@ -522,7 +507,8 @@ bool OPFModel::MoveResourceList(const QList<Resource *> &resources, const QStrin
     }
 
     if (update.count() > 0) {
-        UniversalUpdates::PerformUniversalUpdates(true, m_Book->GetFolderKeeper()->GetResourceList(), update);
+        // only the files that refer to what was moved, or were moved themselves
+        UniversalUpdates::PerformUniversalUpdates(true, m_Book->GetReferenceIndex()->GetResourcesToUpdate(update), update);
         emit BookContentModified();
     }
 
@@ -536,25 +522,25 @@ bool OPFModel::MoveResourceList(const QList<Resource *> &resources, const QStrin
     return false;
 }
 
-void OPFModel::InitializeModel()
+// Brings the model in line with the book by applying only the
+// differences: items of new resources are inserted, items of
+// removed resources are deleted, the remaining items are updated
+// in place and only the rows that are out of order are moved.
+// Untouched rows keep their selection and the folders stay expanded.
+void OPFModel::UpdateModel()
 {
     Q_ASSERT(m_Book);
-    ClearModel();
     QList<Resource *> resources = m_Book->GetFolderKeeper()->GetResourceList();
     QHash <Resource *, int> reading_order_all = m_Book->GetOPF()->GetReadingOrderAll(resources);
     QString version = m_Book->GetConstOPF()->GetEpubVersion();
     QHash <QString, QStringList> semantic_type_all;
     QHash <QString, QString> manifest_properties_all;
-    // temp storage to that items can be block added for each folder type
-    // to save on signal generation
-    QList<QStandardItem*> html_items;
-    QList<QStandardItem*> css_items;
-    QList<QStandardItem*> img_items;
-    QList<QStandardItem*> font_items;
-    QList<QStandardItem*> misc_items;
-    QList<QStandardItem*> audio_items;
-    QList<QStandardItem*> video_items;
-    
+    QList<QStandardItem *> folders = FolderItems();
+    // the wanted children of each folder in resource order
+    QHash<QStandardItem *, QList<QStandardItem *> > folder_items;
+    QList<QStandardItem *> root_items;
+    QSet<QStandardItem *> kept_items(folders.begin(), folders.end());
+
     SettingsStore ss;
     if (version.startsWith('3')) {
         NavProcessor navproc(m_Book->GetConstOPF()->GetNavResource());
@@ -563,91 +549,229 @@ void OPFModel::InitializeModel()
     } else { 
         semantic_type_all = m_Book->GetOPF()->GetGuideSemanticNameForPaths();
     }
-    
-    foreach(Resource * resource, resources) {
-        AlphanumericItem * item;
-        QIcon fileicon = m_Book->GetFolderKeeper()->GetFileIconFromMediaType(resource->GetMediaType());
-        if (ss.showFullPathOn()) {
-            item = new AlphanumericItem(fileicon, resource->GetRelativePath());
+
+    // the items already in the model by resource identifier
+    QHash<QString, QStandardItem *> existing_items;
+    for (int i = 0; i < invisibleRootItem()->rowCount(); ++i) {
+        QStandardItem *child = invisibleRootItem()->child(i);
+        if (folders.contains(child)) {
+            for (int j = 0; j < child->rowCount(); ++j) {
+                existing_items.insert(child->child(j)->data().toString(), child->child(j));
+            }
         } else {
-            item = new AlphanumericItem(fileicon, resource->ShortPathName());
+            existing_items.insert(child->data().toString(), child);
         }
-        item->setDropEnabled(false);
-        item->setData(resource->GetIdentifier());
-        QString tooltip = resource->GetRelativePath();
+    }
+
+    foreach(Resource * resource, resources) {
+        Resource::ResourceType type = resource->Type();
+        QStandardItem *folder = NULL;
+
+        if (type == Resource::HTMLResourceType) {
+            folder = m_TextFolderItem;
+        } else if (type == Resource::CSSResourceType) {
+            folder = m_StylesFolderItem;
+        } else if (type == Resource::ImageResourceType || type == Resource::SVGResourceType) {
+            folder = m_ImagesFolderItem;
+        } else if (type == Resource::FontResourceType) {
+            folder = m_FontsFolderItem;
+        } else if (type == Resource::AudioResourceType) {
+            folder = m_AudioFolderItem;
+        } else if (type == Resource::VideoResourceType) {
+            folder = m_VideoFolderItem;
+        } else if (type != Resource::OPFResourceType && type != Resource::NCXResourceType) {
+            folder = m_MiscFolderItem;
+        }
+
+        QString text = ss.showFullPathOn() ? resource->GetRelativePath() : resource->ShortPathName();
         QString path = resource->GetRelativePath();
-        if (resource->Type() == Resource::FontResourceType) {
-            FontResource* font_res = qobject_cast<FontResource *>(resource);
-            if (font_res) {
-                tooltip = tooltip + " (" + font_res->GetDescription() + ")";
+        QString tooltip = path;
+        // the OPF and NCX outside of the folders only show their path
+        if (folder != NULL) {
+            if (type == Resource::FontResourceType) {
+                FontResource* font_res = qobject_cast<FontResource *>(resource);
+                if (font_res) {
+                    tooltip = tooltip + " (" + font_res->GetDescription() + ")";
+                }
+            }
+            if (semantic_type_all.contains(path)) {
+                tooltip += " (" + semantic_type_all[path].join(",") + ")";
+            }
+            if (manifest_properties_all.contains(path)) {
+                tooltip += " [" + manifest_properties_all[path] + "]";
             }
         }
 
-        if (semantic_type_all.contains(path)) {
-            tooltip += " (" + semantic_type_all[path].join(",") + ")";
+        QStandardItem *item = existing_items.value(resource->GetIdentifier(), NULL);
+        QStandardItem *parent = folder ? folder : invisibleRootItem();
+        if (item != NULL && ParentItem(item) != parent) {
+            // it changed folders, the old item gets removed below
+            item = NULL;
         }
-        if (manifest_properties_all.contains(path)) {
-            tooltip += " [" + manifest_properties_all[path] + "]";
+
+        if (item == NULL) {
+            item = new AlphanumericItem(m_Book->GetFolderKeeper()->GetFileIconFromMediaType(resource->GetMediaType()), text);
+            item->setDropEnabled(false);
+            item->setData(resource->GetIdentifier());
+            if (folder == NULL) {
+                item->setEditable(true);
+            }
+            if (type != Resource::HTMLResourceType) {
+                item->setDragEnabled(false);
+            }
+        } else {
+            kept_items.insert(item);
+            if (item->text() != text) {
+                item->setText(text);
+            }
+            if (item->icon().isNull()) {
+                item->setIcon(m_Book->GetFolderKeeper()->GetFileIconFromMediaType(resource->GetMediaType()));
+            }
+        }
+        if (item->toolTip() != tooltip) {
+            item->setToolTip(tooltip);
         }
-        item->setToolTip(tooltip);
 
-        if (resource->Type() == Resource::HTMLResourceType) {
-            int reading_order = -1;
-            if (reading_order_all.contains(resource)) {
-                reading_order = reading_order_all[resource];
-            } else {
-                reading_order = NO_READING_ORDER;
+        if (type == Resource::HTMLResourceType) {
+            int reading_order = reading_order_all.value(resource, NO_READING_ORDER);
+            if (item->data(READING_ORDER_ROLE) != QVariant(reading_order)) {
+                item->setData(reading_order, READING_ORDER_ROLE);
             }
-            item->setData(reading_order, READING_ORDER_ROLE);
             // Remove the extension for alphanumeric sorting
-            QString name;
-            if (ss.showFullPathOn()) {
-                name = resource->GetRelativePath().left(resource->GetRelativePath().lastIndexOf('.'));
-            } else {
-                name = resource->ShortPathName().left(resource->ShortPathName().lastIndexOf('.'));
+            QString name = text.left(text.lastIndexOf('.'));
+            if (item->data(ALPHANUMERIC_ORDER_ROLE) != QVariant(name)) {
+                item->setData(name, ALPHANUMERIC_ORDER_ROLE);
             }
-            item->setData(name, ALPHANUMERIC_ORDER_ROLE);
-            html_items.append(item);
-        } else if (resource->Type() == Resource::CSSResourceType) {
-            item->setDragEnabled(false);
-            css_items.append(item);
-        } else if (resource->Type() == Resource::ImageResourceType ||
-                   resource->Type() == Resource::SVGResourceType
-                  ) {
-            item->setDragEnabled(false);
-            img_items.append(item);
-        } else if (resource->Type() == Resource::FontResourceType) {
-            item->setDragEnabled(false);
-            font_items.append(item);
-        } else if (resource->Type() == Resource::AudioResourceType) {
-            item->setDragEnabled(false);
-            audio_items.append(item);
-        } else if (resource->Type() == Resource::VideoResourceType) {
-            item->setDragEnabled(false);
-            video_items.append(item);
-        } else if (resource->Type() == Resource::PdfResourceType) {
-            item->setDragEnabled(false);
-            misc_items.append(item);
-        } else if (resource->Type() == Resource::OPFResourceType ||
-                   resource->Type() == Resource::NCXResourceType) {
-            // only 2 possible items here so do not group them
-            item->setEditable(true);
-            item->setDragEnabled(false);
-            item->setToolTip(resource->GetRelativePath());
-            appendRow(item);
+        }
+
+        if (folder == NULL) {
+            root_items.append(item);
         } else {
-            item->setDragEnabled(false);
-            misc_items.append(item);
+            folder_items[folder].append(item);
+        }
+    }
+
+    // remove the items of resources that are gone, a run of rows at a time
+    QList<QStandardItem *> parents = folders;
+    parents.append(invisibleRootItem());
+    foreach(QStandardItem * parent, parents) {
+        for (int i = parent->rowCount() - 1; i >= 0; --i) {
+            if (kept_items.contains(parent->child(i))) {
+                continue;
+            }
+            int last = i;
+            while (i > 0 && !kept_items.contains(parent->child(i - 1))) {
+                --i;
+            }
+            parent->removeRows(i, last - i + 1);
         }
     }
-    if ( !html_items.isEmpty()  ) m_TextFolderItem->   appendRows(html_items);
-    if ( !css_items.isEmpty()   ) m_StylesFolderItem-> appendRows(css_items);
-    if ( !img_items.isEmpty()   ) m_ImagesFolderItem-> appendRows(img_items);
-    if ( !font_items.isEmpty()  ) m_FontsFolderItem->  appendRows(font_items);
-    if ( !misc_items.isEmpty()  ) m_MiscFolderItem->   appendRows(misc_items);
-    if ( !audio_items.isEmpty() ) m_AudioFolderItem->  appendRows(audio_items);
-    if ( !video_items.isEmpty() ) m_VideoFolderItem->  appendRows(video_items);
 
+    // Same order as a full rebuild: all files by filename and then the
+    // HTML files by reading order. Both sorts are stable.
+    foreach(QStandardItem * folder, folders) {
+        QList<QStandardItem *> &items = folder_items[folder];
+        std::stable_sort(items.begin(), items.end(), [](QStandardItem *a, QStandardItem *b) {
+            return a->text().compare(b->text()) < 0;
+        });
+        if (folder == m_TextFolderItem) {
+            std::stable_sort(items.begin(), items.end(), [](QStandardItem *a, QStandardItem *b) {
+                return a->data(READING_ORDER_ROLE).toInt() < b->data(READING_ORDER_ROLE).toInt();
+            });
+        }
+        ApplyRowOrder(folder, items);
+    }
+    ApplyRowOrder(invisibleRootItem(), folders + root_items);
+
+    m_ItemIndexes.clear();
+    foreach(QStandardItem * folder, folders) {
+        for (int i = 0; i < folder->rowCount(); ++i) {
+            QStandardItem *item = folder->child(i);
+            m_ItemIndexes.insert(item->data().toString(), QPersistentModelIndex(item->index()));
+        }
+    }
+    foreach(QStandardItem * item, root_items) {
+        m_ItemIndexes.insert(item->data().toString(), QPersistentModelIndex(item->index()));
+    }
+}
+
+
+// Makes the children of parent exactly the given items in the given order.
+// New items are inserted, existing ones are only moved when out of place.
+void OPFModel::ApplyRowOrder(QStandardItem *parent, const QList<QStandardItem *> &items)
+{
+    if (parent->rowCount() == 0) {
+        // block add to save on signal generation
+        if (!items.isEmpty()) {
+            parent->appendRows(items);
+        }
+        return;
+    }
+
+    for (int i = 0; i < items.count(); ++i) {
+        QStandardItem *item = items.at(i);
+
+        if (i < parent->rowCount() && parent->child(i) == item) {
+            continue;
+        }
+
+        if (item->model() == this) {
+            parent->takeRow(item->row());
+        }
+
+        parent->insertRow(i, item);
+    }
+}
+
+
+QList<QStandardItem *> OPFModel::FolderItems() const
+{
+    // in the order they are shown
+    return QList<QStandardItem *>() << m_TextFolderItem << m_StylesFolderItem << m_ImagesFolderItem
+                                    << m_FontsFolderItem << m_AudioFolderItem << m_VideoFolderItem
+                                    << m_MiscFolderItem;
+}
+
+
+QStandardItem *OPFModel::ParentItem(QStandardItem *item)
+{
+    return item->parent() ? item->parent() : invisibleRootItem();
+}
+
+
+QStandardItem *OPFModel::GetItemForResource(Resource *resource)
+{
+    const QString &identifier = resource->GetIdentifier();
+    QPersistentModelIndex item_index = m_ItemIndexes.value(identifier);
+
+    if (item_index.isValid()) {
+        QStandardItem *item = itemFromIndex(item_index);
+        if (item && item->data().toString() == identifier) {
+            return item;
+        }
+    }
+
+    // Drag and drop replaces the moved items with copies, so a stale
+    // entry falls back to a scan and the item found is remembered.
+    QStandardItem *found = NULL;
+    QStandardItem *root = invisibleRootItem();
+    for (int i = 0; i < root->rowCount() && found == NULL; ++i) {
+        QStandardItem *child = root->child(i);
+        if (child->data().toString() == identifier) {
+            found = child;
+        }
+        for (int j = 0; j < child->rowCount() && found == NULL; ++j) {
+            if (child->child(j)->data().toString() == identifier) {
+                found = child->child(j);
+            }
+        }
+    }
+
+    if (found != NULL) {
+        m_ItemIndexes.insert(identifier, QPersistentModelIndex(found->index()));
+    }
+
+    return found;
 }
 
 
@@ -695,68 +819,6 @@ void OPFModel::UpdateHTMLReadingOrders()
 }
 
 
-void OPFModel::ClearModel()
-{
-    // block remove all items in each folder to reduce signal generation
-    
-    int rows = m_TextFolderItem->rowCount();
-    if ( rows > 0 ) m_TextFolderItem->removeRows(0, rows);
-
-    rows = m_StylesFolderItem->rowCount();
-    if ( rows > 0 ) m_StylesFolderItem->removeRows(0, rows);
-
-    rows = m_ImagesFolderItem->rowCount();
-    if ( rows > 0 ) m_ImagesFolderItem->removeRows(0, rows);
-
-    rows = m_FontsFolderItem->rowCount();
-    if ( rows > 0 ) m_FontsFolderItem->removeRows(0, rows);
-
-    rows = m_MiscFolderItem->rowCount();
-    if ( rows > 0 ) m_MiscFolderItem->removeRows(0, rows);
-
-    rows = m_AudioFolderItem->rowCount();
-    if ( rows > 0 ) m_AudioFolderItem->removeRows(0, rows);
-
-    rows = m_VideoFolderItem->rowCount();
-    if ( rows > 0 ) m_VideoFolderItem->removeRows(0, rows);
-
-    // grouping these non-folder items make no sense when
-    // there are only 2 items max
-    int i = 0;
-    while (i < invisibleRootItem()->rowCount()) {
-        QStandardItem *child = invisibleRootItem()->child(i, 0);
-
-        if (child != m_TextFolderItem   &&
-            child != m_StylesFolderItem &&
-            child != m_ImagesFolderItem &&
-            child != m_FontsFolderItem  &&
-            child != m_MiscFolderItem   &&
-            child != m_AudioFolderItem  &&
-            child != m_VideoFolderItem) {
-            invisibleRootItem()->removeRow(i);
-        } else {
-            ++i;
-        }
-    }
-}
-
-
-void OPFModel::SortFilesByFilenames()
-{
-    for (int i = 0; i < invisibleRootItem()->rowCount(); ++i) {
-        invisibleRootItem()->child(i)->sortChildren(0);
-    }
-}
-
-
-void OPFModel::SortHTMLFilesByReadingOrder()
-{
-    int old_sort_role = sortRole();
-    setSortRole(READING_ORDER_ROLE);
-    m_TextFolderItem->sortChildren(0);
-    setSortRole(old_sort_role);
-}
-
 void OPFModel::SortHTMLFilesByAlphanumeric(QList <QModelIndex> index_list)
 {
     // Get items for all selected indexes
@@ -24,6 +24,7 @@
 #ifndef OPFMODEL_H
 #define OPFMODEL_H
 
+#include <QtCore/QHash>
 #include <QtCore/QSharedPointer>
 #include <QtGui/QStandardItemModel>
 
@@ -67,8 +68,9 @@ public:
     void SetBook(QSharedPointer<Book> book);
 
     /**
-     * Forces the recreation of the model
-     * from the information in the stored book.
+     * Brings the model up to date with the information
+     * in the stored book. Only the items that changed are
+     * touched, so the view keeps its state.
      */
     void Refresh();
 
@@ -209,36 +211,48 @@ private slots:
 private:
 
     /**
-     * Initializes an empty model with data. It is filled
-     * using information from the stored book.
+     * Updates the model with information from the stored book
+     * by inserting, removing, updating and moving only the
+     * items that differ from it.
      */
-    void InitializeModel();
+    void UpdateModel();
 
     /**
-     * Updates the reading orders of the HTMLResources
-     * with their order in the model.
+     * Makes the given items the children of parent, in order.
+     * Items already in place are left alone.
+     *
+     * @param parent The folder (or root) item.
+     * @param items The wanted children.
      */
-    void UpdateHTMLReadingOrders();
+    void ApplyRowOrder(QStandardItem *parent, const QList<QStandardItem *> &items);
 
     /**
-     * Sorts \em all files by their filenames, alphabetically.
+     * Returns the folder items in display order.
      */
-    void SortFilesByFilenames();
+    QList<QStandardItem *> FolderItems() const;
 
     /**
-     * Sorts the HTML files by their reading orders.
+     * Returns the parent of an item, the root item
+     * for the top level ones.
      */
-    void SortHTMLFilesByReadingOrder();
+    QStandardItem *ParentItem(QStandardItem *item);
 
     /**
-     * Sorts the selected HTML files by alphanumeric order of filename
+     * Returns the item of a resource or NULL if
+     * the resource is not in the model.
      */
-    void SortHTMLFilesByAlphanumeric(QList <QModelIndex> index_list);
+    QStandardItem *GetItemForResource(Resource *resource);
 
     /**
-     * Removes all data from the model.
+     * Updates the reading orders of the HTMLResources
+     * with their order in the model.
      */
-    void ClearModel();
+    void UpdateHTMLReadingOrders();
+
+    /**
+     * Sorts the selected HTML files by alphanumeric order of filename
+     */
+    void SortHTMLFilesByAlphanumeric(QList <QModelIndex> index_list);
 
     /**
      * Determines if a new filename is valid. If it is not,
@@ -280,6 +294,12 @@ private:
      */
     QSharedPointer<Book> m_Book;
 
+    /**
+     * The model index of each resource item
+     * keyed by resource identifier.
+     */
+    QHash<QString, QPersistentModelIndex> m_ItemIndexes;
+
     QStandardItem *m_TextFolderItem;   /**< The Text folder item. */
     QStandardItem *m_StylesFolderItem; /**< The Styles folder item. */
     QStandardItem *m_ImagesFolderItem; /**< The Images folder item. */
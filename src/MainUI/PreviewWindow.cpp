@@ -43,6 +43,7 @@
 
 #include "MainUI/PreviewWindow.h"
 #include "Dialogs/Inspector.h"
+#include "Parsers/DOMDiff.h"
 #include "Parsers/GumboInterface.h"
 #include "Misc/SleepFunctions.h"
 #include "Misc/SettingsStore.h"
@@ -375,8 +376,7 @@ bool PreviewWindow::UpdatePage(QString filename_url, QString text, QList<Element
 
 
     //if isDarkMode is set, inject a local style in head
-    SettingsStore settings;
-    if (Utility::IsDarkMode() && settings.previewDark()) {
+    if (Utility::IsDarkMode() && SettingsStore::snapshot()->previewDark) {
         text = Utility::AddDarkCSS(text);
         DBG qDebug() << "Preview injecting dark style: ";
     }
@@ -410,6 +410,24 @@ bool PreviewWindow::UpdatePage(QString filename_url, QString text, QList<Element
         }
     }
 
+    // If only the body changed since the last update, patch the page in
+    // place. That keeps its layout and scroll position, and MathJax does
+    // not have to typeset all of the math again.
+    QSharedPointer<GumboInterface> doc;
+    if (!text.isEmpty()) {
+        doc = QSharedPointer<GumboInterface>(new GumboInterface(text, "any_version"));
+        if (PatchPage(filename_url, text, *doc)) {
+            DBG qDebug() << "PV UpdatePage patched the page in place";
+            m_RenderedDoc = doc;
+            m_progress->reset();
+            m_updatingPage = false;
+            m_Preview->StoreCaretLocationUpdate(m_location);
+            m_Preview->ExecuteCaretUpdate();
+            return true;
+        }
+    }
+
+    m_RenderedDoc = doc;
     m_Filepath = filename_url;
     m_Preview->CustomSetDocument(filename_url, text, m_cache_clear_needed);
 
@@ -417,6 +435,22 @@ bool PreviewWindow::UpdatePage(QString filename_url, QString text, QList<Element
     return true;
 }
 
+bool PreviewWindow::PatchPage(const QString &filename_url, const QString &text, const GumboInterface &doc)
+{
+    if (m_cache_clear_needed || !m_RenderedDoc || (filename_url != m_Filepath) ||
+        !m_Preview->IsLoadingFinished()) {
+        return false;
+    }
+
+    QList<DOMDiff::PatchOp> ops;
+    if (!DOMDiff::Diff(*m_RenderedDoc, doc, ops)) {
+        return false;
+    }
+
+    DBG qDebug() << "PV PatchPage with " << ops.count() << " changes";
+    return ops.isEmpty() || m_Preview->PatchDocument(filename_url, text, DOMDiff::ToJSON(ops));
+}
+
 void PreviewWindow::UpdatePageDone()
 {
     // ignore spurious page DocumentLoaded signals from ViewPreview
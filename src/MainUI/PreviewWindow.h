@@ -31,6 +31,7 @@
 #include <QWebEngineView>
 #include <QtWidgets/QDockWidget>
 #include <QStringList>
+#include <QSharedPointer>
 #include <ViewEditors/Viewer.h>
 #include <Dialogs/Inspector.h>
 
@@ -45,6 +46,7 @@ class WebViewPrinter;
 class QToolButton;
 class QWidget;
 class QFocusFrame;
+class GumboInterface;
 
 class PreviewWindow : public QDockWidget
 {
@@ -128,6 +130,7 @@ private:
     void ConnectSignalsToSlots();
     void UpdateWindowTitle();
     bool fixup_fullscreen_svg_images(const QString &text);
+    bool PatchPage(const QString &filename_url, const QString &text, const GumboInterface &doc);
     
     const QString titleText();
 
@@ -150,6 +153,9 @@ private:
     QString m_Filepath;
     QString m_titleText;
 
+    // the parsed xhtml last sent to the page, what patches are computed against
+    QSharedPointer<GumboInterface> m_RenderedDoc;
+
     QString m_mathjaxurl;
     QStringList m_usercssurls;
 
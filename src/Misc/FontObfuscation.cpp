@@ -55,31 +55,22 @@ QByteArray AdobeKeyFromIdentifier(const QString &identifier)
 }
 
 
-void IdpfObfuscate(const QString &filepath, const QString &identifier)
+// XORs the bytes of data that fall within the first num_bytes of the
+// font file with the key. data starts at offset in that file.
+void XorWithKey(QByteArray &data, qint64 offset, const QByteArray &key, int num_bytes)
 {
-    QFile file(filepath);
-
-    if (!file.open(QFile::ReadWrite)) {
-        return;
-    }
-
-    QByteArray contents = file.readAll();
-    QByteArray key = IdpfKeyFromIdentifier(identifier);
-    int key_size   = key.size();
+    int key_size = key.size();
     if (key_size == 0) {
         return;
     }
 
-    for (int i = 0; (i < IDPF_METHOD_NUM_BYTES) && (i < contents.size()); ++i) {
-        contents[ i ] = contents[ i ] ^ key[ i % key_size ];
+    for (qint64 i = offset; (i < num_bytes) && (i - offset < data.size()); ++i) {
+        data[ i - offset ] = data[ i - offset ] ^ key[ i % key_size ];
     }
-
-    file.seek(0);
-    file.write(contents);
 }
 
 
-void AdobeObfuscate(const QString &filepath, const QString &identifier)
+void ObfuscateFileContents(const QString &filepath, const QString &algorithm, const QString &identifier)
 {
     QFile file(filepath);
 
@@ -88,16 +79,7 @@ void AdobeObfuscate(const QString &filepath, const QString &identifier)
     }
 
     QByteArray contents = file.readAll();
-    QByteArray key = AdobeKeyFromIdentifier(identifier);
-    int key_size   = key.size();
-    if (key_size == 0) {
-        return;
-    }
-
-    for (int i = 0; (i < ADOBE_METHOD_NUM_BYTES) && (i < contents.size()); ++i) {
-        contents[ i ] = contents[ i ] ^ key[ i % key_size ];
-    }
-
+    FontObfuscation::ObfuscateBuffer(contents, 0, algorithm, identifier);
     file.seek(0);
     file.write(contents);
 }
@@ -116,10 +98,8 @@ void FontObfuscation::ObfuscateFile(const QString &filepath,
         throw(FontObfuscationError(msg));
     }
 
-    if (algorithm == ADOBE_FONT_ALGO_ID) {
-        AdobeObfuscate(filepath, identifier);
-    } else if (algorithm == IDPF_FONT_ALGO_ID) {
-        IdpfObfuscate(filepath, identifier);
+    if ((algorithm == ADOBE_FONT_ALGO_ID) || (algorithm == IDPF_FONT_ALGO_ID)) {
+        ObfuscateFileContents(filepath, algorithm, identifier);
     } else {
         std::string msg = filepath.toStdString() + ": " + algorithm.toStdString() + ": " + identifier.toStdString();
         throw(FontObfuscationError(msg));
@@ -127,3 +107,14 @@ void FontObfuscation::ObfuscateFile(const QString &filepath,
 }
 
 
+void FontObfuscation::ObfuscateBuffer(QByteArray &data,
+                                      qint64 offset,
+                                      const QString &algorithm,
+                                      const QString &identifier)
+{
+    if (algorithm == ADOBE_FONT_ALGO_ID) {
+        XorWithKey(data, offset, AdobeKeyFromIdentifier(identifier), ADOBE_METHOD_NUM_BYTES);
+    } else if (algorithm == IDPF_FONT_ALGO_ID) {
+        XorWithKey(data, offset, IdpfKeyFromIdentifier(identifier), IDPF_METHOD_NUM_BYTES);
+    }
+}
@@ -23,6 +23,9 @@
 #ifndef FONTOBFUSCATION_H
 #define FONTOBFUSCATION_H
 
+#include <QtCore/QtGlobal>
+
+class QByteArray;
 class QString;
 
 namespace FontObfuscation
@@ -30,6 +33,14 @@ namespace FontObfuscation
 void ObfuscateFile(const QString &filepath,
                    const QString &algorithm,
                    const QString &identifier);
+
+// Obfuscates (or deobfuscates, the operation is symmetric) in place a piece
+// of a font file's data that starts at offset within that file.
+// Unknown algorithms leave the data untouched.
+void ObfuscateBuffer(QByteArray &data,
+                     qint64 offset,
+                     const QString &algorithm,
+                     const QString &identifier);
 }
 
 #endif // FONTOBFUSCATION_H
@@ -50,14 +50,13 @@ QList<HTMLSpellCheck::MisspelledWord> HTMLSpellCheck::GetMisspelledWords(const Q
     bool in_invalid_word = false;
     bool in_entity = false;
     int word_start = 0;
-    SettingsStore ss;
-    bool use_nums = ss.spellCheckNumbers();
+    bool use_nums = SettingsStore::snapshot()->spellCheckNumbers;
     QRegularExpression search(search_regex);
     QList<HTMLSpellCheck::MisspelledWord> misspellings;
     // Make sure text has beginning/end boundary markers for easier parsing
     QString text = QChar(' ') + orig_text + QChar(' ');
     // Ignore <style...</style> wherever it appears - change to spaces to keep text positions
-    QRegularExpression style_re("<style[^<]*</style>");
+    static const QRegularExpression style_re("<style[^<]*</style>");
 
     QRegularExpressionMatchIterator i = style_re.globalMatch(text);
     while (i.hasNext()) {
@@ -33,8 +33,7 @@ QList<HTMLSpellCheckML::AWord> HTMLSpellCheckML::GetWordList(const QString &sour
 {
     QList<HTMLSpellCheckML::AWord> wordlist;
     QString wc = SpellCheck::instance().getWordChars() + QChar(0x00ad); // add in soft hyphen
-    SettingsStore ss;
-    bool use_nums = ss.spellCheckNumbers();
+    bool use_nums = SettingsStore::snapshot()->spellCheckNumbers;
     QuickParser qp(source, default_lang);
     while(true) {
         QuickParser::MarkupInfo mi = qp.parse_next();
@@ -120,8 +119,8 @@ bool HTMLSpellCheckML::IsBoundary(QChar prev_c, QChar c, QChar next_c, const QSt
 QList<HTMLSpellCheckML::AWord> HTMLSpellCheckML::GetWords(const QString &text, const QString &default_lang)
 {
     if (default_lang.isEmpty()) {
-        SettingsStore ss;
-        return GetWordList(text, ss.defaultMetadataLang().replace("_","-"));
+        QString lang = SettingsStore::snapshot()->defaultMetadataLang;
+        return GetWordList(text, lang.replace("_","-"));
     }
     return GetWordList(text, default_lang);
 }
@@ -132,8 +131,8 @@ QStringList HTMLSpellCheckML::GetAllWords(const QString &text, const QString& de
     QList<HTMLSpellCheckML::AWord> words;
 
     if (default_lang.isEmpty()) {
-        SettingsStore ss;
-        words = GetWordList(text, ss.defaultMetadataLang().replace("_","-"));
+        QString lang = SettingsStore::snapshot()->defaultMetadataLang;
+        words = GetWordList(text, lang.replace("_","-"));
     } else {
         words = GetWordList(text, default_lang);
     }
@@ -157,14 +156,13 @@ QString HTMLSpellCheckML::langOf(const QString& word)
 {
     int p = word.indexOf(":",0);
     if (p != -1) return word.mid(0,p);
-    SettingsStore ss;
-    return ss.defaultMetadataLang().replace("_","-");
+    QString lang = SettingsStore::snapshot()->defaultMetadataLang;
+    return lang.replace("_","-");
 }
 
 
 int HTMLSpellCheckML::WordPosition(QString text, QString word, int start_pos, const QString &default_lang)
 {
-    SettingsStore ss;
     QList<HTMLSpellCheckML::AWord> words = GetWordList(text, default_lang);
     foreach (HTMLSpellCheckML::AWord w, words) {
         if (w.offset < start_pos) {
@@ -0,0 +1,124 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <QtCore/QFileInfo>
+#include <QtConcurrent/QtConcurrent>
+#include <QImageReader>
+
+#include "Misc/ImageInfoCache.h"
+#include "Misc/Utility.h"
+#include "ResourceObjects/Resource.h"
+
+// enough for thousands of thumbnails at the default size
+static const int MAX_CACHE_COST_KB = 96 * 1024;
+
+ImageInfoCache::ImageInfoCache()
+    : m_Entries(MAX_CACHE_COST_KB)
+{
+}
+
+
+void ImageInfoCache::Clear()
+{
+    m_Entries.clear();
+}
+
+
+QList<ImageInfoCache::ImageInfo> ImageInfoCache::GetImageInfo(const QList<Resource *> &resources, int thumbnail_size)
+{
+    QList<ImageInfo> results;
+    QList<Job> jobs;
+    QList<int> job_rows;
+    for (int i = 0; i < resources.count(); i++) {
+        Resource *resource = resources.at(i);
+        Job job;
+        job.path = resource->GetFullPath();
+        job.svg = resource->Type() == Resource::SVGResourceType;
+        job.thumbnail_size = thumbnail_size;
+        QFileInfo fi(job.path);
+        job.size = fi.size();
+        job.modified = fi.lastModified();
+        job.generation = resource->GetWriteGeneration();
+        Entry *entry = m_Entries.object(job.path);
+        if (entry && (entry->size == job.size) && (entry->modified == job.modified) &&
+            (entry->generation == job.generation) && (entry->thumbnail_size == thumbnail_size)) {
+            results << entry->info;
+            continue;
+        }
+        results << ImageInfo();
+        jobs << job;
+        job_rows << i;
+    }
+
+    if (!jobs.isEmpty()) {
+        QtConcurrent::blockingMap(jobs, ComputeImageInfo);
+        for (int j = 0; j < jobs.count(); j++) {
+            const Job &job = jobs.at(j);
+            results[job_rows.at(j)] = job.info;
+            Entry *entry = new Entry();
+            entry->size = job.size;
+            entry->modified = job.modified;
+            entry->generation = job.generation;
+            entry->thumbnail_size = job.thumbnail_size;
+            entry->info = job.info;
+            m_Entries.insert(job.path, entry, 1 + job.info.thumbnail.sizeInBytes() / 1024);
+        }
+    }
+    return results;
+}
+
+
+// Runs on a worker thread. Only the pixels are needed to tell if an image is
+// grayscale or to make its thumbnail, the size alone comes from the header.
+void ImageInfoCache::ComputeImageInfo(Job &job)
+{
+    ImageInfo &info = job.info;
+    info.width = 0;
+    info.height = 0;
+    info.gray = false;
+
+    QImage image;
+    if (job.svg) {
+        image = Utility::RenderSvgToImage(job.path);
+    } else {
+        QImageReader reader(job.path);
+        QSize size = reader.size();
+        QImage::Format format = reader.imageFormat();
+        if (size.isValid() && (job.thumbnail_size == 0) &&
+            ((format == QImage::Format_Grayscale8) || (format == QImage::Format_Grayscale16))) {
+            info.width = size.width();
+            info.height = size.height();
+            info.gray = true;
+            return;
+        }
+        image = reader.read();
+    }
+    info.width = image.width();
+    info.height = image.height();
+    info.gray = image.allGray();
+    if (job.thumbnail_size) {
+        if ((image.height() > job.thumbnail_size) || (image.width() > job.thumbnail_size)) {
+            image = image.scaled(QSize(job.thumbnail_size, job.thumbnail_size), Qt::KeepAspectRatio);
+        }
+        info.thumbnail = image;
+    }
+}
@@ -0,0 +1,108 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef IMAGEINFOCACHE_H
+#define IMAGEINFOCACHE_H
+
+#include <QtCore/QCache>
+#include <QtCore/QDateTime>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtGui/QImage>
+
+class Resource;
+
+/**
+ * Singleton.
+ *
+ * Caches the width, height, grayscale state and thumbnail of image and
+ * svg resources for the Images report. Missing entries are computed on
+ * the global thread pool. An entry is reused for as long as the file's
+ * size and modification time and the resource's write generation are
+ * unchanged. Must only be used from the main thread.
+ */
+class ImageInfoCache
+{
+
+public:
+
+    struct ImageInfo {
+        int    width;
+        int    height;
+        bool   gray;
+        QImage thumbnail; // null if no thumbnail was asked for
+    };
+
+    static ImageInfoCache& instance() {
+        static ImageInfoCache the_instance;
+        return the_instance;
+    }
+
+    ImageInfoCache(const ImageInfoCache&) = delete;
+    ImageInfoCache& operator=(const ImageInfoCache&) = delete;
+
+    /**
+     * Returns the info for each resource in order, computing
+     * those not in the cache in parallel.
+     *
+     * @param resources The ImageResources and SVGResources.
+     * @param thumbnail_size The bounding size of the thumbnails, 0 for none.
+     */
+    QList<ImageInfo> GetImageInfo(const QList<Resource *> &resources, int thumbnail_size);
+
+    /**
+     * Drops every entry, done whenever a book is closed or replaced.
+     */
+    void Clear();
+
+private:
+
+    struct Job {
+        QString   path;
+        bool      svg;
+        int       thumbnail_size;
+        qint64    size;
+        QDateTime modified;
+        quint64   generation;
+        ImageInfo info;
+    };
+
+    struct Entry {
+        qint64    size;
+        QDateTime modified;
+        quint64   generation;
+        int       thumbnail_size;
+        ImageInfo info;
+    };
+
+    static void ComputeImageInfo(Job &job);
+
+    // constructor must be private since singleton
+    ImageInfoCache();
+    ~ImageInfoCache() = default;
+
+    // cost is in KB, mostly that of the thumbnails
+    QCache<QString, Entry> m_Entries;
+};
+
+#endif // IMAGEINFOCACHE_H
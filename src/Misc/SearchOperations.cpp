@@ -26,6 +26,7 @@
 #include <QtCore/QtCore>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QProgressDialog>
+#include <QtConcurrent/QtConcurrent>
 
 #include "BookManipulation/CleanSource.h"
 #include "Misc/SearchOperations.h"
@@ -39,20 +40,104 @@
 #include "EmbedPython/PythonRoutines.h"
 #include "sigil_constants.h"
 
+namespace
+{
+// One file of a book wide count or replace, its text is read and written
+// back on the main thread while the workers only ever see the copy here.
+struct FileSearchJob {
+    TextResource *resource;
+    quint64 revision;
+    QString text;
+    QString new_text;
+    int count;
+};
+
+// Runs the workers while keeping the progress dialog responsive.
+// Returns false if the user cancelled.
+bool WaitForSearchJobs(QFuture<void> future, QProgressDialog &progress)
+{
+    QFutureWatcher<void> watcher;
+    QEventLoop loop;
+    QObject::connect(&watcher, &QFutureWatcher<void>::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&watcher, &QFutureWatcher<void>::progressValueChanged, &progress, &QProgressDialog::setValue);
+    QObject::connect(&progress, &QProgressDialog::canceled, &watcher, &QFutureWatcher<void>::cancel);
+    watcher.setFuture(future);
+    if (!future.isFinished()) {
+        loop.exec();
+    }
+    future.waitForFinished();
+    return !future.isCanceled();
+}
+
+// Grabs the current text of every file on the main thread
+QList<FileSearchJob> CreateSearchJobs(const QList<Resource *> &resources)
+{
+    QList<FileSearchJob> jobs;
+    foreach(Resource * resource, resources) {
+        TextResource *text_resource = qobject_cast<TextResource *>(resource);
+        if (!text_resource) {
+            continue;
+        }
+        FileSearchJob job;
+        job.resource = text_resource;
+        {
+            QReadLocker locker(&text_resource->GetLock());
+            job.revision = text_resource->GetTextRevision();
+            job.text = text_resource->GetText();
+        }
+        job.count = 0;
+        jobs.append(job);
+    }
+    return jobs;
+}
+}
+
+
 int SearchOperations::CountInFiles(const QString &search_regex,
                                    QList<Resource *> resources,
-                                   bool check_spelling)
+                                   bool check_spelling,
+                                   QHash<Resource *, int> *file_counts)
 {
-    QProgressDialog progress(QObject::tr("Counting occurrences.."), 0, 0, resources.count(), Utility::GetMainWindow());
+    QProgressDialog progress(QObject::tr("Counting occurrences.."), QObject::tr("Cancel"), 0, resources.count(), Utility::GetMainWindow());
+    progress.setWindowModality(Qt::WindowModal);
     progress.setMinimumDuration(PROGRESS_BAR_MINIMUM_DURATION);
     int progress_value = 0;
     progress.setValue(progress_value);
-    // Count sequentially in order to see if occassional crashes are due to threading
     int count = 0;
-    foreach(Resource * resource, resources) {
-        progress.setValue(progress_value++);
-        qApp->processEvents();
-        count += CountInFile(search_regex, resource, check_spelling);
+
+    if (check_spelling) {
+        // The spellchecker is shared so misspelled words are counted one file at a time
+        foreach(Resource * resource, resources) {
+            progress.setValue(progress_value++);
+            qApp->processEvents();
+            if (progress.wasCanceled()) {
+                return 0;
+            }
+            int file_count = CountInFile(search_regex, resource, check_spelling);
+            if (file_counts) {
+                file_counts->insert(resource, file_count);
+            }
+            count += file_count;
+        }
+        return count;
+    }
+
+    // Every file is matched on the worker pool. The result does not depend
+    // on which thread got to a file first since we only sum the counts.
+    QSharedPointer<SPCRE> spcre = PCRECache::instance().getObject(search_regex);
+    QList<FileSearchJob> jobs = CreateSearchJobs(resources);
+    progress.setMaximum(jobs.count());
+    QFuture<void> future = QtConcurrent::map(jobs, [spcre](FileSearchJob &job) {
+        job.count = spcre->getEveryMatchInfo(job.text).count();
+    });
+    if (!WaitForSearchJobs(future, progress)) {
+        return 0;
+    }
+    foreach(const FileSearchJob &job, jobs) {
+        if (file_counts) {
+            file_counts->insert(job.resource, job.count);
+        }
+        count += job.count;
     }
     return count;
 }
@@ -60,18 +145,61 @@ int SearchOperations::CountInFiles(const QString &search_regex,
 
 int SearchOperations::ReplaceInAllFIles(const QString &search_regex,
                                         const QString &replacement,
-                                        QList<Resource *> resources)
+                                        QList<Resource *> resources,
+                                        QHash<Resource *, int> *file_counts)
 {
-    QProgressDialog progress(QObject::tr("Replacing search term..."), 0, 0, resources.count(), Utility::GetMainWindow());
+    QProgressDialog progress(QObject::tr("Replacing search term..."), QObject::tr("Cancel"), 0, resources.count(), Utility::GetMainWindow());
+    progress.setWindowModality(Qt::WindowModal);
     progress.setMinimumDuration(PROGRESS_BAR_MINIMUM_DURATION);
     int progress_value = 0;
     progress.setValue(progress_value);
-    // Replace sequentially in order to see if occassional crashes are due to threading
     int count = 0;
-    foreach(Resource * resource, resources) {
-        progress.setValue(progress_value++);
-        qApp->processEvents();
-        count += ReplaceInFile(search_regex, replacement, resource);
+
+    // Replacement functions run in the embedded python and stay sequential
+    QString replacer = replacement.trimmed();
+    if (replacer.startsWith("\\F<") && replacer.endsWith(">")) {
+        foreach(Resource * resource, resources) {
+            progress.setValue(progress_value++);
+            qApp->processEvents();
+            int file_count = ReplaceInFile(search_regex, replacement, resource);
+            if (file_counts) {
+                file_counts->insert(resource, file_count);
+            }
+            count += file_count;
+        }
+        return count;
+    }
+
+    // The new texts are built on the worker pool and nothing is written back
+    // until all of them are done, so cancelling leaves the book untouched.
+    QSharedPointer<SPCRE> spcre = PCRECache::instance().getObject(search_regex);
+    QList<FileSearchJob> jobs = CreateSearchJobs(resources);
+    progress.setMaximum(jobs.count());
+    QFuture<void> future = QtConcurrent::map(jobs, [spcre, &replacement](FileSearchJob &job) {
+        std::tie(job.new_text, job.count) = PerformGlobalReplace(job.text, spcre.data(), replacement);
+    });
+    if (!WaitForSearchJobs(future, progress)) {
+        return 0;
+    }
+
+    // Write back in book order on the main thread through the usual SetText
+    for (int i = 0; i < jobs.count(); ++i) {
+        FileSearchJob &job = jobs[i];
+        int file_count = job.count;
+        QWriteLocker locker(&job.resource->GetLock());
+        if (job.resource->GetTextRevision() != job.revision) {
+            // changed under us, redo this file against its current text
+            QString text = job.resource->GetText();
+            std::tie(job.new_text, file_count) = PerformGlobalReplace(text, spcre.data(), replacement);
+            job.text = text;
+        }
+        if (job.new_text != job.text) {
+            job.resource->SetText(job.new_text);
+        }
+        if (file_counts) {
+            file_counts->insert(job.resource, file_count);
+        }
+        count += file_count;
     }
     return count;
 }
@@ -156,7 +284,7 @@ int SearchOperations::ReplaceHTMLInFile(const QString &search_regex,
     int count;
     QString new_text;
     QString text = html_resource->GetText();
-    std::tie(new_text, count) = PerformGlobalReplace(text, search_regex, replacement);
+    std::tie(new_text, count) = PerformGlobalReplace(text, PCRECache::instance().getObject(search_regex).data(), replacement);
     if (new_text != text) {
         html_resource->SetText(new_text);
     }
@@ -172,7 +300,7 @@ int SearchOperations::ReplaceTextInFile(const QString &search_regex,
     int count;
     QString new_text;
     QString text = text_resource->GetText();
-    std::tie(new_text, count) = PerformGlobalReplace(text, search_regex, replacement);
+    std::tie(new_text, count) = PerformGlobalReplace(text, PCRECache::instance().getObject(search_regex).data(), replacement);
     if (new_text != text) {
         text_resource->SetText(new_text);
     }
@@ -181,23 +309,37 @@ int SearchOperations::ReplaceTextInFile(const QString &search_regex,
 
 
 std::tuple<QString, int> SearchOperations::PerformGlobalReplace(const QString &text,
-        const QString &search_regex,
+        SPCRE *spcre,
         const QString &replacement)
 {
-    QString new_text = text;
     int count = 0;
-    SPCRE *spcre = PCRECache::instance().getObject(search_regex);
     QList<SPCRE::MatchInfo> match_info = spcre->getEveryMatchInfo(text);
 
-    for (int i =  match_info.count() - 1; i >= 0; i--) {
-        QString match_segement = Utility::Substring(match_info.at(i).offset.first, match_info.at(i).offset.second, new_text);
+    if (match_info.isEmpty()) {
+        return std::make_tuple(text, count);
+    }
+
+    // Build the new text front to back in one pass instead of replacing
+    // each match inside the full text, which moved the whole tail every time.
+    QString new_text;
+    new_text.reserve(text.length() + text.length() / 8);
+    int last_end = 0;
+
+    for (int i = 0; i < match_info.count(); i++) {
+        const SPCRE::MatchInfo &info = match_info.at(i);
+        QString match_segement = Utility::Substring(info.offset.first, info.offset.second, text);
         QString replacement_text;
 
-        if (spcre->replaceText(match_segement, match_info.at(i).capture_groups_offsets, replacement, replacement_text)) {
-            new_text.replace(match_info.at(i).offset.first, match_info.at(i).offset.second - match_info.at(i).offset.first, replacement_text);
+        new_text.append(QStringView(text).mid(last_end, info.offset.first - last_end));
+        if (spcre->replaceText(match_segement, info.capture_groups_offsets, replacement, replacement_text)) {
+            new_text.append(replacement_text);
             count++;
+        } else {
+            new_text.append(match_segement);
         }
+        last_end = info.offset.second;
     }
+    new_text.append(QStringView(text).mid(last_end));
 
     return std::make_tuple(new_text, count);
 }
@@ -210,7 +352,7 @@ std::tuple<QString, int> SearchOperations::PerformHTMLSpellCheckReplace(const QS
     QString new_text = text;
     int count = 0;
     int offset = 0;
-    SPCRE *spcre = PCRECache::instance().getObject(search_regex);
+    QSharedPointer<SPCRE> spcre = PCRECache::instance().getObject(search_regex);
     QList<HTMLSpellCheck::MisspelledWord> check_spelling = HTMLSpellCheck::GetMisspelledWords(text, 0, text.length(), search_regex);
     foreach(HTMLSpellCheck::MisspelledWord misspelled_word, check_spelling) {
         SPCRE::MatchInfo match_info = spcre->getFirstMatchInfo(misspelled_word.text);
@@ -24,9 +24,12 @@
 #ifndef SEARCHOPERATIONS_H
 #define SEARCHOPERATIONS_H
 
+#include <QtCore/QHash>
+
 class Resource;
 class TextResource;
 class HTMLResource;
+class SPCRE;
 
 class SearchOperations
 {
@@ -35,18 +38,31 @@ public:
 
     /**
      * Returns the number of matching occurrences.
+     * The files are searched in parallel and the
+     * user can cancel from the progress dialog.
      *
      * @param search_regex The regex to match with.
-     * @return The number of matching occurrences.
+     * @param file_counts If not null, receives the count of every file.
+     * @return The number of matching occurrences, 0 if cancelled.
      */
     static int CountInFiles(const QString &search_regex,
                             QList<Resource *> resources,
-                            bool check_spelling = false);
+                            bool check_spelling = false,
+                            QHash<Resource *, int> *file_counts = NULL);
 
 
+    /**
+     * Replaces every match in the files and returns the number of
+     * replacements. The new texts are built in parallel and only
+     * written back once all of them are ready, so a cancelled
+     * replace (which returns 0) does not change any file.
+     *
+     * @param file_counts If not null, receives the count of every file.
+     */
     static int ReplaceInAllFIles(const QString &search_regex,
                                  const QString &replacement,
-                                 QList<Resource *> resources);
+                                 QList<Resource *> resources,
+                                 QHash<Resource *, int> *file_counts = NULL);
 
     static int FunctionReplaceInAllFiles(const QString &search_regex,
                                          const QString &function_name,
@@ -80,7 +96,7 @@ private:
                                  TextResource *text_resource);
 
     static std::tuple<QString, int> PerformGlobalReplace(const QString &text,
-            const QString &search_regex,
+            SPCRE *spcre,
             const QString &replacement);
 
     static std::tuple<QString, int> PerformHTMLSpellCheckReplace(const QString &text,
@@ -27,6 +27,7 @@
 #include <QPalette>
 #include <QFile>
 #include <QDir>
+#include <QMutex>
 
 #include "Misc/SettingsStore.h"
 #include "Misc/PluginDB.h"
@@ -142,6 +143,14 @@ static QString KEY_SPECIAL_CHARACTER_FONT_SIZE = SETTINGS_GROUP + "/" + "special
 static QString KEY_MAIN_MENU_ICON_SIZE = SETTINGS_GROUP + "/" + "main_menu_icon_size";
 static QString KEY_CLIPBOARD_HISTORY_LIMIT = SETTINGS_GROUP + "/" + "clipboard_history_limit";
 
+// Readers only hold the mutex to copy the shared pointer, a replaced
+// snapshot is freed when its last reader lets go of it. The generation
+// keeps a snapshot built from values that changed meanwhile from being
+// published.
+static QMutex s_SnapshotMutex;
+static QSharedPointer<const SettingsSnapshot> s_Snapshot;
+static quint64 s_SnapshotGeneration = 0;
+
 SettingsStore::SettingsStore()
     : QSettings(Utility::DefinePrefsDir() + "/" + SETTINGS_FILE, QSettings::IniFormat)
 {  
@@ -156,6 +165,63 @@ SettingsStore::SettingsStore(QString filename)
     // setIniCodec("UTF-8");
 }
 
+QSharedPointer<const SettingsSnapshot> SettingsStore::snapshot()
+{
+    quint64 generation;
+    {
+        QMutexLocker locker(&s_SnapshotMutex);
+        if (!s_Snapshot.isNull()) {
+            return s_Snapshot;
+        }
+        generation = s_SnapshotGeneration;
+    }
+    SettingsStore ss;
+    QSharedPointer<const SettingsSnapshot> fresh(ss.buildSnapshot());
+    QMutexLocker locker(&s_SnapshotMutex);
+    if ((generation == s_SnapshotGeneration) && s_Snapshot.isNull()) {
+        s_Snapshot = fresh;
+    }
+    return fresh;
+}
+
+SettingsSnapshot *SettingsStore::buildSnapshot()
+{
+    SettingsSnapshot *snap = new SettingsSnapshot();
+    snap->spellCheck = spellCheck();
+    snap->spellCheckNumbers = spellCheckNumbers();
+    snap->defaultMetadataLang = defaultMetadataLang();
+    snap->dictionary = dictionary();
+    snap->secondaryDictionary = secondary_dictionary();
+    snap->previewDark = previewDark();
+    snap->highlightOpenCloseTags = highlightOpenCloseTags();
+    return snap;
+}
+
+void SettingsStore::invalidateSnapshot()
+{
+    QMutexLocker locker(&s_SnapshotMutex);
+    s_SnapshotGeneration++;
+    s_Snapshot.reset();
+}
+
+void SettingsStore::setValue(const QString &key, const QVariant &value)
+{
+    QSettings::setValue(key, value);
+    invalidateSnapshot();
+}
+
+void SettingsStore::remove(const QString &key)
+{
+    QSettings::remove(key);
+    invalidateSnapshot();
+}
+
+void SettingsStore::clear()
+{
+    QSettings::clear();
+    invalidateSnapshot();
+}
+
 QString SettingsStore::uiLanguage()
 {
     clearSettingsGroup();
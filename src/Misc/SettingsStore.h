@@ -28,7 +28,9 @@
 
 #include <QColor>
 #include <QtCore/QSettings>
+#include <QtCore/QSharedPointer>
 #include <QtCore/QString>
+#include <QtCore/QVariant>
 #include <utility>
 
 #define CLEANON_OPEN         (1 << 0)
@@ -36,6 +38,22 @@
 
 class QColor;
 
+/**
+ * An immutable copy of the settings consulted on hot paths
+ * (highlighting, spellchecking, preview updates and the current line
+ * highlight followed by every find). It is rebuilt after any setting
+ * changed so readers never touch QSettings in between.
+ */
+struct SettingsSnapshot {
+    bool spellCheck;
+    bool spellCheckNumbers;
+    QString defaultMetadataLang;
+    QString dictionary;
+    QString secondaryDictionary;
+    int previewDark;
+    bool highlightOpenCloseTags;
+};
+
 /**
  * Provides access for reading and writing user configurable
  * settings. This should be used instead of QSettings because it
@@ -51,6 +69,20 @@ public:
     SettingsStore();
     SettingsStore(QString filename);
 
+    /**
+     * The current settings snapshot. Safe to call from any thread, the
+     * returned snapshot stays valid for as long as it is referenced.
+     */
+    static QSharedPointer<const SettingsSnapshot> snapshot();
+
+    /**
+     * These hide QSettings' own so that every change made
+     * through a SettingsStore invalidates the snapshot.
+     */
+    void setValue(const QString &key, const QVariant &value);
+    void remove(const QString &key);
+    void clear();
+
     /**
      * The langauge to use for the user interface
      *
@@ -455,6 +487,14 @@ private:
      * this class implements to be set in the wrong place.
      */
     void clearSettingsGroup();
+
+    /**
+     * Drops the published snapshot, the next call
+     * to snapshot() builds one from the new values.
+     */
+    static void invalidateSnapshot();
+
+    SettingsSnapshot *buildSnapshot();
 };
 
 #endif // SETTINGSSTORE_H
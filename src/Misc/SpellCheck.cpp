@@ -34,6 +34,8 @@
 #include <QMutexLocker>
 #include <QStringEncoder>
 #include <QStringDecoder>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
 #include <QDebug>
 
 #include <string>
@@ -47,6 +49,15 @@
 
 #define DBG if(0)
 
+// Words are handed to the spellcheck workers in batches of this size
+static const int SPELLCHECK_BATCH_SIZE = 2000;
+
+// Every hunspell instance holds its own copy of the dictionary in memory
+static const int MAX_HUNSPELL_INSTANCES = 8;
+
+// Once a verdict cache holds this many words it is started over
+static const int MAX_CACHED_VERDICTS = 100000;
+
 #if !defined(Q_OS_WIN32) && !defined(Q_OS_MAC)
 # include <stdlib.h>
 #endif
@@ -126,15 +137,14 @@ void SpellCheck::UnloadDictionary(const QString &dname)
 {
     DBG qDebug() << "In UnloadDictionary";
     QMutexLocker locker(&mutex);
+    clearVerdicts();
+    clearHunspellPool();
     if (m_opendicts.contains(dname)) {
         HDictionary hdic = m_opendicts[dname];
-        if (hdic.handle) {
-            delete hdic.encoder;
-            delete hdic.decoder;
-            delete hdic.handle;
-        }
+        closeHunspell(hdic);
         m_opendicts.remove(dname);
     }
+    m_extraWords.remove(dname);
 }
 
 void SpellCheck::UnloadAllDictionaries()
@@ -174,8 +184,7 @@ QStringList SpellCheck::dictionaries()
 QString SpellCheck::currentPrimaryDictionary() const
 {
     DBG qDebug() << "In currentPrimaryDictionary";
-    SettingsStore settings;
-    return settings.dictionary();
+    return SettingsStore::snapshot()->dictionary;
 }
 
 bool SpellCheck::spell(const QString &word)
@@ -191,13 +200,18 @@ bool SpellCheck::spell(const QString &word)
         loadDictionary(dname);
     }
     if (!m_opendicts.contains(dname)) return true;
+    QString text = HTMLSpellCheckML::textOf(word);
+    if (isIgnored(text)) return true;
+    QString key = dname + QChar(0) + text;
+    bool res;
+    if (cachedVerdict(m_verdicts, key, res)) return res;
     HDictionary hdic = m_opendicts[dname];
     Q_ASSERT(hdic.encoder != nullptr);
     Q_ASSERT(hdic.decoder != nullptr);
     Q_ASSERT(hdic.handle != nullptr);
-    QByteArray ba = hdic.encoder->encode(Utility::getSpellingSafeText(HTMLSpellCheckML::textOf(word)));
-    bool res = hdic.handle->spell(ba.toStdString());    
-    res = res || isIgnored(HTMLSpellCheckML::textOf(word));
+    QByteArray ba = hdic.encoder->encode(Utility::getSpellingSafeText(text));
+    res = hdic.handle->spell(ba.toStdString());    
+    storeVerdict(m_verdicts, key, res);
     return res;
 }
 
@@ -209,12 +223,62 @@ bool SpellCheck::spellPS(const QString &word)
 {
     if (!m_primary.handle) return true;
     if(m_ignoredWords.contains(word)) return true;
+    bool res;
+    if (cachedVerdict(m_verdictsPS, word, res)) return res;
     QByteArray pba = m_primary.encoder->encode(Utility::getSpellingSafeText(word));
-    bool res = m_primary.handle->spell(pba.toStdString());
-    if (res) return true;
-    if (!m_secondary.handle) return false;
-    QByteArray sba = m_secondary.encoder->encode(Utility::getSpellingSafeText(word));
-    return m_secondary.handle->spell(sba.toStdString());
+    res = m_primary.handle->spell(pba.toStdString());
+    if (!res && m_secondary.handle) {
+        QByteArray sba = m_secondary.encoder->encode(Utility::getSpellingSafeText(word));
+        res = m_secondary.handle->spell(sba.toStdString());
+    }
+    storeVerdict(m_verdictsPS, word, res);
+    return res;
+}
+
+
+bool SpellCheck::cachedVerdict(const QHash<QString, bool> &verdicts, const QString &key, bool &verdict) const
+{
+    QMutexLocker locker(&m_verdictMutex);
+    QHash<QString, bool>::const_iterator it = verdicts.constFind(key);
+    if (it == verdicts.constEnd()) {
+        m_verdictMisses++;
+        return false;
+    }
+    m_verdictHits++;
+    verdict = it.value();
+    return true;
+}
+
+
+void SpellCheck::storeVerdict(QHash<QString, bool> &verdicts, const QString &key, bool verdict)
+{
+    QMutexLocker locker(&m_verdictMutex);
+    if (verdicts.size() >= MAX_CACHED_VERDICTS) {
+        verdicts.clear();
+    }
+    verdicts.insert(key, verdict);
+}
+
+
+void SpellCheck::clearVerdicts()
+{
+    QMutexLocker locker(&m_verdictMutex);
+    m_verdicts.clear();
+    m_verdictsPS.clear();
+}
+
+
+quint64 SpellCheck::verdictCacheHits() const
+{
+    QMutexLocker locker(&m_verdictMutex);
+    return m_verdictHits;
+}
+
+
+quint64 SpellCheck::verdictCacheMisses() const
+{
+    QMutexLocker locker(&m_verdictMutex);
+    return m_verdictMisses;
 }
 
 
@@ -299,35 +363,53 @@ void SpellCheck::addWordToDictionary(const QString &word, const QString &dname)
         HDictionary hdic = m_opendicts[dname];
         QByteArray ba = hdic.encoder->encode(Utility::getSpellingSafeText(HTMLSpellCheckML::textOf(word)));
         hdic.handle->add(ba.toStdString());
+        m_extraWords[dname].append(word);
+        clearVerdicts();
+        // the extra instances do not know the word
+        clearHunspellPool();
     }
 }
 
 
-void SpellCheck::loadDictionary(const QString &dname)
+QStringList SpellCheck::extraDictionaryWords(const QString &dname)
 {
-    DBG qDebug() << "In loadDictionary: " << dname;
-    QMutexLocker locker(&mutex);
-    // If we don't have a dictionary we cannot continue.
-    if (dname.isEmpty() || !m_dictionaries.contains(dname)) {
-        qDebug() << "attempted to load a non-existent dictionary: " << dname;
-        return;
-    }
-
-    // Dictionary files to use.
-    QString aff = QString("%1%2.aff").arg(m_dictionaries.value(dname)).arg(dname);
-    QString dic = QString("%1%2.dic").arg(m_dictionaries.value(dname)).arg(dname);
     QString dic_delta = QString("%1/%2.dic_delta").arg(dictionaryDirectory()).arg(dname);
     QString alt_dic_delta = QString("%1%2.dic_delta").arg(m_dictionaries.value(dname)).arg(dname);
     // qDebug() << dic_delta;
     // qDebug() << alt_dic_delta;
 
+    // check for appropriate .dic_delta file and add it
+    // check in user prefs hunspell_dictionaries first
+    // so that user's version is given preference over 
+    // any system version
+    QStringList words;
+    if (QFile(dic_delta).exists()) {
+        dicDeltaWords(dic_delta, words);
+    } else if (QFile(alt_dic_delta).exists()) {
+        dicDeltaWords(alt_dic_delta, words);
+    }
+
+    // add UserDictionary words to the Primary Dictionary only
+    if (dname == currentPrimaryDictionary()) {
+        // Load in the words from the user dictionaries.
+        words.append(allUserDictionaryWords());
+    }
+    return words;
+}
+
+
+bool SpellCheck::openHunspell(const QString &dname, const QString &dpath, const QStringList &extra_words, HDictionary &hdic)
+{
+    // Dictionary files to use.
+    QString aff = QString("%1%2.aff").arg(dpath).arg(dname);
+    QString dic = QString("%1%2.dic").arg(dpath).arg(dname);
+
     // Create a new hunspell object.
-    HDictionary hdic;
     hdic.name = dname;
     hdic.handle = new Hunspell(aff.toLocal8Bit().constData(), dic.toLocal8Bit().constData());
     if (!hdic.handle) {
         qDebug() << "failed to load new Hunspell dictionary " << dname;
-        return;
+        return false;
     }
 
     // Get the encoding for the text in the dictionary.
@@ -346,31 +428,47 @@ void SpellCheck::loadDictionary(const QString &dname)
     // Get the extra wordchars used for tokenization
     hdic.wordchars = hdic.decoder->decode(hdic.handle->get_wordchars());
 
-    // register it as an open dictionary
-    m_opendicts[dname] = hdic;
+    foreach(QString word, extra_words) {
+        QByteArray ba = hdic.encoder->encode(Utility::getSpellingSafeText(HTMLSpellCheckML::textOf(word)));
+        hdic.handle->add(ba.toStdString());
+    }
+    return true;
+}
 
-    // check for appropriate .dic_delta file and add it
-    // check in user prefs hunspell_dictionaries first
-    // so that user's version is given preference over 
-    // any system version
-    QStringList deltaWords;
-    if (QFile(dic_delta).exists()) {
-        dicDeltaWords(dic_delta, deltaWords);
-    } else if (QFile(alt_dic_delta).exists()) {
-        dicDeltaWords(alt_dic_delta, deltaWords);
+
+void SpellCheck::closeHunspell(HDictionary &hdic)
+{
+    if (hdic.handle) {
+        delete hdic.encoder;
+        delete hdic.decoder;
+        delete hdic.handle;
     }
-    foreach(QString word, deltaWords){
-        addWordToDictionary(word, dname);
+    hdic.handle = nullptr;
+    hdic.encoder = nullptr;
+    hdic.decoder = nullptr;
+}
+
+
+void SpellCheck::loadDictionary(const QString &dname)
+{
+    DBG qDebug() << "In loadDictionary: " << dname;
+    QMutexLocker locker(&mutex);
+    // If we don't have a dictionary we cannot continue.
+    if (dname.isEmpty() || !m_dictionaries.contains(dname)) {
+        qDebug() << "attempted to load a non-existent dictionary: " << dname;
+        return;
     }
 
-    // add UserDictionary words to the Primary Dictionary only
-    if (dname == currentPrimaryDictionary()) {
-        // Load in the words from the user dictionaries.
-        foreach(QString word, allUserDictionaryWords()) {
-            addWordToDictionary(word, dname);
-        }
+    HDictionary hdic;
+    QStringList extra_words = extraDictionaryWords(dname);
+    if (!openHunspell(dname, m_dictionaries.value(dname), extra_words, hdic)) {
+        return;
     }
 
+    // register it as an open dictionary
+    m_opendicts[dname] = hdic;
+    m_extraWords[dname] = extra_words;
+
     SettingsStore settings;
     // store the primary and secondary dictionary info for speed
     if (dname == settings.dictionary()) {
@@ -379,10 +477,139 @@ void SpellCheck::loadDictionary(const QString &dname)
     else if (dname == settings.secondary_dictionary()) {
         m_secondary = hdic;
     }
+    clearVerdicts();
     return;
 }
 
 
+QSet<QString> SpellCheck::misspelledWords(const QStringList &words)
+{
+    QSet<QString> misspelled;
+
+    // Sort out what is already known and group the rest by dictionary
+    QHash<QString, QStringList> words_by_dict;
+    foreach(QString word, words) {
+        QString dname = m_langcode2dict.value(HTMLSpellCheckML::langOf(word), "");
+        if (dname.isEmpty()) continue;
+        if (!m_opendicts.contains(dname)) {
+            loadDictionary(dname);
+        }
+        if (!m_opendicts.contains(dname)) continue;
+        QString text = HTMLSpellCheckML::textOf(word);
+        if (isIgnored(text)) continue;
+        bool res;
+        if (cachedVerdict(m_verdicts, dname + QChar(0) + text, res)) {
+            if (!res) misspelled.insert(word);
+            continue;
+        }
+        words_by_dict[dname].append(word);
+    }
+
+    QHashIterator<QString, QStringList> it(words_by_dict);
+    while (it.hasNext()) {
+        it.next();
+        const QString &dname = it.key();
+        const QStringList &dwords = it.value();
+
+        // Hunspell instances can not be shared between threads, so every
+        // worker borrows one. The dictionary's own instance is the first,
+        // more are opened (in the workers) as needed up to the thread count.
+        HunspellPool pool;
+        pool.dname = dname;
+        pool.dpath = m_dictionaries.value(dname);
+        pool.extra_words = m_extraWords.value(dname);
+        pool.free.append(m_opendicts.value(dname));
+        pool.owned = m_hunspellPool.take(dname);
+        pool.free.append(pool.owned);
+        pool.count = pool.free.count();
+        pool.max_count = qMax(1, qMin(QThread::idealThreadCount(), MAX_HUNSPELL_INSTANCES));
+        if (dwords.count() < SPELLCHECK_BATCH_SIZE) {
+            pool.max_count = 1;
+        }
+
+        QList<SpellCheckBatch> batches;
+        for (int start = 0; start < dwords.count(); start += SPELLCHECK_BATCH_SIZE) {
+            SpellCheckBatch batch;
+            batch.pool = &pool;
+            batch.words = dwords.mid(start, SPELLCHECK_BATCH_SIZE);
+            batches.append(batch);
+        }
+        QtConcurrent::blockingMap(batches, CheckSpellingBatch);
+
+        // keep the extra instances around for the next batch
+        m_hunspellPool.insert(dname, pool.owned);
+
+        for (int b = 0; b < batches.count(); ++b) {
+            const SpellCheckBatch &batch = batches.at(b);
+            for (int w = 0; w < batch.words.count(); ++w) {
+                const QString &word = batch.words.at(w);
+                bool res = batch.verdicts.at(w);
+                storeVerdict(m_verdicts, dname + QChar(0) + HTMLSpellCheckML::textOf(word), res);
+                if (!res) misspelled.insert(word);
+            }
+        }
+    }
+    return misspelled;
+}
+
+
+void SpellCheck::CheckSpellingBatch(SpellCheckBatch &batch)
+{
+    HunspellPool *pool = batch.pool;
+    HDictionary hdic;
+    bool have_one = false;
+    bool open_one = false;
+    {
+        QMutexLocker locker(&pool->mutex);
+        if (!pool->free.isEmpty()) {
+            hdic = pool->free.takeLast();
+            have_one = true;
+        } else if (pool->count < pool->max_count) {
+            pool->count++;
+            open_one = true;
+        }
+    }
+    if (open_one) {
+        have_one = openHunspell(pool->dname, pool->dpath, pool->extra_words, hdic);
+        if (have_one) {
+            QMutexLocker locker(&pool->mutex);
+            pool->owned.append(hdic);
+        }
+    }
+    if (!have_one) {
+        // wait for one of the other workers to be done with theirs
+        QMutexLocker locker(&pool->mutex);
+        while (pool->free.isEmpty()) {
+            pool->released.wait(&pool->mutex);
+        }
+        hdic = pool->free.takeLast();
+    }
+
+    batch.verdicts.reserve(batch.words.count());
+    foreach(QString word, batch.words) {
+        QByteArray ba = hdic.encoder->encode(Utility::getSpellingSafeText(HTMLSpellCheckML::textOf(word)));
+        batch.verdicts.append(hdic.handle->spell(ba.toStdString()));
+    }
+
+    QMutexLocker locker(&pool->mutex);
+    pool->free.append(hdic);
+    pool->released.wakeOne();
+}
+
+
+void SpellCheck::clearHunspellPool()
+{
+    QMutableHashIterator<QString, QList<HDictionary> > it(m_hunspellPool);
+    while (it.hasNext()) {
+        it.next();
+        for (int i = 0; i < it.value().count(); ++i) {
+            closeHunspell(it.value()[i]);
+        }
+    }
+    m_hunspellPool.clear();
+}
+
+
 void SpellCheck::setDictionary(const QString &dname, bool forceReplace)
 {
     DBG qDebug() << "In setDictionary " << dname;
@@ -25,9 +25,12 @@
 #define SPELLCHECK_H
 
 #include <QHash>
+#include <QList>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 #include <QMutex>
+#include <QWaitCondition>
 
 class Hunspell;
 class QStringEncoder;
@@ -67,6 +70,13 @@ public:
     bool spellPS(const QString &word);
     QStringList suggestPS(const QString &word);
 
+    /**
+     * Checks a whole list of distinct words (with langcode info, as
+     * for spell()) and returns the misspelled ones. Large lists are
+     * checked on all cores using one hunspell instance per worker.
+     */
+    QSet<QString> misspelledWords(const QStringList &words);
+
     void clearIgnoredWords();
     void ignoreWord(const QString &word);
     bool isIgnored(const QString &word);
@@ -96,10 +106,55 @@ public:
 
     void loadDictionaryNames();
 
+    /**
+     * How often a verdict was answered from the cache
+     * instead of asking hunspell, and how often not.
+     */
+    quint64 verdictCacheHits() const;
+    quint64 verdictCacheMisses() const;
+
 private:
     SpellCheck();
     ~SpellCheck();
 
+    // The hunspell instances the workers of misspelledWords() share
+    struct HunspellPool {
+        QString dname;
+        QString dpath;
+        QStringList extra_words;
+        QList<HDictionary> free;
+        QList<HDictionary> owned;
+        int count = 0;
+        int max_count = 1;
+        QMutex mutex;
+        QWaitCondition released;
+    };
+
+    struct SpellCheckBatch {
+        HunspellPool *pool = nullptr;
+        QStringList words;
+        QList<bool> verdicts;
+    };
+
+    static void CheckSpellingBatch(SpellCheckBatch &batch);
+
+    // Opens a hunspell instance of the dictionary with the extra words added
+    static bool openHunspell(const QString &dname, const QString &dpath,
+                             const QStringList &extra_words, HDictionary &hdic);
+    static void closeHunspell(HDictionary &hdic);
+
+    // The delta words of the dictionary, and the user dictionary words
+    // if it is the primary dictionary
+    QStringList extraDictionaryWords(const QString &dname);
+
+    void clearHunspellPool();
+
+    // The verdict cache remembers what hunspell said about a word.
+    // Ignored words are checked before it so they never end up in it.
+    bool cachedVerdict(const QHash<QString, bool> &verdicts, const QString &key, bool &verdict) const;
+    void storeVerdict(QHash<QString, bool> &verdicts, const QString &key, bool verdict);
+    void clearVerdicts();
+
     QHash<QString, QString> m_dictionaries;
     QHash<QString, QString> m_langcode2dict;
     mutable QMutex mutex;
@@ -107,6 +162,21 @@ private:
     QSet<QString> m_ignoredWords;
     struct HDictionary m_primary;
     struct HDictionary m_secondary;
+
+    // verdicts of spell() keyed by dictionary and word,
+    // and of spellPS() for the current primary and secondary
+    QHash<QString, bool> m_verdicts;
+    QHash<QString, bool> m_verdictsPS;
+    mutable quint64 m_verdictHits = 0;
+    mutable quint64 m_verdictMisses = 0;
+    mutable QMutex m_verdictMutex;
+
+    // the extra hunspell instances opened by misspelledWords()
+    QHash<QString, QList<HDictionary> > m_hunspellPool;
+
+    // the extraDictionaryWords() each open dictionary was loaded with,
+    // plus the words added since, for opening more instances of it
+    QHash<QString, QStringList> m_extraWords;
 };
 
 #endif // SPELLCHECK_H
@@ -28,6 +28,7 @@
 #include <QBuffer>
 #include <QFile>
 #include <QFileInfo>
+#include <QDateTime>
 #include <QDebug>
 #include "MainUI/MainApplication.h"
 #include "Misc/MediaTypes.h"
@@ -39,12 +40,66 @@
 
 static const QStringList REDIRECT = QStringList() << "audio/mp4" << "video/mp4" << "audio/mpeg" << "application/pdf";
 
+// files up to this size are kept in memory once served,
+// larger ones (mostly media and fonts) are streamed from disk
+static const int MAX_CACHED_ASSET_KB = 1024;
+static const int ASSET_CACHE_KB = 32 * 1024;
+
 URLSchemeHandler::URLSchemeHandler(QObject *parent)
-    : QWebEngineUrlSchemeHandler(parent)
+    : QWebEngineUrlSchemeHandler(parent),
+      m_AssetCache(ASSET_CACHE_KB)
 {
 }
 
 
+QIODevice *URLSchemeHandler::OpenAsset(const QFileInfo &fi)
+{
+    QString path = fi.absoluteFilePath();
+    qint64 size = fi.size();
+    QDateTime modified = fi.lastModified();
+    if (size == 0) {
+        return nullptr;
+    }
+
+    QByteArray data;
+    CachedAsset *asset = m_AssetCache.object(path);
+    if (asset && (asset->size == size) && (asset->modified == modified)) {
+        DBG qDebug() << "URLSchemeHandler serving from cache: " << path;
+        data = asset->data;
+    } else {
+        QFile *file = new QFile(path);
+        if (!file->open(QIODevice::ReadOnly)) {
+            delete file;
+            m_AssetCache.remove(path);
+            return nullptr;
+        }
+        if (size > MAX_CACHED_ASSET_KB * 1024) {
+            // QFile is random access so WebEngine can seek in it and
+            // only the parts it actually reads are ever loaded
+            m_AssetCache.remove(path);
+            return file;
+        }
+        data = file->readAll();
+        file->close();
+        delete file;
+        if (data.size() != size) {
+            // changed while we were reading it, serve it but do not keep it
+            m_AssetCache.remove(path);
+        } else {
+            m_AssetCache.insert(path, new CachedAsset{modified, size, data}, qMax(1, int(size / 1024)));
+        }
+    }
+    if (data.isEmpty()) {
+        return nullptr;
+    }
+    // shares the cached bytes, nothing is copied
+    QBuffer *buffer = new QBuffer();
+    buffer->setData(data);
+    buffer->open(QIODevice::ReadOnly);
+    return buffer;
+}
+
+
 void URLSchemeHandler::requestStarted(QWebEngineUrlRequestJob *request)
 {
     DBG qDebug() << "    ";
@@ -53,14 +108,17 @@ void URLSchemeHandler::requestStarted(QWebEngineUrlRequestJob *request)
     DBG qDebug() << "In URLSchemeHandler with initiator: " << request->initiator();
 
     QUrl url = request->requestUrl();
-    QByteArray data;
+    QIODevice *reply = nullptr;
     QString content_type;  // must NOT include ";charset=UTF-8"
     QString key = url.toString();
     MainApplication *mainApplication = qobject_cast<MainApplication *>(qApp);
     QString xhtml = mainApplication->loadFromPreviewCache(key);
     if (!xhtml.isEmpty()) {
         content_type = QString("application/xhtml+xml");
-        data = xhtml.toUtf8();
+        QBuffer *replybuffer = new QBuffer();
+        replybuffer->setData(xhtml.toUtf8());
+        replybuffer->open(QIODevice::ReadOnly);
+        reply = replybuffer;
     } else {
         QUrl fileurl("file://" + url.path());
         QString local_file = fileurl.toLocalFile();
@@ -86,27 +144,22 @@ void URLSchemeHandler::requestStarted(QWebEngineUrlRequestJob *request)
             //
             // Since filling partial requests does not seem feasible in QtWebEngine without a whole
             // lot of effort, redirect them to use the url file: scheme so that the entire file gets requested
+            // (QWebEngineUrlRequestJob::reply() can not answer with a 206 status and Content-Range,
+            // so serving seekable devices below is not enough to satisfy the demuxer)
             
             if (REDIRECT.contains(mt) && url.scheme() == "sigil") {
                 request->redirect(fileurl);
                 return;
             }
             
-            QFile file(local_file);
-            if (file.open(QIODevice::ReadOnly)) {
-                data = file.readAll();
-                file.close();
-            }
+            reply = OpenAsset(fi);
         } else {
             qDebug() << "URLSchemeHandler will fail request because no local file found: " << url;
         }
     }
-    if (!data.isEmpty()) {
-        QBuffer *replybuffer = new QBuffer();
-        replybuffer->setData(data);
-        replybuffer->open(QIODevice::ReadOnly);
-        connect(request, SIGNAL(destroyed()), replybuffer, SLOT(deleteLater()));
-        request->reply(content_type.toUtf8(), replybuffer);
+    if (reply) {
+        connect(request, SIGNAL(destroyed()), reply, SLOT(deleteLater()));
+        request->reply(content_type.toUtf8(), reply);
     } else {
         qDebug() << "URLSchemeHandler failed request for: " << url;
         request->fail(QWebEngineUrlRequestJob::UrlNotFound);
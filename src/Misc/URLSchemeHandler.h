@@ -22,14 +22,37 @@
 #ifndef URLSCHEMEHANDLER_H
 #define URLSCHEMEHANDLER_H
 
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QString>
 #include <QWebEngineUrlRequestJob>
 #include <QWebEngineUrlSchemeHandler>
 
+class QFileInfo;
+class QIODevice;
 
 class URLSchemeHandler : public QWebEngineUrlSchemeHandler
 {
 public:
     URLSchemeHandler(QObject *parent = nullptr);
     void requestStarted(QWebEngineUrlRequestJob *job) Q_DECL_OVERRIDE;
+
+private:
+    // a small file as it was last served, valid while the
+    // file keeps the same modification time and size
+    struct CachedAsset {
+        QDateTime  modified;
+        qint64     size;
+        QByteArray data;
+    };
+
+    // Returns an open, seekable device for the reply or nullptr.
+    // Small files come from (and go into) the cache, larger ones
+    // are read from disk in chunks as WebEngine consumes them.
+    QIODevice *OpenAsset(const QFileInfo &fi);
+
+    // recently served small files keyed by absolute path, cost in KB
+    QCache<QString, CachedAsset> m_AssetCache;
 };
 #endif // URLSCHEMEHANDLER_H
@@ -35,6 +35,7 @@
 #include <time.h>
 #include <string>
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
@@ -43,6 +44,7 @@
 #include <QByteArray>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QProcess>
 #include <QStandardPaths>
 #include <QStringList>
@@ -60,6 +62,8 @@
 #include <QStringDecoder>
 #include <QMenu>
 #include <QSet>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
 #if QT_VERSION >= QT_VERSION_CHECK(6,5,0)
     #include <QStyleHints>
 #endif
@@ -860,6 +864,165 @@ std::wstring Utility::QStringToStdWString(const QString &str)
 #endif
 
 
+// The entries one worker of UnZipTargets() inflates through its own
+// handle on the archive, unzFiles can not be shared between threads.
+struct UnZipBatch {
+    QString zippath;
+    const QList<Utility::UnZipTarget> *targets;
+    QFileDevice::Permissions permissions;
+    QList<int> indexes;
+    quint64 size;
+    int failed;
+};
+
+
+static bool UnZipOneTarget(unzFile zfile, const Utility::UnZipTarget &target,
+                           QFileDevice::Permissions permissions, char *buff)
+{
+    unz64_file_pos file_pos;
+    file_pos.pos_in_zip_directory = target.pos_in_zip_directory;
+    file_pos.num_of_file = target.num_of_file;
+
+    // Open the file entry in the archive for reading.
+    if ((unzGoToFilePos64(zfile, &file_pos) != UNZ_OK) || (unzOpenCurrentFile(zfile) != UNZ_OK)) {
+        return false;
+    }
+
+    // Open the file on disk to write the entry in the archive to.
+    QFile entry(target.file_path);
+
+    if (!entry.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        unzCloseCurrentFile(zfile);
+        return false;
+    }
+
+    int read = 0;
+
+    while ((read = unzReadCurrentFile(zfile, buff, BUFF_SIZE)) > 0) {
+        entry.write(buff, read);
+    }
+
+    if (permissions.toInt() != 0) {
+        entry.setPermissions(permissions);
+    }
+    entry.close();
+
+    // Read errors are marked by a negative read amount.
+    if (read < 0) {
+        unzCloseCurrentFile(zfile);
+        return false;
+    }
+
+    // The file was read but the CRC did not match.
+    // We don't check the read file size vs the uncompressed file size
+    // because if they're different there should be a CRC error.
+    return unzCloseCurrentFile(zfile) != UNZ_CRCERROR;
+}
+
+
+static void UnZipOneBatch(UnZipBatch &batch)
+{
+#ifdef Q_OS_WIN32
+    zlib_filefunc64_def ffunc;
+    fill_win32_filefunc64W(&ffunc);
+    unzFile zfile = unzOpen2_64(Utility::QStringToStdWString(QDir::toNativeSeparators(batch.zippath)).c_str(), &ffunc);
+#else
+    unzFile zfile = unzOpen64(QDir::toNativeSeparators(batch.zippath).toUtf8().constData());
+#endif
+
+    // Buffered reading and writing.
+    char buff[BUFF_SIZE] = {0};
+
+    foreach(int i, batch.indexes) {
+        if ((zfile == NULL) || !UnZipOneTarget(zfile, batch.targets->at(i), batch.permissions, buff)) {
+            if ((batch.failed < 0) || (i < batch.failed)) {
+                batch.failed = i;
+            }
+        }
+    }
+
+    if (zfile != NULL) {
+        unzClose(zfile);
+    }
+}
+
+
+int Utility::UnZipTargets(const QString &zippath, const QList<UnZipTarget> &targets,
+                          QFileDevice::Permissions permissions)
+{
+    if (targets.isEmpty()) {
+        return -1;
+    }
+
+    // Entries that land in the same file are inflated one after the other,
+    // in archive order, by a single worker so the last one still wins. The
+    // file systems of macOS and Windows do not tell case apart, so there
+    // paths that differ only in case are the same file.
+    QList<QList<int> > units;
+    QList<quint64> unit_sizes;
+    QHash<QString, int> unit_of_path;
+    for (int i = 0; i < targets.count(); ++i) {
+        QString key = QDir::cleanPath(targets.at(i).file_path);
+#if defined(Q_OS_MAC) || defined(Q_OS_WIN32)
+        key = key.toCaseFolded();
+#endif
+        int unit = unit_of_path.value(key, -1);
+        if (unit < 0) {
+            unit = units.count();
+            unit_of_path.insert(key, unit);
+            units.append(QList<int>());
+            unit_sizes.append(0);
+        }
+        units[unit] << i;
+        unit_sizes[unit] += targets.at(i).uncompressed_size;
+    }
+
+    // The biggest entries go first, each to the batch with the fewest
+    // bytes so far, so one large image does not hold up the others.
+    QList<int> order;
+    for (int u = 0; u < units.count(); ++u) {
+        order << u;
+    }
+    std::stable_sort(order.begin(), order.end(), [&unit_sizes](int a, int b) {
+        return unit_sizes.at(a) > unit_sizes.at(b);
+    });
+
+    int batch_count = qMax(1, qMin(QThread::idealThreadCount(), int(units.count())));
+    QList<UnZipBatch> batches;
+    for (int b = 0; b < batch_count; ++b) {
+        UnZipBatch batch;
+        batch.zippath = zippath;
+        batch.targets = &targets;
+        batch.permissions = permissions;
+        batch.size = 0;
+        batch.failed = -1;
+        batches.append(batch);
+    }
+    foreach(int u, order) {
+        int smallest = 0;
+        for (int b = 1; b < batches.count(); ++b) {
+            if (batches.at(b).size < batches.at(smallest).size) {
+                smallest = b;
+            }
+        }
+        batches[smallest].indexes << units.at(u);
+        batches[smallest].size += unit_sizes.at(u);
+    }
+
+    QtConcurrent::blockingMap(batches, UnZipOneBatch);
+
+    int failed = -1;
+    foreach(const UnZipBatch &batch, batches) {
+        if ((batch.failed >= 0) && ((failed < 0) || (batch.failed < failed))) {
+            failed = batch.failed;
+        }
+    }
+    return failed;
+}
+
+
+// The central directory is read first, validating every name and creating
+// the folders, then the entries are inflated in parallel by UnZipTargets().
 bool Utility::UnZip(const QString &zippath, const QString &destpath)
 {
     int res = 0;
@@ -879,6 +1042,10 @@ bool Utility::UnZip(const QString &zippath, const QString &destpath)
         return false;
     }
 
+    QList<UnZipTarget> targets;
+    QHash<QString, int> target_index;
+    QList<std::pair<QString, QString> > cp437_copies;
+
     res = unzGoToFirstFile(zfile);
 
     if (res == UNZ_OK) {
@@ -934,7 +1101,6 @@ bool Utility::UnZip(const QString &zippath, const QString &destpath)
                 }
 
                 if (evil_or_corrupt_epub) {
-                    unzCloseCurrentFile(zfile);
                     unzClose(zfile);
                     // throw (UNZIPLoadParseError(QString(QObject::tr("Possible evil or corrupt zip file name: %1")).arg(original_path).toStdString()));
                     return false;
@@ -954,60 +1120,45 @@ bool Utility::UnZip(const QString &zippath, const QString &destpath)
                     if (!qfile_info.path().isEmpty()) dir.mkpath(qfile_info.path());
                 }
 
-                // Open the file entry in the archive for reading.
-                if (unzOpenCurrentFile(zfile) != UNZ_OK) {
-                    unzClose(zfile);
-                    return false;
-                }
-
-                // Open the file on disk to write the entry in the archive to.
-                QFile entry(file_path);
-
-                if (!entry.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-                    unzCloseCurrentFile(zfile);
-                    unzClose(zfile);
-                    return false;
-                }
-
-                // Buffered reading and writing.
-                char buff[BUFF_SIZE] = {0};
-                int read = 0;
-
-                while ((read = unzReadCurrentFile(zfile, buff, BUFF_SIZE)) > 0) {
-                    entry.write(buff, read);
-                }
-
-                entry.close();
-
-                // Read errors are marked by a negative read amount.
-                if (read < 0) {
-                    unzCloseCurrentFile(zfile);
+                unz64_file_pos file_pos;
+                if (unzGetFilePos64(zfile, &file_pos) != UNZ_OK) {
                     unzClose(zfile);
                     return false;
                 }
-
-                // The file was read but the CRC did not match.
-                // We don't check the read file size vs the uncompressed file size
-                // because if they're different there should be a CRC error.
-                if (unzCloseCurrentFile(zfile) == UNZ_CRCERROR) {
-                    unzClose(zfile);
-                    return false;
+                UnZipTarget target;
+                target.pos_in_zip_directory = file_pos.pos_in_zip_directory;
+                target.num_of_file = file_pos.num_of_file;
+                target.uncompressed_size = file_info.uncompressed_size;
+                target.file_path = file_path;
+
+                // a later entry of the same name overwrote the earlier one
+                if (target_index.contains(file_path)) {
+                    targets[target_index.value(file_path)] = target;
+                } else {
+                    target_index.insert(file_path, targets.count());
+                    targets.append(target);
                 }
 
                 if (!cp437_file_name.isEmpty() && cp437_file_name != qfile_name) {
-                    QString cp437_file_path = destpath + "/" + cp437_file_name;
-                    QFile::copy(file_path, cp437_file_path);
+                    cp437_copies.append(std::make_pair(file_path, destpath + "/" + cp437_file_name));
                 }
             }
         } while ((res = unzGoToNextFile(zfile)) == UNZ_OK);
     }
 
+    unzClose(zfile);
+
     if (res != UNZ_END_OF_LIST_OF_FILE) {
-        unzClose(zfile);
         return false;
     }
 
-    unzClose(zfile);
+    if (UnZipTargets(zippath, targets) != -1) {
+        return false;
+    }
+
+    for (const std::pair<QString, QString> &copy : cp437_copies) {
+        QFile::copy(copy.first, copy.second);
+    }
     return true;
 }
 
@@ -1407,62 +1558,28 @@ QString Utility::GenerateUniqueId(const QString &id, const QSet<QString>& Used)
     return new_id;
 }
 
- 
-const quint32 CRC32_TAB[256] =
-{
-	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
-	0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
-	0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-	0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9, 0xfa0f3d63, 0x8d080df5,
-	0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172, 0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
-	0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-	0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423, 0xcfba9599, 0xb8bda50f,
-	0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924, 0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,
-	0x76dc4190, 0x01db7106, 0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-	0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
-	0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e, 0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457,
-	0x65b0d9c6, 0x12b7e950, 0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-	0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb,
-	0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0, 0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9,
-	0x5005713c, 0x270241aa, 0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-	0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad,
-	0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a, 0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683,
-	0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-	0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb, 0x196c3671, 0x6e6b06e7,
-    0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc, 0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
-	0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-	0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55, 0x316e8eef, 0x4669be79,
-	0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236, 0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f,
-	0xc5ba3bbe, 0xb2bd0b28, 0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-	0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
-	0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38, 0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21,
-	0x86d3d2d4, 0xf1d4e242, 0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-	0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45,
-	0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2, 0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db,
-	0xaed16a4a, 0xd9d65adc, 0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-	0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693, 0x54de5729, 0x23d967bf,
-	0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-};
- 
+// Computed with zlib (pulled in by unzip.h) whose crc32 processes several
+// bytes per step instead of going through the table one byte at a time.
 QString Utility::FileCRC32(const QString& filePath)
 {
-	QFile file(filePath);
-	char buf[BUFF_SIZE];
-	quint32 crc32 = 0;
-	qint64 n = 0;
- 
-	if(!file.open(QIODevice::ReadOnly)) return "";
- 
-	crc32 = 0xffffffff;
-	while((n = file.read(buf, 1)) > 0) {
-		for(qint64 i = 0; i < n; i++) {
-			crc32 = (crc32 >> 8) ^ CRC32_TAB[((crc32 ^ buf[i]) & 0xff)];
-		}
-	}
-	crc32 ^= 0xffffffff;
+    const qint64 CRC_CHUNK_SIZE = 256 * 1024;
+    QFile file(filePath);
 
-	file.close();
-	return QString("%1").arg(crc32, 8, 16, QLatin1Char('0'));
+    if (!file.open(QIODevice::ReadOnly)) return "";
+
+    QByteArray buf(CRC_CHUNK_SIZE, '\0');
+    uLong crc = crc32(0L, Z_NULL, 0);
+    qint64 n = 0;
+    while ((n = file.read(buf.data(), CRC_CHUNK_SIZE)) > 0) {
+#if ZLIB_VERNUM >= 0x1290
+        crc = crc32_z(crc, reinterpret_cast<const Bytef *>(buf.constData()), (z_size_t)n);
+#else
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(buf.constData()), (uInt)n);
+#endif
+    }
+    file.close();
+    if (n < 0) return "";
+    return QString("%1").arg((quint32)crc, 8, 16, QLatin1Char('0'));
 }
 
 
@@ -34,6 +34,7 @@
 #include <QStringList>
 #include <QImage>
 #include <QFileDialog>
+#include <QFileDevice>
 
 class QStringView;
 class QWidget;
@@ -209,6 +210,21 @@ public:
 #endif
 
     static bool UnZip(const QString &zippath, const QString &destdir);
+
+    // A file entry of a zip archive, located by its header in the central
+    // directory (minizip's unz64_file_pos), and the file to inflate it to
+    struct UnZipTarget {
+        quint64 pos_in_zip_directory;
+        quint64 num_of_file;
+        quint64 uncompressed_size;
+        QString file_path;
+    };
+
+    // Inflates the entries in parallel, every worker through its own handle
+    // on the archive, and checks their crcs. The folders must already exist.
+    // Returns the index of the first entry that could not be extracted or -1.
+    static int UnZipTargets(const QString &zippath, const QList<UnZipTarget> &targets,
+                            QFileDevice::Permissions permissions = QFileDevice::Permissions());
     static QStringList ZipInspect(const QString &zippath);
 
     // Generate relative path to destination from starting directory path
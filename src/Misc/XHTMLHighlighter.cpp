@@ -164,8 +164,7 @@ void XHTMLHighlighter::highlightBlock(const QString &text)
         return;
     }
 
-    SettingsStore settings;
-    bool enableSpellCheck = settings.spellCheck();
+    bool enableSpellCheck = SettingsStore::snapshot()->spellCheck;
 
     // Run spell check over the text.
     if (enableSpellCheck && m_checkSpelling) {
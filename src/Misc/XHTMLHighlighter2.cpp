@@ -145,8 +145,7 @@ void XHTMLHighlighter2::highlightBlock(const QString &text)
     QChar ch;
 
     // Run spell check over the text if needed first.
-    SettingsStore settings;
-    bool enableSpellCheck = settings.spellCheck();
+    bool enableSpellCheck = SettingsStore::snapshot()->spellCheck;
     if (enableSpellCheck && m_checkSpelling) {
         CheckSpelling(text);
     }
@@ -20,26 +20,94 @@
 **
 *************************************************************************/
 
+#include <QtCore/QMutexLocker>
+
 #include "PCRE2/PCRECache.h"
 
-  // defaults to maxCacheCost of 100
+// Compiled patterns are usually only a few KB, so this
+// keeps a lot more of them around than the old limit of 20
+static const size_t MAX_COMPILED_SIZE = 4 * 1024 * 1024;
 
-bool PCRECache::insert(const QString &key, SPCRE *object)
+bool PCRECache::insert(const QString &key, QSharedPointer<SPCRE> object)
 {
-    // raise cost of each entry to 5 to reduce memory footprint
-    return m_cache.insert(key, object, 5);
+    if (object.isNull()) {
+        return false;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (m_cache.contains(key)) {
+        m_totalSize -= m_cache.value(key).size;
+        m_lru.removeOne(key);
+    }
+    CacheEntry entry;
+    entry.spcre = object;
+    entry.size = object->compiledSize();
+    m_cache.insert(key, entry);
+    m_lru.append(key);
+    m_totalSize += entry.size;
+    trim();
+    return true;
 }
 
-SPCRE *PCRECache::getObject(const QString &key)
+QSharedPointer<SPCRE> PCRECache::getObject(const QString &key)
 {
+    {
+        QMutexLocker locker(&m_mutex);
+        QHash<QString, CacheEntry>::const_iterator it = m_cache.constFind(key);
+        if (it != m_cache.constEnd()) {
+            m_hits++;
+            if (m_lru.last() != key) {
+                m_lru.removeOne(key);
+                m_lru.append(key);
+            }
+            return it.value().spcre;
+        }
+        m_misses++;
+    }
+
     // Create a new SPCRE if it doesn't already exist.
     // The key is the pattern for initializing the SPCRE.
-    if (!m_cache.contains(key)) {
-        SPCRE *spcre = new SPCRE(key);
-        // raise cost of each entry to 5 to reduce memory footprint
-        m_cache.insert(key, spcre, 5);
-        return spcre;
+    // It is compiled outside of the lock, if another thread
+    // got there first we use the one already cached.
+    QSharedPointer<SPCRE> spcre(new SPCRE(key));
+    CacheEntry entry;
+    entry.spcre = spcre;
+    entry.size = spcre->compiledSize();
+
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, CacheEntry>::const_iterator it = m_cache.constFind(key);
+    if (it != m_cache.constEnd()) {
+        return it.value().spcre;
     }
+    m_cache.insert(key, entry);
+    m_lru.append(key);
+    m_totalSize += entry.size;
+    trim();
+    return spcre;
+}
+
+quint64 PCRECache::hits()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
 
-    return m_cache.object(key);
+quint64 PCRECache::misses()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+size_t PCRECache::totalCompiledSize()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_totalSize;
+}
+
+void PCRECache::trim()
+{
+    while ((m_totalSize > MAX_COMPILED_SIZE) && (m_lru.count() > 1)) {
+        QString key = m_lru.takeFirst();
+        m_totalSize -= m_cache.value(key).size;
+        m_cache.remove(key);
+    }
 }
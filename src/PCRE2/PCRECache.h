@@ -25,7 +25,9 @@
 #ifndef PCRECACHE_H
 #define PCRECACHE_H
 
-#include <QtCore/QCache>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
 #include <QtCore/QString>
 
 #include "PCRE2/SPCRE.h"
@@ -33,7 +35,11 @@
 /**
  * Singleton. A cache of SPCRE regular expression objects.
  *
- * The SPCRE's are cached to improve performance.
+ * The SPCRE's are cached to improve performance. The cache can be
+ * used from any thread. The SPCRE's are handed out as shared pointers
+ * so one dropped from the cache stays alive for as long as it is in use.
+ * The least recently used ones are dropped once their total compiled
+ * size goes over the limit.
  */
 class PCRECache
 {
@@ -56,7 +62,7 @@ public:
      *
      * @return True if the object was successfully inserted.
      */
-    bool insert(const QString &key, SPCRE *object);
+    bool insert(const QString &key, QSharedPointer<SPCRE> object);
     /**
      * Retrieve the SPCRE object from the cache.
      *
@@ -65,7 +71,18 @@ public:
      *
      * @param key The key associated with the SPCRE.
      */
-    SPCRE *getObject(const QString &key);
+    QSharedPointer<SPCRE> getObject(const QString &key);
+
+    /**
+     * Lookups that found the SPCRE already compiled, and those that did not.
+     */
+    quint64 hits();
+    quint64 misses();
+
+    /**
+     * The total compiled size in bytes of the cached SPCRE's.
+     */
+    size_t totalCompiledSize();
 
 private:
     /**
@@ -75,8 +92,25 @@ private:
 
     ~PCRECache() = default;
 
-    // The cache that we store the SPCRE's.
-    QCache<QString, SPCRE> m_cache;
+    struct CacheEntry {
+        QSharedPointer<SPCRE> spcre;
+        size_t size;
+    };
+
+    // Drops the least recently used entries, but never the most recent one,
+    // until the cache fits in its limit again. m_mutex must be held.
+    void trim();
+
+    // The cache that we store the SPCRE's, and their keys from
+    // the least to the most recently used.
+    QHash<QString, CacheEntry> m_cache;
+    QList<QString> m_lru;
+    size_t m_totalSize = 0;
+
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+
+    QMutex m_mutex;
 };
 
 #endif // PCRECACHE_H
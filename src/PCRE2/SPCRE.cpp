@@ -39,13 +39,7 @@ SPCRE::SPCRE(const QString &patten)
 {
     m_pattern = patten;
     m_re = NULL;
-    m_matchdata = NULL;
-    m_mcontext = NULL;
-
-#ifndef PCRE_NO_JIT
-    m_jitstack = NULL;
-#endif
-
+    m_jit = false;
     m_captureSubpatternCount = 0;
     m_error = QString();
     m_errpos = -1;
@@ -56,23 +50,17 @@ SPCRE::SPCRE(const QString &patten)
     // Pattern is valid.
     if (m_re != NULL) {
         m_valid = true;
-        m_matchdata = pcre2_match_data_create_from_pattern_16(m_re, NULL);
-
 
 #ifndef PCRE_NO_JIT
-        int rc = pcre2_jit_compile_16(m_re, PCRE2_JIT_COMPLETE);
-        if (rc == 0) {
-            m_mcontext = pcre2_match_context_create_16(NULL);
-            m_jitstack = pcre2_jit_stack_create_16(32*1024, 1024*1024, NULL);
-            if (m_jitstack != NULL) {
-                pcre2_jit_stack_assign_16(m_mcontext, NULL, m_jitstack);
-            }
-        }
+        m_jit = (pcre2_jit_compile_16(m_re, PCRE2_JIT_COMPLETE) == 0);
 #endif
 
+        MatchSlot *slot = createMatchSlot();
+        m_freeSlots.append(slot);
+
         // Store the number of capture patterns (pairs).
         // pcre2_pattern_info_16(m_re, PCRE2_INFO_CAPTURECOUNT, &m_captureSubpatternCount);
-        m_captureSubpatternCount = pcre2_get_ovector_count_16(m_matchdata);
+        m_captureSubpatternCount = pcre2_get_ovector_count_16(slot->matchdata);
     }
     // Pattern is not valid.
     else {
@@ -90,27 +78,23 @@ SPCRE::SPCRE(const QString &patten)
 
 SPCRE::~SPCRE()
 {
+    foreach(MatchSlot *slot, m_allSlots) {
+        pcre2_match_data_free_16(slot->matchdata);
+        if (slot->jitstack) {
+            pcre2_jit_stack_free_16(slot->jitstack);
+        }
+        if (slot->mcontext) {
+            pcre2_match_context_free_16(slot->mcontext);
+        }
+        delete slot;
+    }
+    m_allSlots.clear();
+    m_freeSlots.clear();
+
     if (m_re != NULL) {
         pcre2_code_free_16(m_re);
         m_re = NULL;
     }
-
-    if (m_matchdata != NULL) {
-        pcre2_match_data_free_16(m_matchdata);
-        m_matchdata = NULL;
-    }
-
-#ifndef PCRE_NO_JIT
-    if (m_jitstack) {
-        pcre2_jit_stack_free_16(m_jitstack);
-        m_jitstack = NULL;
-    }
-    if (m_mcontext) {
-        pcre2_match_context_free_16(m_mcontext);
-        m_mcontext = NULL;
-    }
-#endif
-
 }
 
 bool SPCRE::isValid()
@@ -191,16 +175,18 @@ QList<SPCRE::MatchInfo> SPCRE::getEveryMatchInfo(const QString &text)
     // sub strings.
     unsigned int last_offset[2] = {0};
     bool done = false;
+    MatchSlot *slot = acquireMatchSlot();
+    pcre2_match_data *matchdata = slot->matchdata;
     
     // Run until no matches are found.
     do {
 
-        rc = pcre2_match_16(m_re, text.utf16(), text.length(), last_offset[1], PCRE2_NOTEMPTY, m_matchdata, m_mcontext);
+        rc = pcre2_match_16(m_re, text.utf16(), text.length(), last_offset[1], PCRE2_NOTEMPTY, matchdata, slot->mcontext);
 
-        // NOTE: until a call to pcre2_match_16 happens even through m_matchdata exists
+        // NOTE: until a call to pcre2_match_16 happens even through matchdata exists
         // and the ovector count is known, the pcre2_get_ovector_pointer returns a pointer
         // to invalid ovector data
-        ovector = pcre2_get_ovector_pointer_16(m_matchdata);
+        ovector = pcre2_get_ovector_pointer_16(matchdata);
 
         done = (ovector[1] == last_offset[1]) || (ovector[0] >= ovector[1]);
 
@@ -212,6 +198,7 @@ QList<SPCRE::MatchInfo> SPCRE::getEveryMatchInfo(const QString &text)
         }
     } while (rc >= 0 && !done);
     
+    releaseMatchSlot(slot);
     return info;
 }
 
@@ -241,13 +228,16 @@ SPCRE::MatchInfo SPCRE::getFirstMatchInfo(const QString &text)
     // MSVC doesn't support it.
     // int *ovector = new int[ovector_size];
     // memset(ovector, 0, sizeof(int)*ovector_size);
-    rc = pcre2_match_16(m_re, text.utf16(), text.length(), 0, PCRE2_NOTEMPTY, m_matchdata, m_mcontext);
-    PCRE2_SIZE * ovector = pcre2_get_ovector_pointer_16(m_matchdata);
+    MatchSlot *slot = acquireMatchSlot();
+    pcre2_match_data *matchdata = slot->matchdata;
+    rc = pcre2_match_16(m_re, text.utf16(), text.length(), 0, PCRE2_NOTEMPTY, matchdata, slot->mcontext);
+    PCRE2_SIZE * ovector = pcre2_get_ovector_pointer_16(matchdata);
 
     if (rc >= 0 && ovector[0] != ovector[1]) {
         match_info = generateMatchInfo(ovector, ovector_count);
     }
 
+    releaseMatchSlot(slot);
     return match_info;
 }
 
@@ -321,3 +311,51 @@ SPCRE::MatchInfo SPCRE::generateMatchInfo(PCRE2_SIZE* ovector, int capture_patte
 
     return match_info;
 }
+
+size_t SPCRE::compiledSize()
+{
+    size_t size = 0;
+    if (m_re == NULL) {
+        return size;
+    }
+    pcre2_pattern_info_16(m_re, PCRE2_INFO_SIZE, &size);
+    if (m_jit) {
+        size_t jitsize = 0;
+        pcre2_pattern_info_16(m_re, PCRE2_INFO_JITSIZE, &jitsize);
+        size += jitsize;
+    }
+    return size;
+}
+
+SPCRE::MatchSlot *SPCRE::createMatchSlot()
+{
+    MatchSlot *slot = new MatchSlot;
+    slot->matchdata = pcre2_match_data_create_from_pattern_16(m_re, NULL);
+    slot->mcontext = NULL;
+    slot->jitstack = NULL;
+    if (m_jit) {
+        slot->mcontext = pcre2_match_context_create_16(NULL);
+        slot->jitstack = pcre2_jit_stack_create_16(32*1024, 1024*1024, NULL);
+        if (slot->jitstack != NULL) {
+            pcre2_jit_stack_assign_16(slot->mcontext, NULL, slot->jitstack);
+        }
+    }
+    m_allSlots.append(slot);
+    return slot;
+}
+
+SPCRE::MatchSlot *SPCRE::acquireMatchSlot()
+{
+    QMutexLocker locker(&m_slotMutex);
+    if (!m_freeSlots.isEmpty()) {
+        return m_freeSlots.takeLast();
+    }
+    // another thread is matching with this pattern right now
+    return createMatchSlot();
+}
+
+void SPCRE::releaseMatchSlot(MatchSlot *slot)
+{
+    QMutexLocker locker(&m_slotMutex);
+    m_freeSlots.append(slot);
+}
@@ -31,6 +31,7 @@
 #include <utility>
 
 #include <QList>
+#include <QMutex>
 #include <QString>
 
 using std::pair;
@@ -43,6 +44,10 @@ class PyObjectPtr;
  * Used to find matches within a string and create replacements.
  *
  * This class is a wrapper for the PCRE2 C library.
+ *
+ * The compiled pattern is shared, but every concurrent match gets
+ * its own match data and JIT stack, so one SPCRE can be used from
+ * several threads.
  */
 class SPCRE
 {
@@ -152,9 +157,31 @@ public:
                              const QList<std::pair<int, int>> &capture_groups_offsets,
                              PyObjectPtr fsp, QString &out);
 
+    /**
+     * The memory taken by the compiled pattern (and its JIT code).
+     *
+     * @return The size in bytes.
+     */
+    size_t compiledSize();
+
 private:
+    /**
+     * What a single match needs besides the shared compiled pattern.
+     * Only ever used by one thread at a time.
+     */
+    struct MatchSlot {
+        pcre2_match_data *matchdata;
+        pcre2_match_context *mcontext;
+        pcre2_jit_stack *jitstack;
+    };
+
     MatchInfo generateMatchInfo(PCRE2_SIZE* ovector, int ovector_count);
 
+    // Hands out a match slot that no other thread is using and takes it back.
+    MatchSlot *acquireMatchSlot();
+    void releaseMatchSlot(MatchSlot *slot);
+    MatchSlot *createMatchSlot();
+
     // Store if the pattern is valid.
     bool m_valid;
 
@@ -165,22 +192,21 @@ private:
     // The regular expression as a string.
     QString m_pattern;
 
-    // The compiled regular expression.
+    // The compiled regular expression, never modified after construction.
     pcre2_code *m_re;
 
-    // The place to store match data results.
-    pcre2_match_data *m_matchdata;
+    // Whether m_re was JIT compiled.
+    bool m_jit;
+
+    // Match slots not currently in use by any thread, and every one
+    // created so far to be freed with us.
+    QList<MatchSlot *> m_freeSlots;
+    QList<MatchSlot *> m_allSlots;
+    QMutex m_slotMutex;
 
     // The number of capture subpatterns with the expression.
     int m_captureSubpatternCount;
 
-    // The place to store match context info such as JIT
-    pcre2_match_context * m_mcontext;
-
-#ifndef PCRE_NO_JIT
-    pcre2_jit_stack* m_jitstack;
-#endif
-
 };
 
 #endif // SPCRE_H
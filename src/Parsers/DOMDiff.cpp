@@ -0,0 +1,521 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#include <string.h>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+
+#include "Parsers/GumboInterface.h"
+#include "Parsers/DOMDiff.h"
+
+// past this many changes a fresh load is cheaper than patching
+static const int MAX_PATCH_OPS = 256;
+
+static const char * const ATTR_PREFIXES[] = { "", "xlink:", "xml:", "xmlns:" };
+
+static const char * const ELEMENT_NAMESPACES[] = {
+    "http://www.w3.org/1999/xhtml",
+    "http://www.w3.org/2000/svg",
+    "http://www.w3.org/1998/Math/MathML"
+};
+
+// the html elements written as empty-element tags
+static const QSet<std::string> VOID_TAGS = QSet<std::string>() << "area" << "base" << "br" << "col"
+        << "command" << "embed" << "hr" << "img" << "input" << "keygen" << "link" << "meta"
+        << "param" << "source" << "track" << "wbr";
+
+// the attribute prefixes the patch script knows the namespace of
+static const QStringList PATCHABLE_PREFIXES = QStringList() << "xml" << "xlink" << "epub";
+
+
+static std::string attribute_name(GumboAttribute *at)
+{
+    std::string name = at->name;
+    if ((at->attr_namespace == GUMBO_ATTR_NAMESPACE_NONE) || (name == "xmlns")) {
+        return name;
+    }
+    return std::string(ATTR_PREFIXES[at->attr_namespace]) + name;
+}
+
+
+static void append_escaped(std::string &out, const char *text, bool in_attribute)
+{
+    for (const char *p = text; *p; ++p) {
+        switch (*p) {
+            case '&': out.append("&amp;");  break;
+            case '<': out.append("&lt;");   break;
+            case '>': out.append("&gt;");   break;
+            case '"':
+                if (in_attribute) {
+                    out.append("&quot;");
+                } else {
+                    out.push_back('"');
+                }
+                break;
+            default: out.push_back(*p);
+        }
+    }
+}
+
+
+static bool same_string(const char *a, const char *b)
+{
+    return strcmp(a ? a : "", b ? b : "") == 0;
+}
+
+
+static bool is_element(GumboNode *node)
+{
+    return (node->type == GUMBO_NODE_ELEMENT) || (node->type == GUMBO_NODE_TEMPLATE);
+}
+
+
+static bool is_text(GumboNode *node)
+{
+    return (node->type == GUMBO_NODE_TEXT) || (node->type == GUMBO_NODE_WHITESPACE);
+}
+
+
+DOMDiff::DOMDiff(const GumboInterface &old_doc, QList<PatchOp> &ops)
+    :
+    m_OldDoc(old_doc),
+    m_Ops(ops)
+{
+}
+
+
+bool DOMDiff::Diff(const GumboInterface &old_doc, const GumboInterface &new_doc, QList<PatchOp> &ops)
+{
+    ops.clear();
+
+    // the browser would show its error page for these
+    if (!new_doc.parsed_without_errors()) {
+        return false;
+    }
+
+    GumboNode *old_document = old_doc.get_document_node();
+    GumboNode *new_document = new_doc.get_document_node();
+    if (!old_document || !new_document) {
+        return false;
+    }
+
+    DOMDiff differ(old_doc, ops);
+
+    // everything but the body's contents must be unchanged, that
+    // includes the head with the stylesheets and injected scripts
+    const GumboDocument *od = &old_document->v.document;
+    const GumboDocument *nd = &new_document->v.document;
+    if ((od->has_doctype != nd->has_doctype) ||
+        !same_string(od->name, nd->name) ||
+        !same_string(od->public_identifier, nd->public_identifier) ||
+        !same_string(od->system_identifier, nd->system_identifier) ||
+        (od->children.length != nd->children.length)) {
+        return false;
+    }
+    for (unsigned int i = 0; i < od->children.length; ++i) {
+        GumboNode *o = static_cast<GumboNode *>(od->children.data[i]);
+        GumboNode *n = static_cast<GumboNode *>(nd->children.data[i]);
+        if (is_element(o) && is_element(n) &&
+            (o->v.element.tag == GUMBO_TAG_HTML) && (n->v.element.tag == GUMBO_TAG_HTML)) {
+            continue;
+        }
+        if (!differ.SameNode(o, n)) {
+            return false;
+        }
+    }
+
+    GumboNode *old_root = old_doc.get_root_node();
+    GumboNode *new_root = new_doc.get_root_node();
+    GumboNode *old_body = old_doc.get_body_node();
+    GumboNode *new_body = new_doc.get_body_node();
+    // a body made up by gumbo is not in the browser's DOM
+    if (!old_root || !new_root || !old_body || !new_body ||
+        (old_body->parse_flags & GUMBO_INSERTION_IMPLIED) ||
+        (new_body->parse_flags & GUMBO_INSERTION_IMPLIED) ||
+        !differ.SameAttributes(old_root, new_root) ||
+        !differ.SameAttributes(old_body, new_body) ||
+        (old_root->v.element.children.length != new_root->v.element.children.length)) {
+        return false;
+    }
+    GumboVector *old_children = &old_root->v.element.children;
+    GumboVector *new_children = &new_root->v.element.children;
+    for (unsigned int i = 0; i < old_children->length; ++i) {
+        GumboNode *o = static_cast<GumboNode *>(old_children->data[i]);
+        GumboNode *n = static_cast<GumboNode *>(new_children->data[i]);
+        if ((o == old_body) != (n == new_body)) {
+            return false;
+        }
+        if ((o != old_body) && !differ.SameNode(o, n)) {
+            return false;
+        }
+    }
+    QList<int> path;
+    QStringList names;
+    if (!differ.DiffChildren(old_body, new_body, path, names)) {
+        ops.clear();
+        return false;
+    }
+    return true;
+}
+
+
+QString DOMDiff::ToJSON(const QList<PatchOp> &ops)
+{
+    QJsonArray patch;
+    foreach(const PatchOp &op, ops) {
+        QJsonObject jop;
+        QJsonArray path;
+        foreach(int index, op.path) {
+            path.append(index);
+        }
+        jop["path"] = path;
+        jop["names"] = QJsonArray::fromStringList(op.names);
+        switch (op.kind) {
+            case PatchOp::SetText:
+                jop["op"] = "text";
+                jop["old"] = op.old_text;
+                jop["value"] = op.value;
+                break;
+            case PatchOp::SetAttributes: {
+                jop["op"] = "attributes";
+                QJsonArray attributes;
+                for (int i = 0; i < op.attributes.count(); ++i) {
+                    attributes.append(QJsonArray() << op.attributes.at(i).first << op.attributes.at(i).second);
+                }
+                jop["attributes"] = attributes;
+                break;
+            }
+            case PatchOp::Replace:
+                jop["op"] = "replace";
+                jop["value"] = op.value;
+                break;
+            case PatchOp::Remove:
+                jop["op"] = "remove";
+                break;
+            case PatchOp::Insert:
+                jop["op"] = "insert";
+                jop["before"] = op.before;
+                jop["before_name"] = op.before_name;
+                jop["value"] = op.value;
+                break;
+        }
+        patch.append(jop);
+    }
+    return QString::fromUtf8(QJsonDocument(patch).toJson(QJsonDocument::Compact));
+}
+
+
+// Unchanged runs at the start and end of the child lists are skipped.
+// In what is left, nodes of the same kind are paired up from both ends
+// and patched recursively, the rest is removed from the old list and
+// inserted from the new one.
+bool DOMDiff::DiffChildren(GumboNode *old_node, GumboNode *new_node, QList<int> &path, QStringList &names)
+{
+    GumboVector *oc = &old_node->v.element.children;
+    GumboVector *nc = &new_node->v.element.children;
+    int olen = oc->length;
+    int nlen = nc->length;
+    auto ochild = [oc](int i) { return static_cast<GumboNode *>(oc->data[i]); };
+    auto nchild = [nc](int i) { return static_cast<GumboNode *>(nc->data[i]); };
+
+    int start = 0;
+    while ((start < olen) && (start < nlen) && SameNode(ochild(start), nchild(start))) {
+        start++;
+    }
+    int oend = olen;
+    int nend = nlen;
+    while ((oend > start) && (nend > start) && SameNode(ochild(oend - 1), nchild(nend - 1))) {
+        oend--;
+        nend--;
+    }
+
+    while ((start < oend) && (start < nend) && SameKind(ochild(start), nchild(start))) {
+        path.append(start);
+        names.append(NodeName(ochild(start)));
+        bool ok = PatchPair(ochild(start), nchild(start), path, names);
+        path.removeLast();
+        names.removeLast();
+        if (!ok) {
+            return false;
+        }
+        start++;
+    }
+    while ((oend > start) && (nend > start) && SameKind(ochild(oend - 1), nchild(nend - 1))) {
+        path.append(oend - 1);
+        names.append(NodeName(ochild(oend - 1)));
+        bool ok = PatchPair(ochild(oend - 1), nchild(nend - 1), path, names);
+        path.removeLast();
+        names.removeLast();
+        if (!ok) {
+            return false;
+        }
+        oend--;
+        nend--;
+    }
+
+    for (int i = start; i < oend; ++i) {
+        PatchOp op;
+        op.kind = PatchOp::Remove;
+        op.path = path;
+        op.path.append(i);
+        op.names = names;
+        op.names.append(NodeName(ochild(i)));
+        op.before = -1;
+        m_Ops.append(op);
+    }
+
+    if (start < nend) {
+        std::string xhtml;
+        for (int i = start; i < nend; ++i) {
+            if (!Serialize(nchild(i), xhtml)) {
+                return false;
+            }
+        }
+        PatchOp op;
+        op.kind = PatchOp::Insert;
+        op.path = path;
+        op.names = names;
+        op.before = -1;
+        if (oend < olen) {
+            op.before = oend;
+            op.before_name = NodeName(ochild(oend));
+        }
+        op.value = QString::fromStdString(xhtml);
+        m_Ops.append(op);
+    }
+
+    return m_Ops.count() <= MAX_PATCH_OPS;
+}
+
+
+bool DOMDiff::PatchPair(GumboNode *old_node, GumboNode *new_node, QList<int> &path, QStringList &names)
+{
+    if (SameNode(old_node, new_node)) {
+        return true;
+    }
+
+    if (is_text(old_node)) {
+        PatchOp op;
+        op.kind = PatchOp::SetText;
+        op.path = path;
+        op.names = names;
+        op.before = -1;
+        op.old_text = QString::fromUtf8(old_node->v.text.text);
+        op.value = QString::fromUtf8(new_node->v.text.text);
+        m_Ops.append(op);
+        return true;
+    }
+
+    if (!is_element(old_node)) {
+        return AddReplace(new_node, path, names);
+    }
+
+    if (!SameAttributes(old_node, new_node)) {
+        if (!AttributesPatchable(old_node) || !AttributesPatchable(new_node)) {
+            return AddReplace(new_node, path, names);
+        }
+        PatchOp op;
+        op.kind = PatchOp::SetAttributes;
+        op.path = path;
+        op.names = names;
+        op.before = -1;
+        GumboVector *attribs = &new_node->v.element.attributes;
+        for (unsigned int i = 0; i < attribs->length; ++i) {
+            GumboAttribute *at = static_cast<GumboAttribute *>(attribs->data[i]);
+            op.attributes.append(qMakePair(QString::fromStdString(attribute_name(at)), QString::fromUtf8(at->value)));
+        }
+        m_Ops.append(op);
+    }
+
+    return DiffChildren(old_node, new_node, path, names);
+}
+
+
+bool DOMDiff::AddReplace(GumboNode *new_node, const QList<int> &path, const QStringList &names)
+{
+    std::string xhtml;
+    if (!Serialize(new_node, xhtml)) {
+        return false;
+    }
+    PatchOp op;
+    op.kind = PatchOp::Replace;
+    op.path = path;
+    op.names = names;
+    op.before = -1;
+    op.value = QString::fromStdString(xhtml);
+    m_Ops.append(op);
+    return true;
+}
+
+
+bool DOMDiff::SameKind(GumboNode *a, GumboNode *b) const
+{
+    if (is_text(a) || is_text(b)) {
+        return is_text(a) && is_text(b);
+    }
+    if (is_element(a) && is_element(b)) {
+        return NodeName(a) == NodeName(b) &&
+               (a->v.element.tag_namespace == b->v.element.tag_namespace);
+    }
+    return a->type == b->type;
+}
+
+
+bool DOMDiff::SameNode(GumboNode *a, GumboNode *b) const
+{
+    if (!SameKind(a, b)) {
+        return false;
+    }
+    if (!is_element(a)) {
+        return strcmp(a->v.text.text, b->v.text.text) == 0;
+    }
+    if (!SameAttributes(a, b)) {
+        return false;
+    }
+    GumboVector *ac = &a->v.element.children;
+    GumboVector *bc = &b->v.element.children;
+    if (ac->length != bc->length) {
+        return false;
+    }
+    for (unsigned int i = 0; i < ac->length; ++i) {
+        if (!SameNode(static_cast<GumboNode *>(ac->data[i]), static_cast<GumboNode *>(bc->data[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool DOMDiff::SameAttributes(GumboNode *a, GumboNode *b) const
+{
+    const GumboVector *aa = &a->v.element.attributes;
+    const GumboVector *ba = &b->v.element.attributes;
+    if (aa->length != ba->length) {
+        return false;
+    }
+    for (unsigned int i = 0; i < aa->length; ++i) {
+        GumboAttribute *x = static_cast<GumboAttribute *>(aa->data[i]);
+        GumboAttribute *y = static_cast<GumboAttribute *>(ba->data[i]);
+        if ((x->attr_namespace != y->attr_namespace) ||
+            (strcmp(x->name, y->name) != 0) ||
+            (strcmp(x->value, y->value) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool DOMDiff::AttributesPatchable(GumboNode *node) const
+{
+    const GumboVector *attribs = &node->v.element.attributes;
+    for (unsigned int i = 0; i < attribs->length; ++i) {
+        QString name = QString::fromStdString(attribute_name(static_cast<GumboAttribute *>(attribs->data[i])));
+        if (name == "xmlns") {
+            return false;
+        }
+        int colon = name.indexOf(':');
+        if ((colon != -1) && !PATCHABLE_PREFIXES.contains(name.left(colon))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+QString DOMDiff::NodeName(GumboNode *node) const
+{
+    switch (node->type) {
+        case GUMBO_NODE_TEXT:
+        case GUMBO_NODE_WHITESPACE:
+            return "#text";
+        case GUMBO_NODE_COMMENT:
+            return "#comment";
+        case GUMBO_NODE_CDATA:
+            return "#cdata-section";
+        case GUMBO_NODE_ELEMENT:
+        case GUMBO_NODE_TEMPLATE:
+            return QString::fromStdString(m_OldDoc.get_tag_name(node));
+        default:
+            return "#document";
+    }
+}
+
+
+bool DOMDiff::Serialize(GumboNode *node, std::string &out, bool fragment_root) const
+{
+    switch (node->type) {
+        case GUMBO_NODE_TEXT:
+        case GUMBO_NODE_WHITESPACE:
+            append_escaped(out, node->v.text.text, false);
+            return true;
+        case GUMBO_NODE_COMMENT:
+            out.append("<!--").append(node->v.text.text).append("-->");
+            return true;
+        case GUMBO_NODE_CDATA:
+            out.append("<![CDATA[").append(node->v.text.text).append("]]>");
+            return true;
+        case GUMBO_NODE_ELEMENT:
+        case GUMBO_NODE_TEMPLATE:
+            break;
+        default:
+            return false;
+    }
+
+    // MathJax only typesets what it finds when the page loads
+    GumboNamespaceEnum ns = node->v.element.tag_namespace;
+    if (ns == GUMBO_NAMESPACE_MATHML) {
+        return false;
+    }
+
+    std::string tagname = m_OldDoc.get_tag_name(node);
+    out.append("<").append(tagname);
+
+    // fragments are parsed in the context of their new parent, so declare
+    // the namespace at the top and wherever it changes
+    bool declare_ns = fragment_root || (node->parent->v.element.tag_namespace != ns);
+    GumboVector *attribs = &node->v.element.attributes;
+    if (declare_ns && !gumbo_get_attribute(attribs, "xmlns")) {
+        out.append(" xmlns=\"").append(ELEMENT_NAMESPACES[ns]).append("\"");
+    }
+    for (unsigned int i = 0; i < attribs->length; ++i) {
+        GumboAttribute *at = static_cast<GumboAttribute *>(attribs->data[i]);
+        out.append(" ").append(attribute_name(at)).append("=\"");
+        append_escaped(out, at->value, true);
+        out.append("\"");
+    }
+
+    GumboVector *children = &node->v.element.children;
+    if ((children->length == 0) && ((ns != GUMBO_NAMESPACE_HTML) || VOID_TAGS.contains(tagname))) {
+        out.append("/>");
+        return true;
+    }
+    out.append(">");
+    for (unsigned int i = 0; i < children->length; ++i) {
+        if (!Serialize(static_cast<GumboNode *>(children->data[i]), out, false)) {
+            return false;
+        }
+    }
+    out.append("</").append(tagname).append(">");
+    return true;
+}
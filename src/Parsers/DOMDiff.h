@@ -0,0 +1,90 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#ifndef DOM_DIFF
+#define DOM_DIFF
+
+#include <string>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include "gumbo.h"
+
+class GumboInterface;
+
+// Computes the changes that turn the body of one xhtml document into
+// the body of another, so that Preview can patch the page it shows
+// instead of loading it again.
+//
+// Nodes are addressed the way the browser's DOM sees the xhtml:
+// by child node index (text, comments and elements alike) from the
+// body element down, each step carrying the node name expected there.
+// All paths refer to the old document.
+
+class DOMDiff
+{
+public:
+
+    struct PatchOp {
+        enum Kind { SetText, SetAttributes, Replace, Remove, Insert };
+        Kind        kind;
+        QList<int>  path;        // child node indexes from body to the target (Insert: to the parent)
+        QStringList names;       // expected node name at each step: tag, #text, #comment, #cdata-section
+        int         before;      // Insert: index of the child to insert in front of, -1 to append
+        QString     before_name; // Insert: expected node name of that child
+        QString     old_text;    // SetText: the text the node must still have
+        QString     value;       // SetText: new text, Replace and Insert: xhtml to insert
+        QList<QPair<QString, QString> > attributes; // SetAttributes: the complete new attributes
+    };
+
+    // Returns false if the change can not be shown by patching the body:
+    // anything outside the body or its attributes changed, the new source
+    // has well-formedness errors, new MathML would need MathJax or the
+    // patch would be too large.  An empty ops list means nothing changed.
+    static bool Diff(const GumboInterface &old_doc, const GumboInterface &new_doc, QList<PatchOp> &ops);
+
+    // the patch as the JSON array the preview patch script expects
+    static QString ToJSON(const QList<PatchOp> &ops);
+
+private:
+
+    DOMDiff(const GumboInterface &old_doc, QList<PatchOp> &ops);
+
+    bool DiffChildren(GumboNode *old_node, GumboNode *new_node, QList<int> &path, QStringList &names);
+    bool PatchPair(GumboNode *old_node, GumboNode *new_node, QList<int> &path, QStringList &names);
+    bool AddReplace(GumboNode *new_node, const QList<int> &path, const QStringList &names);
+
+    bool SameNode(GumboNode *a, GumboNode *b) const;
+    bool SameKind(GumboNode *a, GumboNode *b) const;
+    bool SameAttributes(GumboNode *a, GumboNode *b) const;
+    bool AttributesPatchable(GumboNode *node) const;
+    QString NodeName(GumboNode *node) const;
+
+    // serializes a node as well-formed xhtml with its namespaces declared,
+    // returns false if it holds MathML
+    bool Serialize(GumboNode *node, std::string &out, bool fragment_root = true) const;
+
+    const GumboInterface &m_OldDoc;
+    QList<PatchOp>       &m_Ops;
+};
+
+#endif
@@ -0,0 +1,277 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "gumbo.h"
+#include "Parsers/GumboArena.h"
+
+// Every block handed to gumbo starts with this header, 16 bytes
+// so that the memory after it keeps malloc's alignment.
+struct BlockHeader {
+    size_t size;
+    size_t kind;
+};
+
+static const size_t HEADER_SIZE   = 16;
+static const size_t HEAP_BLOCK    = 0x48454150;   // "HEAP"
+static const size_t ARENA_BLOCK   = 0x4152454E;   // "AREN"
+
+static const size_t FIRST_BLOCK_SIZE = 64 * 1024;
+static const size_t MAX_BLOCK_SIZE   = 4 * 1024 * 1024;
+
+// what a spare arena may keep between parses, so that idle
+// worker threads do not hold on to the memory of a huge file
+static const size_t MAX_RETAINED_SIZE = 4 * 1024 * 1024;
+
+static thread_local GumboArena *t_CurrentArena = nullptr;
+
+// the calling thread's arena for its next parse
+struct SpareArena {
+    GumboArena *arena = nullptr;
+    ~SpareArena() { delete arena; }
+};
+
+static thread_local SpareArena t_Spare;
+
+
+static inline size_t aligned(size_t size)
+{
+    return (size + HEADER_SIZE - 1) & ~(HEADER_SIZE - 1);
+}
+
+
+static inline BlockHeader *header_of(void *ptr)
+{
+    return reinterpret_cast<BlockHeader *>(static_cast<char *>(ptr) - HEADER_SIZE);
+}
+
+
+static void *heap_allocate(size_t size)
+{
+    BlockHeader *header = static_cast<BlockHeader *>(malloc(HEADER_SIZE + size));
+    if (!header) {
+        return NULL;
+    }
+    header->size = size;
+    header->kind = HEAP_BLOCK;
+    return reinterpret_cast<char *>(header) + HEADER_SIZE;
+}
+
+
+void GumboArena::InstallAllocator()
+{
+    gumbo_memory_set_allocator(GumboArena::Reallocate);
+    gumbo_memory_set_free(GumboArena::Free);
+}
+
+
+GumboArena *GumboArena::Acquire()
+{
+    GumboArena *arena = t_Spare.arena;
+    if (arena) {
+        t_Spare.arena = nullptr;
+        return arena;
+    }
+    return new GumboArena();
+}
+
+
+void GumboArena::Release(GumboArena *arena)
+{
+    if (!arena) {
+        return;
+    }
+    if (t_Spare.arena) {
+        delete arena;
+        return;
+    }
+    arena->Reset();
+    t_Spare.arena = arena;
+}
+
+
+GumboArena::Scope::Scope(GumboArena *arena)
+    : m_Previous(t_CurrentArena)
+{
+    t_CurrentArena = arena;
+}
+
+
+GumboArena::Scope::~Scope()
+{
+    t_CurrentArena = m_Previous;
+}
+
+
+GumboArena::GumboArena()
+    : m_NextBlockSize(FIRST_BLOCK_SIZE),
+      m_BlockStart(nullptr),
+      m_Cursor(nullptr),
+      m_Limit(nullptr)
+{
+}
+
+
+GumboArena::~GumboArena()
+{
+    for (char *block : m_Blocks) {
+        free(block);
+    }
+}
+
+
+void *GumboArena::Reallocate(void *ptr, size_t size)
+{
+    GumboArena *arena = t_CurrentArena;
+    if (!ptr) {
+        return arena ? arena->Allocate(size) : heap_allocate(size);
+    }
+    BlockHeader *header = header_of(ptr);
+    if ((header->kind == HEAP_BLOCK) && !arena) {
+        header = static_cast<BlockHeader *>(realloc(header, HEADER_SIZE + size));
+        if (!header) {
+            return NULL;
+        }
+        header->size = size;
+        return reinterpret_cast<char *>(header) + HEADER_SIZE;
+    }
+    // gumbo's vectors and string buffers mostly grow
+    // while they are the last thing allocated
+    if (arena && (header->kind == ARENA_BLOCK) && arena->Resize(ptr, size)) {
+        return ptr;
+    }
+    void *moved = arena ? arena->Allocate(size) : heap_allocate(size);
+    if (!moved) {
+        return NULL;
+    }
+    memcpy(moved, ptr, std::min(header->size, size));
+    Free(ptr);
+    return moved;
+}
+
+
+void GumboArena::Free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    BlockHeader *header = header_of(ptr);
+    if (header->kind == HEAP_BLOCK) {
+        free(header);
+        return;
+    }
+    // arena memory goes away with its arena, only the parse's temporaries
+    // freed right after they were made can be handed back early
+    if (t_CurrentArena) {
+        t_CurrentArena->Rollback(ptr);
+    }
+}
+
+
+void *GumboArena::Allocate(size_t size)
+{
+    size_t needed = HEADER_SIZE + aligned(size);
+    if ((m_Cursor == nullptr) || (needed > size_t(m_Limit - m_Cursor))) {
+        if (!AddBlock(needed)) {
+            return NULL;
+        }
+    }
+    BlockHeader *header = reinterpret_cast<BlockHeader *>(m_Cursor);
+    header->size = size;
+    header->kind = ARENA_BLOCK;
+    m_Cursor += needed;
+    return reinterpret_cast<char *>(header) + HEADER_SIZE;
+}
+
+
+bool GumboArena::Resize(void *ptr, size_t size)
+{
+    char *start = static_cast<char *>(ptr);
+    BlockHeader *header = header_of(ptr);
+    if ((start < m_BlockStart) || (start + aligned(header->size) != m_Cursor)) {
+        return false;
+    }
+    if (aligned(size) > size_t(m_Limit - start)) {
+        return false;
+    }
+    m_Cursor = start + aligned(size);
+    header->size = size;
+    return true;
+}
+
+
+void GumboArena::Rollback(void *ptr)
+{
+    char *start = static_cast<char *>(ptr);
+    BlockHeader *header = header_of(ptr);
+    if ((start >= m_BlockStart) && (start + aligned(header->size) == m_Cursor)) {
+        m_Cursor = reinterpret_cast<char *>(header);
+    }
+}
+
+
+bool GumboArena::AddBlock(size_t needed)
+{
+    size_t size = std::max(needed, m_NextBlockSize);
+    char *block = static_cast<char *>(malloc(size));
+    if (!block) {
+        return false;
+    }
+    m_Blocks.push_back(block);
+    m_BlockSizes.push_back(size);
+    m_NextBlockSize = std::min(m_NextBlockSize * 2, MAX_BLOCK_SIZE);
+    m_BlockStart = block;
+    m_Cursor = block;
+    m_Limit = block + size;
+    return true;
+}
+
+
+// Several blocks are merged into one as large as all of them (up to
+// MAX_RETAINED_SIZE), so that the next parse of a similar file fits
+// into a single block.
+void GumboArena::Reset()
+{
+    size_t total = 0;
+    for (size_t size : m_BlockSizes) {
+        total += size;
+    }
+    if (m_Blocks.empty()) {
+        return;
+    }
+    if ((m_Blocks.size() == 1) && (total <= MAX_RETAINED_SIZE)) {
+        m_Cursor = m_BlockStart;
+        return;
+    }
+    for (char *block : m_Blocks) {
+        free(block);
+    }
+    m_Blocks.clear();
+    m_BlockSizes.clear();
+    m_BlockStart = nullptr;
+    m_Cursor = nullptr;
+    m_Limit = nullptr;
+    m_NextBlockSize = std::min(std::max(total, FIRST_BLOCK_SIZE), MAX_RETAINED_SIZE);
+    AddBlock(m_NextBlockSize);
+}
@@ -0,0 +1,99 @@
+/************************************************************************
+**
+**  Copyright (C) 2026 Kevin B. Hendricks, Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#ifndef GUMBO_ARENA
+#define GUMBO_ARENA
+
+#include <stddef.h>
+#include <vector>
+
+// A bump allocator for gumbo parse trees.
+//
+// gumbo only offers a single process wide realloc/free pair, so the
+// installed pair puts a small header in front of every block saying
+// where it came from.  While a Scope is alive on a thread, gumbo's
+// allocations on that thread come from the scope's arena; everything
+// else (edits made to a tree after the parse, python plugins using
+// the shared library) still goes to the heap.  Freeing arena memory
+// does nothing, it all goes away when the arena is released, so
+// gumbo_destroy_output no longer makes a free() call per node.
+//
+// Released arenas are reset and kept by the releasing thread for its
+// next parse, so the QtConcurrent workers keep reusing the same memory.
+
+class GumboArena
+{
+public:
+
+    // Must be called before gumbo allocates anything (start of main),
+    // blocks allocated by plain realloc can not be freed afterwards.
+    static void InstallAllocator();
+
+    // an arena from the calling thread's spare or a new one
+    static GumboArena *Acquire();
+
+    // resets the arena, everything allocated from it is gone,
+    // and keeps it as the calling thread's spare
+    static void Release(GumboArena *arena);
+
+    // routes the calling thread's gumbo allocations to arena
+    // for as long as it exists
+    class Scope
+    {
+    public:
+        explicit Scope(GumboArena *arena);
+        ~Scope();
+
+    private:
+        GumboArena *m_Previous;
+    };
+
+private:
+
+    GumboArena();
+    ~GumboArena();
+
+    // the functions handed to gumbo
+    static void *Reallocate(void *ptr, size_t size);
+    static void Free(void *ptr);
+
+    void *Allocate(size_t size);
+
+    // grows or shrinks the most recent allocation in place if possible
+    bool Resize(void *ptr, size_t size);
+
+    // gives the most recent allocation back, other blocks are kept
+    void Rollback(void *ptr);
+
+    bool AddBlock(size_t needed);
+    void Reset();
+
+    friend struct SpareArena;
+
+    std::vector<char *> m_Blocks;
+    std::vector<size_t> m_BlockSizes;
+    size_t m_NextBlockSize;
+    char * m_BlockStart;
+    char * m_Cursor;
+    char * m_Limit;
+};
+
+#endif
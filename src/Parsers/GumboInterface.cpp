@@ -19,6 +19,9 @@
 **
 *************************************************************************/
 
+#include <cstring>
+#include <vector>
+
 #include <QString>
 #include <QStringList>
 #include <QRegularExpression>
@@ -32,6 +35,7 @@
 #include "Query/CSelection.h"
 #include "Query/CNode.h"
 #include "Misc/PrettyPrintProps.h"
+#include "Parsers/GumboArena.h"
 #include "Parsers/GumboInterface.h"
 #include "string_buffer.h"
 #include "error.h"
@@ -97,6 +101,88 @@ static std::unordered_set<std::string> href_src_tags       = {
 };
 
 
+// membership of a tag name in the sets above, as bit flags
+enum TagFlags {
+    TAG_NONBREAKING_INLINE  = 1 << 0,
+    TAG_PRESERVE_WHITESPACE = 1 << 1,
+    TAG_SPECIAL_HANDLING    = 1 << 2,
+    TAG_NO_ENTITY_SUB       = 1 << 3,
+    TAG_VOID                = 1 << 4,
+    TAG_STRUCTURAL          = 1 << 5,
+    TAG_HREF_SRC            = 1 << 6
+};
+
+
+static unsigned int tag_flags_for_name(const std::string &name)
+{
+    unsigned int flags = 0;
+    if (nonbreaking_inline.count(name))  flags |= TAG_NONBREAKING_INLINE;
+    if (preserve_whitespace.count(name)) flags |= TAG_PRESERVE_WHITESPACE;
+    if (special_handling.count(name))    flags |= TAG_SPECIAL_HANDLING;
+    if (no_entity_sub.count(name))       flags |= TAG_NO_ENTITY_SUB;
+    if (void_tags.count(name))           flags |= TAG_VOID;
+    if (structural_tags.count(name))     flags |= TAG_STRUCTURAL;
+    if (href_src_tags.count(name))       flags |= TAG_HREF_SRC;
+    return flags;
+}
+
+
+// The flags of every known tag indexed by GumboTag.  Built once from
+// the sets above so they remain the only place the tag lists are kept.
+static const std::vector<unsigned int> &tag_flags_table()
+{
+    static const std::vector<unsigned int> table = [] {
+        std::vector<unsigned int> flags(GUMBO_TAG_LAST + 1, 0);
+        for (int tag = 0; tag < GUMBO_TAG_UNKNOWN; ++tag) {
+            flags[tag] = tag_flags_for_name(gumbo_normalized_tagname(static_cast<GumboTag>(tag)));
+        }
+        return flags;
+    }();
+    return table;
+}
+
+
+static const char * WHITESPACE_CHARS = " \n\r\t\v\f";
+
+
+// rtrim what was appended to out since start, never what came before
+static void rtrim_from(std::string &out, size_t start)
+{
+    size_t last = out.find_last_not_of(WHITESPACE_CHARS);
+    if ((last == std::string::npos) || (last < start)) {
+        out.erase(start);
+    } else {
+        out.erase(last + 1);
+    }
+}
+
+
+// Appends text with &, <, > and the given quote character (0 for none)
+// replaced by their entities in a single pass, copying the runs of
+// characters in between as a whole.
+static void append_escaped(std::string &out, const char *text, size_t length, char quote)
+{
+    size_t run = 0;
+    for (size_t i = 0; i < length; ++i) {
+        const char *entity;
+        switch (text[i]) {
+            case '&':  entity = "&amp;"; break;
+            case '<':  entity = "&lt;"; break;
+            case '>':  entity = "&gt;"; break;
+            case '"':  entity = (quote == '"') ? "&quot;" : NULL; break;
+            case '\'': entity = (quote == '\'') ? "&apos;" : NULL; break;
+            default:   entity = NULL; break;
+        }
+        if (entity) {
+            out.append(text + run, i - run);
+            out.append(entity);
+            run = i + 1;
+        }
+    }
+    out.append(text + run, length - run);
+}
+
+
 static const QChar POUND_SIGN    = QChar::fromLatin1('#');
 static const QChar FORWARD_SLASH = QChar::fromLatin1('/');
 static const std::string aSRC = std::string("src");
@@ -124,6 +210,7 @@ static const char * attribute_nsprefixes[4] = { "", "xlink:", "xml:", "xmlns:" }
 GumboInterface::GumboInterface(const QString &source, const QString &version)
     : m_source(source),
       m_output(NULL),
+      m_arena(NULL),
       m_utf8src(""),
       m_sourceupdates(EmptyHash),
       m_newcsslinks(""),
@@ -139,6 +226,7 @@ GumboInterface::GumboInterface(const QString &source, const QString &version)
 GumboInterface::GumboInterface(const QString &source, const QString &version, const QHash<QString,QString> & source_updates)
     : m_source(source),
       m_output(NULL),
+      m_arena(NULL),
       m_utf8src(""),
       m_sourceupdates(source_updates),
       m_newcsslinks(""),
@@ -154,14 +242,27 @@ GumboInterface::GumboInterface(const QString &source, const QString &version, co
 GumboInterface::~GumboInterface()
 {
     if (m_output != NULL) {
+        // a walk without any real frees for the parts that came from
+        // the arena, only later edits to the tree live on the heap
         gumbo_destroy_output(m_output);
         m_output = NULL;
         m_utf8src = "";
     }
+    GumboArena::Release(m_arena);
+}
+
+
+// parse trees are built in an arena of their own that is kept (and
+// handed back to the destroying thread's spare) along with the tree
+void GumboInterface::acquire_arena() const
+{
+    if (m_arena == NULL) {
+        m_arena = GumboArena::Acquire();
+    }
 }
 
 
-void GumboInterface::parse()
+void GumboInterface::parse() const
 {
     if (!m_source.isEmpty() && (m_output == NULL)) {
 
@@ -186,9 +287,9 @@ void GumboInterface::parse()
         myoptions.max_tree_depth = 400;
         myoptions.max_errors = 50;
 
-        // GumboInterface::m_mutex.lock();
+        acquire_arena();
+        GumboArena::Scope arena_scope(m_arena);
         m_output = gumbo_parse_with_options(&myoptions, m_utf8src.data(), m_utf8src.length());
-        // GumboInterface::m_mutex.unlock();
     }
 }
 
@@ -210,10 +311,13 @@ void GumboInterface::parse_fragment()
         myoptions.max_tree_depth = 400;
         myoptions.max_errors = 50;
 
+        // parsed in the context of a body element, the fragment's
+        // nodes end up as the children of the root html element
         m_utf8src = m_source.toStdString();
+        acquire_arena();
+        GumboArena::Scope arena_scope(m_arena);
         m_output = gumbo_parse_fragment(&myoptions, m_utf8src.data(), m_utf8src.length(),
                                         GUMBO_TAG_BODY, GUMBO_NAMESPACE_HTML);
-        m_output = gumbo_parse_with_options(&myoptions, m_utf8src.data(), m_utf8src.length());
     }
 }
 
@@ -240,7 +344,8 @@ QString GumboInterface::get_fragment_xhtml()
         if (m_output == NULL) {
             parse_fragment();
         }
-        std::string utf8out = serialize(m_output->document);
+        // only the fragment itself, no doctype, html, head or body around it
+        std::string utf8out = serialize_contents(m_output->root);
         rtrim(utf8out);
         result = QString::fromStdString(utf8out);
     }
@@ -262,7 +367,7 @@ QString GumboInterface::getxhtml()
     return result;
 }
 
-QList<GumboNode *> GumboInterface::findnodes(const QString &aSelector)
+QList<GumboNode *> GumboInterface::findnodes(const QString &aSelector) const
 {
     QList<GumboNode*> nodes;
     if (!m_source.isEmpty()) {
@@ -279,7 +384,7 @@ QList<GumboNode *> GumboInterface::findnodes(const QString &aSelector)
     return nodes;
 }
 
-CSelection GumboInterface::find(const QString &aSelector)
+CSelection GumboInterface::find(const QString &aSelector) const
 {
     if (!m_source.isEmpty()) {
         if (m_output == NULL) {
@@ -292,6 +397,17 @@ CSelection GumboInterface::find(const QString &aSelector)
     return CSelection(NULL);
 }
 
+std::vector<bool> GumboInterface::findmatches(const CSelectorIndex &index) const
+{
+    if (!m_source.isEmpty()) {
+        if (m_output == NULL) {
+            parse();
+        }
+        return index.matchAll(m_output->root);
+    }
+    return std::vector<bool>();
+}
+
 
 QString GumboInterface::prettyprint(bool keep_whitespace)
 {
@@ -309,7 +425,7 @@ QString GumboInterface::prettyprint(bool keep_whitespace)
 }
 
 
-QStringList GumboInterface::get_all_properties()
+QStringList GumboInterface::get_all_properties() const
 {
     QStringList properties;
     if (!m_source.isEmpty()) {
@@ -397,7 +513,7 @@ QString GumboInterface::perform_javascript_updates(const QString& newjslinks)
 }
 
 
-GumboNode * GumboInterface::get_document_node()
+GumboNode * GumboInterface::get_document_node() const
 {
     if (!m_source.isEmpty()) {
         if (m_output == NULL) {
@@ -408,7 +524,7 @@ GumboNode * GumboInterface::get_document_node()
 }
 
 
-GumboNode * GumboInterface::get_root_node() {
+GumboNode * GumboInterface::get_root_node() const {
     if (!m_source.isEmpty()) {
         if (m_output == NULL) {
             parse();
@@ -418,7 +534,7 @@ GumboNode * GumboInterface::get_root_node() {
 }
 
 
-GumboNode * GumboInterface::get_body_node()
+GumboNode * GumboInterface::get_body_node() const
 {
     if (!m_source.isEmpty()) {
         if (m_output == NULL) {
@@ -451,7 +567,7 @@ QString GumboInterface::get_body_contents()
     return QString::fromStdString(results);
 }
 
-QString GumboInterface::get_body_text() 
+QString GumboInterface::get_body_text() const
 {
     if (!m_source.isEmpty()) {
         if (m_output == NULL) {
@@ -468,7 +584,7 @@ QString GumboInterface::get_body_text()
 }
 
 
-QStringList GumboInterface::get_properties(GumboNode* node)
+QStringList GumboInterface::get_properties(GumboNode* node) const
 {
     if (node->type != GUMBO_NODE_ELEMENT) {
         return QStringList();
@@ -490,7 +606,7 @@ QStringList GumboInterface::get_properties(GumboNode* node)
 }
 
 
-QString GumboInterface::get_qwebpath_to_node(GumboNode* node) 
+QString GumboInterface::get_qwebpath_to_node(GumboNode* node) const
 {
     QStringList path_pieces;
     GumboNode* anode = node;
@@ -523,7 +639,7 @@ QString GumboInterface::get_qwebpath_to_node(GumboNode* node)
 }
 
 
-GumboNode* GumboInterface::get_node_from_qwebpath(QString webpath) 
+GumboNode* GumboInterface::get_node_from_qwebpath(QString webpath) const
 {
     QStringList path_pieces = webpath.split(",", Qt::SkipEmptyParts);
     GumboNode* node = get_root_node();
@@ -569,7 +685,7 @@ GumboNode* GumboInterface::get_node_from_qwebpath(QString webpath)
      return end_node;
 }
 
-QList<unsigned int> GumboInterface::get_path_to_node(GumboNode* node) 
+QList<unsigned int> GumboInterface::get_path_to_node(GumboNode* node) const
 {
     QList<unsigned int> apath = QList<unsigned int>();
     GumboNode* anode = node;
@@ -581,7 +697,7 @@ QList<unsigned int> GumboInterface::get_path_to_node(GumboNode* node)
 }
 
 
-GumboNode* GumboInterface::get_node_from_path(QList<unsigned int> & apath) 
+GumboNode* GumboInterface::get_node_from_path(QList<unsigned int> & apath) const
 {
    GumboNode* dest = get_root_node();
    foreach(unsigned int childnum, apath) {
@@ -622,6 +738,15 @@ QString GumboInterface::perform_body_updates(const QString & new_body)
 }
     
 
+bool GumboInterface::parsed_without_errors() const
+{
+    if (!m_source.isEmpty() && (m_output == NULL)) {
+        parse();
+    }
+    return (m_output != NULL) && (m_output->errors.length == 0);
+}
+
+
 QList<GumboWellFormedError> GumboInterface::error_check()
 {
     QList<GumboWellFormedError> errlist;
@@ -659,6 +784,8 @@ QList<GumboWellFormedError> GumboInterface::error_check()
             }
             line_offset--;
         }
+        acquire_arena();
+        GumboArena::Scope arena_scope(m_arena);
         m_output = gumbo_parse_with_options(&myoptions, m_utf8src.data(), m_utf8src.length());
     }
     // qDebug() << QString::fromStdString(m_utf8src);
@@ -701,6 +828,8 @@ QList<GumboWellFormedError> GumboInterface::fragment_error_check()
 
     if (!m_source.isEmpty() && (m_output == NULL)) {
         m_utf8src = m_source.toStdString();
+        acquire_arena();
+        GumboArena::Scope arena_scope(m_arena);
         m_output = gumbo_parse_fragment(&myoptions, m_utf8src.data(), m_utf8src.length(),
                                         GUMBO_TAG_BODY, GUMBO_NAMESPACE_HTML);
     }
@@ -723,7 +852,7 @@ QList<GumboWellFormedError> GumboInterface::fragment_error_check()
 }
 
 
-QList<GumboNode*> GumboInterface::get_nodes_with_comments(GumboNode * node)
+QList<GumboNode*> GumboInterface::get_nodes_with_comments(GumboNode * node) const
 {
     QList<GumboNode*> nodes;
     if (node->type == GUMBO_NODE_COMMENT) {
@@ -741,7 +870,7 @@ QList<GumboNode*> GumboInterface::get_nodes_with_comments(GumboNode * node)
 }
 
 
-QList<GumboNode*> GumboInterface::get_element_nodes_with_prefix(GumboNode * node, const std::string& prefix)
+QList<GumboNode*> GumboInterface::get_element_nodes_with_prefix(GumboNode * node, const std::string& prefix) const
 {
     QList<GumboNode*> nodes;
     if (node->type != GUMBO_NODE_ELEMENT) {
@@ -759,7 +888,7 @@ QList<GumboNode*> GumboInterface::get_element_nodes_with_prefix(GumboNode * node
 }
 
 
-QList<GumboNode*> GumboInterface::get_all_nodes_with_attribute(const QString& attname)
+QList<GumboNode*> GumboInterface::get_all_nodes_with_attribute(const QString& attname) const
 {
     QList<GumboNode*> nodes;
     if (!m_source.isEmpty()) {
@@ -772,7 +901,7 @@ QList<GumboNode*> GumboInterface::get_all_nodes_with_attribute(const QString& at
 }
 
 
-QList<GumboNode*> GumboInterface::get_nodes_with_attribute(GumboNode* node, const char * attname)
+QList<GumboNode*> GumboInterface::get_nodes_with_attribute(GumboNode* node, const char * attname) const
 {
   if (node->type != GUMBO_NODE_ELEMENT) {
     return QList<GumboNode*>();
@@ -790,7 +919,7 @@ QList<GumboNode*> GumboInterface::get_nodes_with_attribute(GumboNode* node, cons
 }
 
 
-QStringList GumboInterface::get_all_values_for_attribute(const QString& attname)
+QStringList GumboInterface::get_all_values_for_attribute(const QString& attname) const
 {
     QStringList attrvals;
     if (!m_source.isEmpty()) {
@@ -803,7 +932,7 @@ QStringList GumboInterface::get_all_values_for_attribute(const QString& attname)
 }
 
 
-QStringList  GumboInterface::get_values_for_attr(GumboNode* node, const char* attr_name) 
+QStringList  GumboInterface::get_values_for_attr(GumboNode* node, const char* attr_name) const
 {
     if (node->type != GUMBO_NODE_ELEMENT) {
         return QStringList();
@@ -821,7 +950,7 @@ QStringList  GumboInterface::get_values_for_attr(GumboNode* node, const char* at
 }
 
 
-QHash<QString,QString> GumboInterface::get_attributes_of_node(GumboNode* node)
+QHash<QString,QString> GumboInterface::get_attributes_of_node(GumboNode* node) const
 {
     QHash<QString,QString> node_atts;
     if (node->type != GUMBO_NODE_ELEMENT) {
@@ -838,7 +967,7 @@ QHash<QString,QString> GumboInterface::get_attributes_of_node(GumboNode* node)
 }
 
 
-QString GumboInterface::get_local_text_of_node(GumboNode* node)
+QString GumboInterface::get_local_text_of_node(GumboNode* node) const
 {
     QString  node_text;
     if (node->type != GUMBO_NODE_ELEMENT) {
@@ -872,7 +1001,7 @@ QString GumboInterface::get_local_text_of_node(GumboNode* node)
 }
 
 
-QList<GumboNode*> GumboInterface::get_all_nodes_with_tag(GumboTag tag)
+QList<GumboNode*> GumboInterface::get_all_nodes_with_tag(GumboTag tag) const
 {
     QList<GumboTag> tags;
     tags << tag;
@@ -880,7 +1009,7 @@ QList<GumboNode*> GumboInterface::get_all_nodes_with_tag(GumboTag tag)
 }
 
 
-QList<GumboNode*> GumboInterface::get_all_nodes_with_tags(const QList<GumboTag> & tags )
+QList<GumboNode*> GumboInterface::get_all_nodes_with_tags(const QList<GumboTag> & tags ) const
 {
     QList<GumboNode*> nodes;
     if (!m_source.isEmpty()) {
@@ -893,7 +1022,7 @@ QList<GumboNode*> GumboInterface::get_all_nodes_with_tags(const QList<GumboTag>
 }
 
 
-QList<GumboNode*>  GumboInterface::get_nodes_with_tags(GumboNode* node, const QList<GumboTag> & tags) 
+QList<GumboNode*>  GumboInterface::get_nodes_with_tags(GumboNode* node, const QList<GumboTag> & tags) const
 {
     if (node->type != GUMBO_NODE_ELEMENT) {
         return QList<GumboNode*>();
@@ -911,7 +1040,7 @@ QList<GumboNode*>  GumboInterface::get_nodes_with_tags(GumboNode* node, const QL
 }
 
 
-bool GumboInterface::in_set(std::unordered_set<std::string> &s, std::string &key)
+bool GumboInterface::in_set(std::unordered_set<std::string> &s, std::string &key) const
 {
     return s.find(key) != s.end();
 }
@@ -966,7 +1095,7 @@ void GumboInterface::condense_whitespace(std::string &s)
 }
 
 
-void GumboInterface::replace_all(std::string &s, const char * s1, const char * s2)
+void GumboInterface::replace_all(std::string &s, const char * s1, const char * s2) const
 {
     std::string t1(s1);
     size_t len = t1.length();
@@ -1077,28 +1206,23 @@ std::string GumboInterface::update_style_urls(const std::string &source)
 
 std::string GumboInterface::substitute_xml_entities_into_text(const std::string &text)
 {
-    std::string result = text;
-    // replacing & must come first 
-    replace_all(result, "&", "&amp;");
-    replace_all(result, "<", "&lt;");
-    replace_all(result, ">", "&gt;");
+    std::string result;
+    result.reserve(text.size() + text.size() / 16);
+    append_escaped(result, text.data(), text.size(), 0);
     return result;
 }
 
 
 std::string GumboInterface::substitute_xml_entities_into_attributes(char quote, const std::string &text)
 {
-    std::string result = substitute_xml_entities_into_text(text);
-    if (quote == '"') {
-        replace_all(result,"\"","&quot;");
-    } else if (quote == '\'') {
-        replace_all(result,"'","&apos;");
-    }
+    std::string result;
+    result.reserve(text.size() + text.size() / 16);
+    append_escaped(result, text.data(), text.size(), ((quote == '"') || (quote == '\'')) ? quote : 0);
     return result;
 }
 
 
-std::string GumboInterface::get_tag_name(GumboNode *node)
+std::string GumboInterface::get_tag_name(GumboNode *node) const
 {
   std::string tagname;
   if (node->type == GUMBO_NODE_DOCUMENT) {
@@ -1141,6 +1265,32 @@ std::string GumboInterface::get_tag_name(GumboNode *node)
 }
 
 
+// the name is only built as a string for svg and unknown tags, every
+// other element uses gumbo's static name and the precomputed flags
+void GumboInterface::get_tag_info(GumboNode *node, TagInfo &info) const
+{
+    if ((node->type != GUMBO_NODE_ELEMENT) && (node->type != GUMBO_NODE_TEMPLATE)) {
+        info.tag = GUMBO_TAG_LAST;
+        info.owned = get_tag_name(node);
+        info.name = info.owned.c_str();
+        info.length = info.owned.length();
+        info.flags = 0;
+        return;
+    }
+    info.tag = node->v.element.tag;
+    if ((info.tag != GUMBO_TAG_UNKNOWN) && (node->v.element.tag_namespace != GUMBO_NAMESPACE_SVG)) {
+        info.name = gumbo_normalized_tagname(info.tag);
+        info.length = strlen(info.name);
+        info.flags = tag_flags_table()[info.tag];
+        return;
+    }
+    info.owned = get_tag_name(node);
+    info.name = info.owned.c_str();
+    info.length = info.owned.length();
+    info.flags = tag_flags_for_name(info.owned);
+}
+
+
 // if missing leave it alone
 // if epub3 docytpe use it otherwise set it to epub2 docytpe
 std::string GumboInterface::build_doctype(GumboNode *node)
@@ -1171,7 +1321,7 @@ std::string GumboInterface::build_doctype(GumboNode *node)
 
 
 // deal properly with foreign namespaced attributes
-std::string GumboInterface::get_attribute_name(GumboAttribute * at)
+std::string GumboInterface::get_attribute_name(GumboAttribute * at) const
 {
     std::string attr_name = at->name;
     GumboAttributeNamespaceEnum attr_ns = at->attr_namespace;
@@ -1186,119 +1336,154 @@ std::string GumboInterface::get_attribute_name(GumboAttribute * at)
 std::string GumboInterface::build_attributes(GumboAttribute * at, bool no_entities, 
                                              bool run_src_updates, bool run_style_updates)
 {
-    std::string atts = " ";
-    std::string name = get_attribute_name(at);
-    std::string local_name = at->name;
-    atts.append(name);
-    std::string attvalue = at->value;
+    std::string atts;
+    append_attribute(atts, at, no_entities, run_src_updates, run_style_updates);
+    return atts;
+}
+
+
+void GumboInterface::append_attribute(std::string &out, GumboAttribute * at, bool no_entities,
+                                      bool run_src_updates, bool run_style_updates)
+{
+    const char * local_name = at->name;
+    out.push_back(' ');
+    if ((at->attr_namespace != GUMBO_ATTR_NAMESPACE_NONE) && (strcmp(local_name, "xmlns") != 0)) {
+        out.append(attribute_nsprefixes[at->attr_namespace]);
+    }
+    out.append(local_name);
 
-    if (run_src_updates && (local_name == aHREF || local_name == aSRC || 
-                            local_name == aPOSTER || local_name == aDATA ||
-                            local_name == aSRCSET || local_name == aALTIMG)) {
-        attvalue = update_attribute_value(attvalue);
+    const char * value = at->value;
+    size_t length = strlen(value);
+    std::string attvalue;
+    if (run_src_updates && ((local_name == aHREF) || (local_name == aSRC) ||
+                            (local_name == aPOSTER) || (local_name == aDATA) ||
+                            (local_name == aSRCSET) || (local_name == aALTIMG))) {
+        attvalue = update_attribute_value(std::string(value, length));
+        value = attvalue.data();
+        length = attvalue.length();
     }
 
-    if (run_style_updates && (local_name == "style")) {
-        attvalue = update_style_urls(attvalue);
+    if (run_style_updates && (strcmp(local_name, "style") == 0)) {
+        attvalue = update_style_urls(std::string(value, length));
+        value = attvalue.data();
+        length = attvalue.length();
     }
 
     // we handle empty attribute values like so: alt=""
     char quote = '"';
-    std::string qs="\"";
 
     // verify an original value existed since we create our own attributes
     // and if so determine the original quote character used if any
+    // (unquoted values keep their first character as quote but are
+    // written with double quotes and only &, < and > substituted)
 
     if (at->original_value.data) {
-        if ( (!attvalue.empty())   || 
+        if ( (length > 0)   || 
              (at->original_value.data[0] == '"') || 
              (at->original_value.data[0] == '\'') ) {
 
           quote = at->original_value.data[0];
-          if (quote == '\'') qs = std::string("'");
-          if (quote == '"') qs = std::string("\"");
         }
     }
+    char qs = (quote == '\'') ? '\'' : '"';
 
-    atts.append("=");
-    atts.append(qs);
+    out.push_back('=');
+    out.push_back(qs);
     if (no_entities) {
-        atts.append(attvalue);
+        out.append(value, length);
     } else {
-        atts.append(substitute_xml_entities_into_attributes(quote, attvalue));
+        append_escaped(out, value, length, ((quote == '"') || (quote == '\'')) ? quote : 0);
     }
-    atts.append(qs);
-    return atts;
+    out.push_back(qs);
 }
 
 
 // serialize children of a node
-// may be invoked recursively
+// the string versions are kept for callers that want a single node's
+// markup, all the work is done appending to one pre-sized buffer
 
 std::string GumboInterface::serialize_contents(GumboNode* node, enum UpdateTypes doupdates) {
-    std::string contents        = "";
-    std::string tagname         = get_tag_name(node);
-    bool no_entity_substitution = in_set(no_entity_sub, tagname);
-    bool keep_whitespace        = in_set(preserve_whitespace, tagname);
-    bool is_inline              = in_set(nonbreaking_inline, tagname);
-    bool is_structural          = in_set(structural_tags, tagname);
+    std::string contents;
+    contents.reserve(m_utf8src.size() + m_utf8src.size() / 8 + m_newbody.size() + 1024);
+    serialize_contents_to(contents, node, doupdates);
+    return contents;
+}
+
+
+void GumboInterface::serialize_contents_to(std::string &out, GumboNode* node, enum UpdateTypes doupdates) {
+    // everything appended from here on is this node's contents
+    size_t contents_start = out.size();
+    TagInfo info;
+    get_tag_info(node, info);
+    bool no_entity_substitution = info.flags & TAG_NO_ENTITY_SUB;
+    bool keep_whitespace        = info.flags & TAG_PRESERVE_WHITESPACE;
+    bool is_inline              = info.flags & TAG_NONBREAKING_INLINE;
+    bool is_structural          = info.flags & TAG_STRUCTURAL;
 
     // build up result for each child, recursively if need be
     GumboVector* children = &node->v.element.children;
 
     bool injected_newline = false;
-    bool in_head_without_title = (tagname == "head");
+    bool in_head_without_title = (info.tag == GUMBO_TAG_HEAD);
 
     for (unsigned int i = 0; i < children->length; ++i) {
         GumboNode* child = static_cast<GumboNode*> (children->data[i]);
 
         if (child->type == GUMBO_NODE_TEXT) {
-            std::string text;
+            const char * text = child->v.text.text;
+            size_t length = strlen(text);
+            // newlines are never substituted so this can be dropped up front
+            if (injected_newline && (length > 0) && (text[0] == '\n')) {
+                text++;
+                length--;
+            }
             if (no_entity_substitution) {
-                text = std::string(child->v.text.text);
+                out.append(text, length);
             } else {
-                text = substitute_xml_entities_into_text(std::string(child->v.text.text));
+                append_escaped(out, text, length, 0);
             }
-            if (injected_newline && !text.empty() && (text.at(0) == '\n')) text.erase(0,1);
             injected_newline = false;
-            contents.append(text);
 
         } else if (child->type == GUMBO_NODE_ELEMENT || child->type == GUMBO_NODE_TEMPLATE) {
-            std::string tagstring = serialize(child, doupdates);
-            // empty tagstring means this tag node is being removed
-            if (tagstring.empty()) {
+            // nothing appended means this tag node is being removed
+            if (!serialize_to(out, child, doupdates)) {
                 // strip off trailing whitespace from predecessor tag
-                rtrim(contents);
-                contents.append("\n"); 
+                rtrim_from(out, contents_start);
+                out.push_back('\n');
                 // strip out any associated newline in trailing whitespace node
                 injected_newline = true;
             } else {
-                contents.append(tagstring);
                 injected_newline = false;
-                std::string childname = get_tag_name(child);
-                if (in_head_without_title && (childname == "title")) in_head_without_title = false;
-                if (!is_inline && !keep_whitespace && !in_set(nonbreaking_inline,childname) && is_structural) {
-                    contents.append("\n");
+                TagInfo childinfo;
+                get_tag_info(child, childinfo);
+                if (in_head_without_title && (childinfo.tag == GUMBO_TAG_TITLE)) in_head_without_title = false;
+                if (!is_inline && !keep_whitespace && !(childinfo.flags & TAG_NONBREAKING_INLINE) && is_structural) {
+                    out.push_back('\n');
                     injected_newline = true;
                 }
             }
 
         } else if (child->type == GUMBO_NODE_WHITESPACE) {
             // try to keep all whitespace to keep as close to original as possible
-            std::string wspace = std::string(child->v.text.text);
+            const char * wspace = child->v.text.text;
             if (injected_newline) {
-                newlinetrim(wspace);
+                const char * newline = strchr(wspace, '\n');
+                if (newline) wspace = newline + 1;
                 injected_newline = false;
             }
-            contents.append(wspace);
+            out.append(wspace);
             injected_newline = false;
 
         } else if (child->type == GUMBO_NODE_CDATA) {
-            contents.append("<![CDATA[" + std::string(child->v.text.text) + "]]>");
+            out.append("<![CDATA[");
+            out.append(child->v.text.text);
+            out.append("]]>");
             injected_newline = false;
 
         } else if (child->type == GUMBO_NODE_COMMENT) {
-            contents.append("<!--" + std::string(child->v.text.text) + "-->");
+            out.append("<!--");
+            out.append(child->v.text.text);
+            out.append("-->");
  
         } else {
             fprintf(stderr, "unknown element of type: %d\n", child->type); 
@@ -1306,8 +1491,7 @@ std::string GumboInterface::serialize_contents(GumboNode* node, enum UpdateTypes
         }
 
     }
-    if (in_head_without_title) contents.append("<title></title>");
-    return contents;
+    if (in_head_without_title) out.append("<title></title>");
 }
 
 
@@ -1315,29 +1499,35 @@ std::string GumboInterface::serialize_contents(GumboNode* node, enum UpdateTypes
 // may be invoked recursively
 
 std::string GumboInterface::serialize(GumboNode* node, enum UpdateTypes doupdates) {
+    std::string results;
+    results.reserve(m_utf8src.size() + m_utf8src.size() / 8 + m_newbody.size() + 1024);
+    serialize_to(results, node, doupdates);
+    return results;
+}
+
+
+bool GumboInterface::serialize_to(std::string &out, GumboNode* node, enum UpdateTypes doupdates) {
     // special case the document node
     if (node->type == GUMBO_NODE_DOCUMENT) {
-        std::string results = build_doctype(node);
-        results.append(serialize_contents(node, doupdates));
-        return results;
+        out.append(build_doctype(node));
+        serialize_contents_to(out, node, doupdates);
+        return true;
     }
 
-    std::string close = "";
-    std::string closeTag = "";
-    std::string atts = "";
-    std::string tagname            = get_tag_name(node);
-    bool need_special_handling     = in_set(special_handling, tagname);
-    bool is_void_tag               = in_set(void_tags, tagname);
-    bool no_entity_substitution    = in_set(no_entity_sub, tagname);
-    bool is_href_src_tag           = in_set(href_src_tags, tagname);
+    TagInfo info;
+    get_tag_info(node, info);
+    bool need_special_handling     = info.flags & TAG_SPECIAL_HANDLING;
+    bool is_void_tag               = info.flags & TAG_VOID;
+    bool no_entity_substitution    = info.flags & TAG_NO_ENTITY_SUB;
+    bool is_href_src_tag           = info.flags & TAG_HREF_SRC;
     bool in_xml_ns                 = node->v.element.tag_namespace != GUMBO_NAMESPACE_HTML;
-    // bool is_inline                 = in_set(nonbreaking_inline, tagname);
+    bool parent_is_head            = node->parent && (node->parent->type == GUMBO_NODE_ELEMENT) &&
+                                     (node->parent->v.element.tag == GUMBO_TAG_HEAD);
     bool is_jslink = false;
 
 
     // handle special case of stylesheet link missing type attribute
-    if ((tagname == "link") && (node->parent->type == GUMBO_NODE_ELEMENT) && 
-        (node->parent->v.element.tag == GUMBO_TAG_HEAD)) {
+    if ((info.tag == GUMBO_TAG_LINK) && parent_is_head) {
         const GumboVector * attribs = &node->v.element.attributes;
         GumboAttribute* relatt = gumbo_get_attribute(attribs, "rel");
         GumboAttribute* typeatt = gumbo_get_attribute(attribs, "type");
@@ -1349,102 +1539,103 @@ std::string GumboInterface::serialize(GumboNode* node, enum UpdateTypes doupdate
         }
     }
     
-    // build attr string  
     GumboVector * attribs = &node->v.element.attributes;
-    for (unsigned int i=0; i< attribs->length; ++i) {
-        GumboAttribute* at = static_cast<GumboAttribute*>(attribs->data[i]);
-        atts.append(build_attributes(at, no_entity_substitution, ((doupdates & SourceUpdates) && is_href_src_tag), (doupdates & StyleUpdates)));
-    }
-
-    if (tagname == "script") {
-        if ((node->parent->type == GUMBO_NODE_ELEMENT) && 
-            (node->parent->v.element.tag == GUMBO_TAG_HEAD)) {
-            GumboAttribute* srcatt = gumbo_get_attribute(attribs, "src");
-            GumboAttribute* typeatt = gumbo_get_attribute(attribs, "type");
-            if (srcatt && typeatt) {
-                std::string script_src = srcatt->value;
-                std::string script_type = typeatt->value;
-                if (script_src.find(":") == std::string::npos) {
-                    if ((script_type == "application/javascript") || (script_type == "text/javascript")) {
-                        is_jslink = true;
-                    }
+
+    if ((info.tag == GUMBO_TAG_SCRIPT) && parent_is_head) {
+        GumboAttribute* srcatt = gumbo_get_attribute(attribs, "src");
+        GumboAttribute* typeatt = gumbo_get_attribute(attribs, "type");
+        if (srcatt && typeatt) {
+            std::string script_src = srcatt->value;
+            std::string script_type = typeatt->value;
+            if (script_src.find(":") == std::string::npos) {
+                if ((script_type == "application/javascript") || (script_type == "text/javascript")) {
+                    is_jslink = true;
                 }
             }
         }
     }
-    
+
+    // links and scripts being replaced are dropped along with their contents
+    if ((doupdates & LinkUpdates) && (info.tag == GUMBO_TAG_LINK) && parent_is_head) {
+        return false;
+    }
+
+    if ((doupdates & JavascriptUpdates) && is_jslink) {
+        return false;
+    }
+
+    out.push_back('<');
+    out.append(info.name, info.length);
+
+    // build attr string  
+    size_t atts_start = out.size();
+    for (unsigned int i=0; i< attribs->length; ++i) {
+        GumboAttribute* at = static_cast<GumboAttribute*>(attribs->data[i]);
+        append_attribute(out, at, no_entity_substitution, ((doupdates & SourceUpdates) && is_href_src_tag), (doupdates & StyleUpdates));
+    }
+
     // Make sure that the xmlns attribute exists as an html tag attribute
-    if (tagname == "html") {
-        if (atts.find("xmlns=") == std::string::npos) {
-            atts.append(" xmlns=\"http://www.w3.org/1999/xhtml\"");
+    if (info.tag == GUMBO_TAG_HTML) {
+        if (out.find("xmlns=", atts_start) == std::string::npos) {
+            out.append(" xmlns=\"http://www.w3.org/1999/xhtml\"");
         }
         if (m_version.startsWith('3')) {
-            if (atts.find("xmlns:epub") == std::string::npos) {
-                atts.append(" xmlns:epub=\"http://www.idpf.org/2007/ops\"");
+            if (out.find("xmlns:epub", atts_start) == std::string::npos) {
+                out.append(" xmlns:epub=\"http://www.idpf.org/2007/ops\"");
             }
         }
     }
 
+    // the "/" of a self closed tag is put in front of this
+    // once the contents are known
+    size_t close_pos = out.size();
+    out.push_back('>');
+    if (need_special_handling) out.push_back('\n');
+
     // determine contents
-    std::string contents;
+    size_t contents_start = out.size();
 
-    if ((tagname == "body") && (doupdates & BodyUpdates)) {
-        contents = m_newbody;
+    if ((info.tag == GUMBO_TAG_BODY) && (doupdates & BodyUpdates)) {
+        out.append(m_newbody);
     } else {
         // serialize your contents
-        contents = serialize_contents(node, doupdates);
+        serialize_contents_to(out, node, doupdates);
     }
 
     // determine closing tag type
-    std::string testcontents = contents;
-    ltrim(testcontents);
-    if (is_void_tag || (in_xml_ns && testcontents.empty())) {
-        close = "/";
-    } else {
-        closeTag = "</" + tagname + ">";
-    }
+    bool self_closed = is_void_tag ||
+                       (in_xml_ns && (out.find_first_not_of(WHITESPACE_CHARS, contents_start) == std::string::npos));
 
-    if ((doupdates & StyleUpdates) && (tagname == "style") && 
-        (node->parent->type == GUMBO_NODE_ELEMENT) && 
-        (node->parent->v.element.tag == GUMBO_TAG_HEAD)) {
-        contents = update_style_urls(contents);
+    if ((doupdates & StyleUpdates) && (info.tag == GUMBO_TAG_STYLE) && parent_is_head) {
+        std::string contents = update_style_urls(out.substr(contents_start));
+        out.replace(contents_start, std::string::npos, contents);
     }
 
     if (need_special_handling) {
-        ltrimnewlines(contents);
-        rtrim(contents);
-        contents.append("\n");
+        size_t first = out.find_first_not_of("\n\r", contents_start);
+        out.erase(contents_start, (first == std::string::npos ? out.size() : first) - contents_start);
+        rtrim_from(out, contents_start);
+        out.push_back('\n');
     }
 
-    // build results
-    std::string results;
-
-    if ((doupdates & LinkUpdates) && (tagname == "link") && 
-        (node->parent->type == GUMBO_NODE_ELEMENT) && 
-        (node->parent->v.element.tag == GUMBO_TAG_HEAD)) {
-        return "";
-    }
+    // only whitespace follows (or nothing for the usual void tags)
+    if (self_closed) out.insert(close_pos, 1, '/');
 
-    if ((doupdates & JavascriptUpdates) && is_jslink) {
-        return "";
+    if ((doupdates & LinkUpdates) && (info.tag == GUMBO_TAG_HEAD)) {
+        out.append(m_newcsslinks);
     }
 
-    results.append("<"+tagname+atts+close+">");
-    
-    if (need_special_handling) results.append("\n");
-    results.append(contents);
-
-    if ((doupdates & LinkUpdates) && (tagname == "head")) {
-        results.append(m_newcsslinks);
+    if ((doupdates & JavascriptUpdates) && (info.tag == GUMBO_TAG_HEAD)) {
+        out.append(m_newjslinks);
     }
 
-    if ((doupdates & JavascriptUpdates) && (tagname == "head")) {
-        results.append(m_newjslinks);
+    if (!self_closed) {
+        out.append("</");
+        out.append(info.name, info.length);
+        out.push_back('>');
     }
-
-    results.append(closeTag);
-    if (need_special_handling) results.append("\n");
-    return results;
+    if (need_special_handling) out.push_back('\n');
+    return true;
 }
 
 
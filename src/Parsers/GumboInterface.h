@@ -31,12 +31,14 @@
 #include "gumbo_edit.h"
 
 #include "Query/CSelection.h"
+#include "Query/CSelectorIndex.h"
 
 #include <QString>
 #include <QList>
 #include <QHash>
 
 class QString;
+class GumboArena;
 
 struct GumboWellFormedError {
   int line;
@@ -52,7 +54,7 @@ public:
     GumboInterface(const QString &source, const QString &version, const QHash<QString, QString> &source_updates);
     ~GumboInterface();
 
-    void    parse();
+    void    parse() const;
     void    parse_fragment();
     
     QString repair();
@@ -61,30 +63,34 @@ public:
     QString get_fragment_xhtml();
     
     // gumbo-query interface
-    QList<GumboNode *> findnodes(const QString &aSelector);
-    CSelection find(const QString &aSelector);
+    QList<GumboNode *> findnodes(const QString &aSelector) const;
+    CSelection find(const QString &aSelector) const;
+
+    // tests every selector in the index against this document in a single tree walk
+    // returns an empty vector if there is no document to search (find returns nothing then)
+    std::vector<bool> findmatches(const CSelectorIndex &index) const;
 
     QString prettyprint(bool keep_whitespace);
 
     // returns list tags that match manifest properties
-    QStringList get_all_properties();
+    QStringList get_all_properties() const;
 
     // returns "html" node
-    GumboNode * get_root_node();
+    GumboNode * get_root_node() const;
 
     // return document node
-    GumboNode * get_document_node();
+    GumboNode * get_document_node() const;
 
     // returns body node or NULL if none exists
-    GumboNode * get_body_node();
+    GumboNode * get_body_node() const;
 
     // routines for working with gumbo paths
-    GumboNode* get_node_from_path(QList<unsigned int> & apath);
-    QList<unsigned int> get_path_to_node(GumboNode* node);
+    GumboNode* get_node_from_path(QList<unsigned int> & apath) const;
+    QList<unsigned int> get_path_to_node(GumboNode* node) const;
 
     // routines for working with qwebpaths
-    GumboNode* get_node_from_qwebpath(QString webpath);
-    QString get_qwebpath_to_node(GumboNode* node);
+    GumboNode* get_node_from_qwebpath(QString webpath) const;
+    QString get_qwebpath_to_node(GumboNode* node) const;
 
     // routines for updating while serializing (see SourceUpdates and AnchorUpdates
     QString perform_source_updates(const QString & my_current_book_relpath, const QString& newbookpath);
@@ -95,31 +101,33 @@ public:
     QString perform_body_updates(const QString & new_body);
 
     // routines for working with nodes with specific attributes
-    QList<GumboNode*> get_all_nodes_with_attribute(const QString & attname);
-    QStringList get_all_values_for_attribute(const QString & attname);
-    QHash<QString,QString> get_attributes_of_node(GumboNode* node);
+    QList<GumboNode*> get_all_nodes_with_attribute(const QString & attname) const;
+    QStringList get_all_values_for_attribute(const QString & attname) const;
+    QHash<QString,QString> get_attributes_of_node(GumboNode* node) const;
 
     // routines for working with nodes with specific tags
-    QList<GumboNode*> get_all_nodes_with_tag(GumboTag tag);
-    QList<GumboNode*> get_all_nodes_with_tags(const QList<GumboTag> & tags);
+    QList<GumboNode*> get_all_nodes_with_tag(GumboTag tag) const;
+    QList<GumboNode*> get_all_nodes_with_tags(const QList<GumboTag> & tags) const;
 
     // utility routines 
-    std::string get_tag_name(GumboNode *node);
-    QString get_local_text_of_node(GumboNode* node);
-    QString get_body_text();
+    std::string get_tag_name(GumboNode *node) const;
+    QString get_local_text_of_node(GumboNode* node) const;
+    QString get_body_text() const;
 
     // routine to check if well-formed
     QList<GumboWellFormedError> error_check();
+    // true if the normal parse reported no errors
+    bool parsed_without_errors() const;
     QList<GumboWellFormedError> fragment_error_check();
 
     // routines to work with node and its children only
-    QList<GumboNode*> get_nodes_with_attribute(GumboNode* node, const char * att_name);
+    QList<GumboNode*> get_nodes_with_attribute(GumboNode* node, const char * att_name) const;
 
-    QList<GumboNode*> get_nodes_with_tags(GumboNode* node, const QList<GumboTag> & tags);
+    QList<GumboNode*> get_nodes_with_tags(GumboNode* node, const QList<GumboTag> & tags) const;
 
-    QList<GumboNode*> get_nodes_with_comments(GumboNode * node);
+    QList<GumboNode*> get_nodes_with_comments(GumboNode * node) const;
 
-    QList<GumboNode*> get_element_nodes_with_prefix(GumboNode * node, const std::string& prefix);
+    QList<GumboNode*> get_element_nodes_with_prefix(GumboNode * node, const std::string& prefix) const;
 
 private:
 
@@ -132,24 +140,46 @@ private:
         JavascriptUpdates = 1 << 4
     };
 
-    QStringList get_properties(GumboNode* node);
+    // what the serializer needs to know about an element: its name as
+    // get_tag_name() returns it and its membership in the tag name sets
+    struct TagInfo {
+        GumboTag     tag;     // GUMBO_TAG_LAST for the document node
+        const char * name;
+        size_t       length;
+        unsigned int flags;
+        std::string  owned;   // backs name for svg and unknown tags only
+    };
+
+    QStringList get_properties(GumboNode* node) const;
 
-    QStringList get_values_for_attr(GumboNode* node, const char* attr_name);
+    QStringList get_values_for_attr(GumboNode* node, const char* attr_name) const;
 
     std::string serialize(GumboNode* node, enum UpdateTypes doupdates = NoUpdates);
 
     std::string serialize_contents(GumboNode* node, enum UpdateTypes doupdates = NoUpdates);
 
+    // append to a single output buffer, serialize_to returns false if the
+    // node is dropped by the updates (nothing is appended then)
+    bool serialize_to(std::string &out, GumboNode* node, enum UpdateTypes doupdates);
+
+    void serialize_contents_to(std::string &out, GumboNode* node, enum UpdateTypes doupdates);
+
+    void get_tag_info(GumboNode *node, TagInfo &info) const;
+
+    void acquire_arena() const;
+
     std::string prettyprint(GumboNode* node, int lvl);
 
     std::string prettyprint_contents(GumboNode* node, int lvl);
 
     std::string build_doctype(GumboNode *node);
 
-    std::string get_attribute_name(GumboAttribute * at);
+    std::string get_attribute_name(GumboAttribute * at) const;
 
     std::string build_attributes(GumboAttribute * at, bool no_entities, bool run_src_updates = false, bool run_style_updates = false);
 
+    void append_attribute(std::string &out, GumboAttribute * at, bool no_entities, bool run_src_updates, bool run_style_updates);
+
     std::string update_attribute_value(const std::string &href);
 
     std::string update_style_urls(const std::string& source);
@@ -158,7 +188,7 @@ private:
 
     std::string substitute_xml_entities_into_attributes(char quote, const std::string &text);
 
-    bool in_set(std::unordered_set<std::string> &s, std::string &key);
+    bool in_set(std::unordered_set<std::string> &s, std::string &key) const;
 
     void rtrim(std::string &s);
 
@@ -170,14 +200,17 @@ private:
 
     void condense_whitespace(std::string &s);
 
-    void replace_all(std::string &s, const char * s1, const char * s2);
+    void replace_all(std::string &s, const char * s1, const char * s2) const;
 
     // Hopefully now unneeded
     // QString fix_self_closing_tags(const QString & source);
 
     QString                         m_source;
-    GumboOutput*                    m_output;
-    std::string                     m_utf8src;
+    // the parse tree is created lazily on first use, so read-only
+    // queries on a const interface may still need to build it
+    mutable GumboOutput*            m_output;
+    mutable GumboArena*             m_arena;
+    mutable std::string             m_utf8src;
     const QHash<QString, QString> & m_sourceupdates;
     std::string                     m_newcsslinks;
     std::string                     m_newjslinks;
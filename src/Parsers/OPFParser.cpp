@@ -385,6 +385,7 @@ void OPFParser::parse(const QString& source)
     bool get_content = false;
     m_idpos.clear();
     m_hrefpos.clear();
+    m_spinepos.clear();
     while(true) {
 
         BaseParser::MarkupInfo mi;
@@ -431,6 +432,10 @@ void OPFParser::parse(const QString& source)
             if (mi.tname == "itemref") {
                 QString idref = mi.tattr.value("idref","");
                 mi.tattr.remove("idref");
+                // only the first itemref for any idref defines its reading order
+                if (!m_spinepos.contains(idref)) {
+                    m_spinepos[idref] = m_spine.count();
+                }
                 m_spine << SpineEntry(idref, mi.tattr);
             }
             continue;
@@ -509,6 +514,24 @@ void OPFParser::parse(const QString& source)
 }
 
 
+void OPFParser::rebuild_indexes()
+{
+    m_idpos.clear();
+    m_hrefpos.clear();
+    m_spinepos.clear();
+    for (int i=0; i < m_manifest.count(); ++i) {
+        m_idpos[m_manifest.at(i).m_id] = i;
+        m_hrefpos[m_manifest.at(i).m_href] = i;
+    }
+    for (int i=0; i < m_spine.count(); ++i) {
+        const QString &idref = m_spine.at(i).m_idref;
+        if (!m_spinepos.contains(idref)) {
+            m_spinepos[idref] = i;
+        }
+    }
+}
+
+
 QString OPFParser::get_metadata_xml() const
 {
     QStringList mdxml;
@@ -180,10 +180,16 @@ struct OPFParser
     QList<BindingsEntry> m_bindings;
     QHash<QString,int>   m_idpos;
     QHash<QString,int>   m_hrefpos;
+    QHash<QString,int>   m_spinepos;
 
-    OPFParser(): m_idpos(QHash<QString,int>()), m_hrefpos(QHash<QString,int>()) {};
+    OPFParser(): m_idpos(QHash<QString,int>()), m_hrefpos(QHash<QString,int>()),
+                 m_spinepos(QHash<QString,int>()) {};
     void parse(const QString & source);
 
+    // recreates the id, href and spine position lookup tables
+    // after the manifest or spine has been changed
+    void rebuild_indexes();
+
     QString get_metadata_xml() const;
     QString convert_to_xml() const;
 };
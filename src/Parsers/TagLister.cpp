@@ -32,6 +32,29 @@
 
 const QString WHITESPACE_CHARS=" \t\n\r";  // valid in pure xml
 
+// shared tag type and special tag name atoms so that each TagInfo
+// does not carry its own heap allocated copy
+static const QString TT_XMLHEADER = "xmlheader";
+static const QString TT_PI        = "pi";
+static const QString TT_COMMENT   = "comment";
+static const QString TT_DOCTYPE   = "doctype";
+static const QString TT_CDATA     = "cdata";
+static const QString TT_BEGIN     = "begin";
+static const QString TT_SINGLE    = "single";
+static const QString TT_END       = "end";
+
+static const QString TN_XMLHEADER = "?xml";
+static const QString TN_PI        = "?";
+static const QString TN_COMMENT   = "!--";
+static const QString TN_DOCTYPE   = "!DOCTYPE";
+static const QString TN_CDATA     = "![CDATA[";
+static const QString TN_BODY      = "body";
+
+// after this many failed attempts to resynchronize with the old tag list
+// the edit almost certainly changed the nesting of everything after it
+// so just re-lex to the end
+static const int MAX_RESYNC_CHECKS = 64;
+
 // public interface
 
 // Default Constructor
@@ -43,7 +66,11 @@ TagLister::TagLister()
       m_bodyStartPos(-1),
       m_bodyEndPos(-1),
       m_bodyOpenTag(-1),
-      m_bodyCloseTag(-1)
+      m_bodyCloseTag(-1),
+      m_fullReload(true),
+      m_editStart(-1),
+      m_editOldEnd(-1),
+      m_editNewEnd(-1)
 {
     m_TagPath << "root";
     m_TagPos << -1;
@@ -56,7 +83,11 @@ TagLister::TagLister(const QString &source)
     : m_source(source),
       m_pos(0),
       m_next(0),
-      m_child(-1)
+      m_child(-1),
+      m_fullReload(false),
+      m_editStart(-1),
+      m_editOldEnd(-1),
+      m_editNewEnd(-1)
 {
     m_TagPath << "root";
     m_TagPos << -1;
@@ -76,9 +107,141 @@ void TagLister::reloadLister(const QString& source)
     m_TagPos = QList<int>() << -1;
     m_TagLen = QList<int>() << 0;
     m_TagChild = QList<int>() << -1;
+    m_fullReload = false;
+    m_editStart = -1;
+    m_editOldEnd = -1;
+    m_editNewEnd = -1;
     buildTagList();
 }
 
+
+void TagLister::invalidate()
+{
+    m_fullReload = true;
+    m_editStart = -1;
+    m_editOldEnd = -1;
+    m_editNewEnd = -1;
+}
+
+
+void TagLister::noteEdit(int pos, int removed, int added)
+{
+    if ((pos < 0) || (removed < 0) || (added < 0)) {
+        invalidate();
+        return;
+    }
+    if (m_editStart == -1) {
+        m_editStart = pos;
+        m_editOldEnd = pos + removed;
+        m_editNewEnd = pos + added;
+        return;
+    }
+    // merge with the region already recorded, all in current source coordinates
+    // except m_editOldEnd which stays in the coordinates of the last built source
+    int end = qMax(m_editNewEnd, pos + removed);
+    m_editOldEnd = m_editOldEnd + (end - m_editNewEnd);
+    m_editNewEnd = end + added - removed;
+    m_editStart = qMin(m_editStart, pos);
+}
+
+
+void TagLister::updateLister(const QString &source)
+{
+    int delta = m_editNewEnd - m_editOldEnd;
+    if (m_fullReload || (m_editStart == -1) || (m_source.length() + delta != source.length())) {
+        reloadLister(source);
+        return;
+    }
+
+    QList<TagInfo> old;
+    old.swap(m_Tags);
+    int ntags = old.size() - 1; // last entry is the dummy stop record
+
+    // tags that end before the edit are complete and cannot change
+    // so find the first tag that ends at or after the edit start
+    int lo = 0;
+    int hi = ntags;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const TagInfo &ti = old.at(mid);
+        if (ti.pos + ti.len < m_editStart) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    int first_changed = lo;
+
+    ParseState state;
+    if (!stateAfter(old, first_changed, state)) {
+        reloadLister(source);
+        return;
+    }
+    m_source = source;
+    m_TagPath = state.path;
+    m_TagPos = state.tpos;
+    m_TagLen = state.tlen;
+    m_TagChild = state.tchild;
+    m_child = state.child;
+    m_next = 0;
+    if (first_changed > 0) {
+        m_next = old.at(first_changed - 1).pos + old.at(first_changed - 1).len;
+    }
+    m_pos = m_next;
+
+    // re-lex until the scanner is past the edit at the end of an old tag
+    // with an identical parse state, from there on the old tags are still valid
+    QList<TagInfo> fresh;
+    int first_kept = -1;
+    int checks = 0;
+    TagLister::TagInfo ti = getNext();
+    while (ti.len != -1) {
+        fresh << ti;
+        if ((m_next >= m_editNewEnd) && (checks < MAX_RESYNC_CHECKS)) {
+            int j = findTagEndingAt(old, m_next - delta, first_changed);
+            if (j != -1) {
+                checks++;
+                if (stateMatches(old, j + 1, m_editStart, delta)) {
+                    first_kept = j + 1;
+                    break;
+                }
+            }
+        }
+        ti = getNext();
+    }
+
+    int old_body_open = m_bodyOpenTag;
+    int old_body_close = m_bodyCloseTag;
+    int edit_start = m_editStart;
+    int last_replaced = ntags;
+    if (first_kept != -1) {
+        // shift the offsets of the later tags
+        for (int k = first_kept; k < ntags; k++) {
+            TagInfo &tk = old[k];
+            tk.pos += delta;
+            if (tk.open_pos >= edit_start) tk.open_pos += delta;
+        }
+        last_replaced = first_kept;
+    }
+    old.remove(first_changed, last_replaced - first_changed);
+    old.insert(first_changed, fresh.size(), TagInfo());
+    for (int k = 0; k < fresh.size(); k++) {
+        old[first_changed + k] = fresh.at(k);
+    }
+    m_Tags.swap(old);
+
+    m_bodyOpenTag = relocateBodyTag(old_body_open, true, first_changed, first_kept, fresh.size());
+    m_bodyCloseTag = relocateBodyTag(old_body_close, false, first_changed, first_kept, fresh.size());
+    m_bodyStartPos = -1;
+    m_bodyEndPos = -1;
+    if (m_bodyOpenTag != -1) m_bodyStartPos = m_Tags.at(m_bodyOpenTag).pos + m_Tags.at(m_bodyOpenTag).len;
+    if (m_bodyCloseTag != -1) m_bodyEndPos = m_Tags.at(m_bodyCloseTag).pos - 1;
+
+    m_editStart = -1;
+    m_editOldEnd = -1;
+    m_editNewEnd = -1;
+}
+
 const TagLister::TagInfo& TagLister::at(int i)
 {
     if ((i < 0) || (i >= m_Tags.size())) {
@@ -116,7 +279,7 @@ bool TagLister::isPositionInOpenTag(int pos)
     int i = findFirstTagOnOrAfter(pos);
     TagLister::TagInfo ti = m_Tags.at(i);
     if ((pos >= ti.pos) && (pos < ti.pos + ti.len)) {
-        if ((ti.ttype == "begin") || (ti.ttype == "single")) return true;
+        if ((ti.ttype == TT_BEGIN) || (ti.ttype == TT_SINGLE)) return true;
     }
     return false;
 }
@@ -126,7 +289,7 @@ bool TagLister::isPositionInCloseTag(int pos)
     int i = findFirstTagOnOrAfter(pos);
     TagLister::TagInfo ti = m_Tags.at(i);
     if ((pos >= ti.pos) && (pos < ti.pos + ti.len)) {
-        if (ti.ttype == "end") return true;
+        if (ti.ttype == TT_END) return true;
     }
     return false;
 }
@@ -136,7 +299,7 @@ int TagLister::findOpenTagForClose(int i)
 {
     if ((i < 0) || (i >= m_Tags.size())) return -1;
     TagLister::TagInfo ti = m_Tags.at(i);
-    if (ti.ttype != "end") return -1;
+    if (ti.ttype != TT_END) return -1;
     int open_pos = ti.open_pos;
     for (int j=i-1; j >= 0; j--) {
         TagInfo tb = m_Tags.at(j);
@@ -149,7 +312,7 @@ int TagLister::findCloseTagForOpen(int i)
 {
     if ((i < 0) || (i >= m_Tags.size())) return -1;
     TagLister::TagInfo ti = m_Tags.at(i);
-    if (ti.ttype != "begin") return -1;
+    if (ti.ttype != TT_BEGIN) return -1;
     int open_pos = ti.pos;
     for (int j=i+1; j < m_Tags.size(); j++) {
         TagInfo te = m_Tags.at(j);
@@ -189,12 +352,12 @@ int TagLister::findLastOpenOrSingleTagThatContainsYou(int pos)
 
     // test if it contains you
     // if bpos inside a single tag use it
-    if (ti.ttype == "single") {
+    if (ti.ttype == TT_SINGLE) {
         if ((bpos >= ti.pos) && (bpos < ti.pos + ti.len)) return k;
     }
 
     // if bpos inside a begin tag and a child of it, use it
-    if (ti.ttype == "begin") {
+    if (ti.ttype == TT_BEGIN) {
         int ci  = findCloseTagForOpen(k);
         if (ci != -1) {
             TagLister::TagInfo cls = m_Tags.at(ci);
@@ -207,10 +370,10 @@ int TagLister::findLastOpenOrSingleTagThatContainsYou(int pos)
     bool found = false;
     while ((i >= 0) && !found) {
         TagLister::TagInfo ti = m_Tags.at(i);
-        if (ti.ttype == "single") {
+        if (ti.ttype == TT_SINGLE) {
             found = true;
         }
-        if (ti.ttype == "begin") {
+        if (ti.ttype == TT_BEGIN) {
             found = true;
         }
         // if not found try the preceding tag
@@ -232,7 +395,7 @@ int TagLister::findLastOpenTagOnOrBefore(int pos)
     int i = findLastTagOnOrBefore(bpos);
     bool found = false;
     while ((i >= 0) && !found) {
-        if (m_Tags.at(i).ttype == "begin") found = true;
+        if (m_Tags.at(i).ttype == TT_BEGIN) found = true;
         if (!found) i = i - 1;
     }
     if (!found) {
@@ -403,7 +566,7 @@ TagLister::TagInfo TagLister::getNext()
         if ((markup.at(0) == '<') && (markup.at(markup.size() - 1) == '>')) {
             mi.pos = m_pos;
             parseTag(markup, mi);
-            if (mi.ttype == "begin") {
+            if (mi.ttype == TT_BEGIN) {
                 m_TagPos << mi.pos;
                 m_TagLen << mi.len;
                 mi.child = ++m_child;
@@ -412,7 +575,7 @@ TagLister::TagInfo TagLister::getNext()
                 m_TagPath << mi.tname;
                 mi.tpath = makePathToTag();
 
-            } else if (mi.ttype == "single") {
+            } else if (mi.ttype == TT_SINGLE) {
                 // for path purposes temporarily treat like open tag
                 // until makePathToTag is calculated
                 mi.child = ++m_child;
@@ -423,7 +586,7 @@ TagLister::TagInfo TagLister::getNext()
                 m_TagPath.removeLast();
                 m_TagChild.removeLast();
 
-            } else if (mi.ttype == "end") {
+            } else if (mi.ttype == TT_END) {
                 QString pathnode = m_TagPath.last();
                 if (pathnode.startsWith(mi.tname)) {
                     m_TagPath.removeLast();
@@ -494,24 +657,24 @@ void TagLister::parseTag(const QStringView tagstring, TagLister::TagInfo& mi)
     // first handle special cases
     if (c == '?') {
         if (tagstring.startsWith(QL1SV("<?xml"))) {
-            mi.tname = "?xml";
-            mi.ttype = "xmlheader";
+            mi.tname = TN_XMLHEADER;
+            mi.ttype = TT_XMLHEADER;
         } else {
-            mi.tname = "?";
-            mi.ttype = "pi";
+            mi.tname = TN_PI;
+            mi.ttype = TT_PI;
         }
         return;
     }
     if (c == '!') {
         if (tagstring.startsWith(QL1SV("<!--"))) {
-            mi.tname = "!--";
-            mi.ttype = "comment"; 
+            mi.tname = TN_COMMENT;
+            mi.ttype = TT_COMMENT;
         } else if (tagstring.startsWith(QL1SV("<!DOCTYPE")) || tagstring.startsWith(QL1SV("<!doctype"))) {
-            mi.tname = "!DOCTYPE";
-            mi.ttype = "doctype";
+            mi.tname = TN_DOCTYPE;
+            mi.ttype = TT_DOCTYPE;
         } else if (tagstring.startsWith(QL1SV("<![CDATA[")) || tagstring.startsWith(QL1SV("<![cdata["))) {
-            mi.tname = "![CDATA[";
-            mi.ttype = "cdata";
+            mi.tname = TN_CDATA;
+            mi.ttype = TT_CDATA;
         }
         return;
     }
@@ -519,19 +682,19 @@ void TagLister::parseTag(const QStringView tagstring, TagLister::TagInfo& mi)
     // normal tag, extract tag name
     p = skipAnyBlanks(tagstring, 1);
     if (tagstring.at(p) == '/') {
-        mi.ttype = "end";
+        mi.ttype = TT_END;
         p++;
         p = skipAnyBlanks(tagstring, p);
     };
     int b = p;
     p = stopWhenContains(tagstring, ">/ \f\t\r\n", p);
-    mi.tname = Utility::Substring(b, p, tagstring);
+    mi.tname = internName(Utility::Substring(b, p, tagstring));
 
     // fill in tag type
     if (mi.ttype.isEmpty()) {
-        mi.ttype = "begin";
+        mi.ttype = TT_BEGIN;
         if (tagstring.endsWith(QL1SV("/>")) || tagstring.endsWith(QL1SV("/ >"))) {
-            mi.ttype = "single";
+            mi.ttype = TT_SINGLE;
         }
     }
     return;
@@ -548,6 +711,145 @@ int TagLister::findTarget(const QString &tgt, int p, bool after)
 }
 
 
+const QString& TagLister::internName(const QString &name)
+{
+    QSet<QString>::const_iterator it = m_TagNames.constFind(name);
+    if (it == m_TagNames.constEnd()) {
+        it = m_TagNames.insert(name);
+    }
+    return *it;
+}
+
+
+// index of the tag starting at pos among tags [0, hi), -1 if none
+int TagLister::findTagAt(const QList<TagInfo> &tags, int pos, int hi)
+{
+    int lo = 0;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int p = tags.at(mid).pos;
+        if (p == pos) return mid;
+        if (p < pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+
+
+// index of the tag ending at end among tags [lo, last real tag], -1 if none
+int TagLister::findTagEndingAt(const QList<TagInfo> &tags, int end, int lo)
+{
+    int hi = tags.size() - 1; // skip dummy stop record
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const TagInfo &ti = tags.at(mid);
+        if (ti.pos + ti.len == end) return mid;
+        if (ti.pos + ti.len < end) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+
+
+// Reconstructs the parser state after tags [0, n) have been processed by walking
+// backwards and skipping over every element that was closed again, so only the
+// still open ancestors are visited
+bool TagLister::stateAfter(const QList<TagInfo> &tags, int n, ParseState &state)
+{
+    QList<int> open_tags;
+    bool child_set = false;
+    state.child = -1;
+    int i = n - 1;
+    while (i >= 0) {
+        const TagInfo &ti = tags.at(i);
+        // a malformed end tag that popped the root itself cannot be walked over
+        if ((ti.ttype == TT_END) && (ti.open_pos == -1) && (ti.open_len == 0)) return false;
+        if ((ti.ttype == TT_END) && (ti.open_pos != -1)) {
+            if (!child_set) {
+                state.child = ti.child;
+                child_set = true;
+            }
+            int k = findTagAt(tags, ti.open_pos, i);
+            if (k == -1) return false;
+            i = k - 1;
+            continue;
+        }
+        if (ti.ttype == TT_BEGIN) {
+            if (!child_set) {
+                state.child = -1;
+                child_set = true;
+            }
+            open_tags << i;
+        } else if (ti.ttype == TT_SINGLE) {
+            if (!child_set) {
+                state.child = ti.child;
+                child_set = true;
+            }
+        }
+        i--;
+    }
+    state.path = QStringList() << "root";
+    state.tpos = QList<int>() << -1;
+    state.tlen = QList<int>() << 0;
+    state.tchild = QList<int>() << -1;
+    for (int k = open_tags.size() - 1; k >= 0; k--) {
+        const TagInfo &ti = tags.at(open_tags.at(k));
+        state.path << ti.tname;
+        state.tpos << ti.pos;
+        state.tlen << ti.len;
+        state.tchild << ti.child;
+    }
+    return true;
+}
+
+
+// Compares the current parser state to the one the old tag list had after
+// tags [0, n), with old positions at or after the edit shifted by delta
+bool TagLister::stateMatches(const QList<TagInfo> &tags, int n, int edit_start, int delta)
+{
+    ParseState state;
+    if (!stateAfter(tags, n, state)) return false;
+    if ((state.child != m_child) || (state.path.size() != m_TagPath.size())) return false;
+    for (int k = 0; k < state.tpos.size(); k++) {
+        int p = state.tpos.at(k);
+        if (p >= edit_start) p += delta;
+        if ((p != m_TagPos.at(k)) || (state.tlen.at(k) != m_TagLen.at(k)) ||
+            (state.tchild.at(k) != m_TagChild.at(k)) || (state.path.at(k) != m_TagPath.at(k))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Where the last body begin or end tag lives after tags [first_changed, first_kept)
+// were replaced by added new ones (first_kept is -1 if every later tag was replaced)
+int TagLister::relocateBodyTag(int old_index, bool begin, int first_changed, int first_kept, int added)
+{
+    const QString &ttype = begin ? TT_BEGIN : TT_END;
+    if ((first_kept != -1) && (old_index >= first_kept)) {
+        return old_index - first_kept + first_changed + added;
+    }
+    for (int i = first_changed + added - 1; i >= first_changed; i--) {
+        const TagInfo &ti = m_Tags.at(i);
+        if ((ti.tname == TN_BODY) && (ti.ttype == ttype)) return i;
+    }
+    if ((old_index == -1) || (old_index < first_changed)) return old_index;
+    // the old one was replaced, so look for an earlier one
+    for (int i = first_changed - 1; i >= 0; i--) {
+        const TagInfo &ti = m_Tags.at(i);
+        if ((ti.tname == TN_BODY) && (ti.ttype == ttype)) return i;
+    }
+    return -1;
+}
+
+
 int TagLister::skipAnyBlanks(const QStringView tgt, int p)
 {
     while((p < tgt.length()) && (WHITESPACE_CHARS.contains(tgt.at(p)))) p++;
@@ -572,11 +874,11 @@ void TagLister::buildTagList()
         int i = 0;
         TagLister::TagInfo ti = getNext();
         while(ti.len != -1) {
-            if ((ti.tname == "body") && (ti.ttype == "begin")) {
+            if ((ti.tname == TN_BODY) && (ti.ttype == TT_BEGIN)) {
                 m_bodyStartPos = ti.pos + ti.len;
                 m_bodyOpenTag = i;
             }
-            if ((ti.tname == "body") && (ti.ttype == "end")) {
+            if ((ti.tname == TN_BODY) && (ti.ttype == TT_END)) {
                 m_bodyEndPos = ti.pos - 1;
                 m_bodyCloseTag = i;
             }
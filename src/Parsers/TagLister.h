@@ -25,6 +25,7 @@
 #include <QStringList>
 #include <QStringView>
 #include <QList>
+#include <QSet>
 
 class QString;
 
@@ -60,6 +61,18 @@ public:
 
     void reloadLister(const QString &source);
 
+    // Records an edit of the source (as reported by QTextDocument::contentsChange)
+    // so that the next updateLister only needs to re-lex the edited region
+    void noteEdit(int pos, int removed, int added);
+
+    // Brings the tag list up to date with source, re-lexing only from the last
+    // complete tag before the recorded edits to the point where the tag stream
+    // resynchronizes with the old one. Falls back to reloadLister when it cannot.
+    void updateLister(const QString &source);
+
+    // Forgets any recorded edits so the next updateLister does a full reload
+    void invalidate();
+
     const TagInfo& at(int i);
     size_t size();
 
@@ -85,6 +98,14 @@ public:
     static QString extractAllAttributes(const QStringView tagstring);
     
 private:
+    struct ParseState {
+        QStringList path;
+        QList<int>  tpos;
+        QList<int>  tlen;
+        QList<int>  tchild;
+        int         child;
+    };
+
     TagInfo getNext();
     void  buildTagList();
     QString makePathToTag();
@@ -96,6 +117,14 @@ private:
     int findTarget(const QString &tgt, int p, bool after=false);
     static int skipAnyBlanks(const QStringView segment, int p);
     static int stopWhenContains(const QStringView segment, const QString& stopchars, int p);
+
+    const QString& internName(const QString &name);
+
+    static int findTagAt(const QList<TagInfo> &tags, int pos, int hi);
+    static int findTagEndingAt(const QList<TagInfo> &tags, int end, int lo);
+    static bool stateAfter(const QList<TagInfo> &tags, int n, ParseState &state);
+    bool stateMatches(const QList<TagInfo> &tags, int n, int edit_start, int delta);
+    int  relocateBodyTag(int old_index, bool begin, int first_changed, int first_kept, int added);
     
     QString        m_source;
     int            m_pos;
@@ -110,6 +139,11 @@ private:
     int            m_bodyEndPos;
     int            m_bodyOpenTag;
     int            m_bodyCloseTag;
+    bool           m_fullReload;
+    int            m_editStart;   // first changed position, -1 if no edit recorded
+    int            m_editOldEnd;  // end of changed region in the old source
+    int            m_editNewEnd;  // end of changed region in the current source
+    QSet<QString>  m_TagNames;
 };
 
 #endif
@@ -202,6 +202,31 @@ bool CSelector::match(GumboNode* apNode)
     }
 }
 
+bool CSelector::subjectKeys(std::vector<std::string>& aKeys)
+{
+    if (mOp == ETag)
+    {
+        aKeys.push_back(tagKey(mTag));
+        return true;
+    }
+    return false;
+}
+
+std::string CSelector::tagKey(GumboTag aTag)
+{
+    return "<" + std::to_string((int) aTag);
+}
+
+std::string CSelector::idKey(const std::string& aId)
+{
+    return "#" + aId;
+}
+
+std::string CSelector::classKey(const std::string& aClass)
+{
+    return "." + aClass;
+}
+
 std::vector<GumboNode*> CSelector::filter(std::vector<GumboNode*> nodes)
 {
     std::vector<GumboNode*> ret;
@@ -353,6 +378,57 @@ bool CBinarySelector::match(GumboNode* apNode)
     return false;
 }
 
+bool CBinarySelector::subjectKeys(std::vector<std::string>& aKeys)
+{
+    switch (mOp)
+    {
+        case EUnion:
+        {
+            // either side may match so a node needs a key of either side
+            std::vector<std::string> keys1;
+            std::vector<std::string> keys2;
+            if (!mpS1->subjectKeys(keys1) || !mpS2->subjectKeys(keys2))
+            {
+                return false;
+            }
+            aKeys.insert(aKeys.end(), keys1.begin(), keys1.end());
+            aKeys.insert(aKeys.end(), keys2.begin(), keys2.end());
+            return true;
+        }
+        case EIntersection:
+        {
+            // both sides must match so the keys of either side will do,
+            // prefer an id or class over a tag as they are more selective
+            std::vector<std::string> keys1;
+            std::vector<std::string> keys2;
+            bool has1 = mpS1->subjectKeys(keys1);
+            bool has2 = mpS2->subjectKeys(keys2);
+            if (has1 && has2 && keys1.size() == 1 && keys1[0][0] == '<')
+            {
+                has1 = false;
+            }
+            if (has1)
+            {
+                aKeys.insert(aKeys.end(), keys1.begin(), keys1.end());
+                return true;
+            }
+            if (has2)
+            {
+                aKeys.insert(aKeys.end(), keys2.begin(), keys2.end());
+                return true;
+            }
+            return false;
+        }
+        case EChild:
+        case EDescendant:
+        case ESibling:
+            // the node itself is the subject of the right hand side
+            return mpS2->subjectKeys(aKeys);
+        default:
+            return false;
+    }
+}
+
 CAttributeSelector::CAttributeSelector(TOperator aOp, std::string aKey, std::string aValue)
 {
     mKey = aKey;
@@ -431,6 +507,23 @@ bool CAttributeSelector::match(GumboNode* apNode)
     return false;
 }
 
+bool CAttributeSelector::subjectKeys(std::vector<std::string>& aKeys)
+{
+    if (mOp == EEquals && mKey == "id")
+    {
+        aKeys.push_back(idKey(mValue));
+        return true;
+    }
+    // a class name with whitespace in it can never be one of the words of a class value
+    if (mOp == EIncludes && mKey == "class" && !mValue.empty()
+        && mValue.find_first_of(" \n\r\t\f") == std::string::npos)
+    {
+        aKeys.push_back(classKey(mValue));
+        return true;
+    }
+    return false;
+}
+
 CUnarySelector::CUnarySelector(TOperator aOp, CSelector* apS)
 {
     mpS = apS;
@@ -118,6 +118,17 @@ class CSelector: public CObject
 
     std::vector<GumboNode*> matchAll(GumboNode* apNode);
 
+    // Appends the keys (see tagKey, idKey and classKey) one of which a node
+    // must have for this selector to match it.  Returns false if there are
+    // none and the selector has to be tested against every node.
+    virtual bool subjectKeys(std::vector<std::string>& aKeys);
+
+    static std::string tagKey(GumboTag aTag);
+
+    static std::string idKey(const std::string& aId);
+
+    static std::string classKey(const std::string& aClass);
+
  private:
 
     void init()
@@ -221,6 +232,8 @@ class CBinarySelector: public CSelector
 
     virtual bool match(GumboNode* apNode);
 
+    virtual bool subjectKeys(std::vector<std::string>& aKeys);
+
  private:
 
     CSelector* mpS1;
@@ -264,6 +277,8 @@ class CAttributeSelector: public CSelector
 
     virtual bool match(GumboNode* apNode);
 
+    virtual bool subjectKeys(std::vector<std::string>& aKeys);
+
  private:
 
      std::string mKey;
@@ -0,0 +1,212 @@
+/**********************************************************************************
+ **
+ **  SigilQuery for Gumbo
+ **
+ **  A C++ library that provides jQuery-like selectors for Google's Gumbo-Parser.
+ **  Selector engine is an implementation based on cascadia.
+ **
+ **  Based on: "gumbo-query" https://github.com/lazytiger/gumbo-query
+ **  With bug fixes, extensions and improvements
+ **
+ **  The MIT License (MIT)
+ **  Copyright (c) 2025 Kevin B. Hendricks, Stratford, Ontario Canada
+ **
+ **
+ **  Permission is hereby granted, free of charge, to any person obtaining a copy
+ **  of this software and associated documentation files (the "Software"), to deal
+ **  in the Software without restriction, including without limitation the rights
+ **  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ **  copies of the Software, and to permit persons to whom the Software is
+ **  furnished to do so, subject to the following conditions:
+ **
+ **  The above copyright notice and this permission notice shall be included in
+ **  all copies or substantial portions of the Software.
+ **
+ **  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ **  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ **  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ **  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ **  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ **  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ **  THE SOFTWARE.
+ **
+ **********************************************************************************/
+
+#include <cstring>
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+
+#include "Query/CParser.h"
+#include "Query/CSelector.h"
+#include "Query/CSelectorIndex.h"
+
+static const char* CLASS_SEPARATORS = " \n\r\t\f";
+
+// attribute selectors compare names exactly, so do the same here
+// rather than use the case insensitive gumbo_get_attribute
+static GumboAttribute* findAttribute(GumboNode* apNode, const char* aName)
+{
+    GumboVector* attributes = &apNode->v.element.attributes;
+    for (unsigned int i = 0; i < attributes->length; i++)
+    {
+        GumboAttribute* attr = (GumboAttribute*) attributes->data[i];
+        if (strcmp(attr->name, aName) == 0)
+        {
+            return attr;
+        }
+    }
+    return NULL;
+}
+
+CSelectorIndex::CSelectorIndex()
+{
+}
+
+CSelectorIndex::~CSelectorIndex()
+{
+    for (std::vector<CSelector*>::iterator it = mSelectors.begin(); it != mSelectors.end(); it++)
+    {
+        if (*it != NULL)
+        {
+            (*it)->release();
+        }
+    }
+}
+
+size_t CSelectorIndex::add(std::string aSelector)
+{
+    size_t i = mSelectors.size();
+    CSelector* sel = NULL;
+    // parsing the any selector can throw exceptions
+    // try to fail gracefully just like CSelection::find
+    try {
+        sel = CParser::create(aSelector);
+    } catch(const std::runtime_error &e) {
+        std::cout << "***Query Parser Error***: " << e.what() << std::endl;
+        sel = NULL;
+    }
+    mSelectors.push_back(sel);
+    if (sel == NULL)
+    {
+        return i;
+    }
+
+    std::vector<std::string> keys;
+    if (!sel->subjectKeys(keys))
+    {
+        mUniversal.push_back(i);
+        return i;
+    }
+    for (std::vector<std::string>::iterator it = keys.begin(); it != keys.end(); it++)
+    {
+        std::vector<size_t>& bucket = mBuckets[*it];
+        // a union may list the same key more than once
+        if (bucket.empty() || bucket.back() != i)
+        {
+            bucket.push_back(i);
+        }
+    }
+    return i;
+}
+
+size_t CSelectorIndex::size() const
+{
+    return mSelectors.size();
+}
+
+bool CSelectorIndex::parseError(size_t i) const
+{
+    return i < mSelectors.size() && mSelectors[i] == NULL;
+}
+
+void CSelectorIndex::testCandidates(const std::vector<size_t>& aCandidates, GumboNode* apNode,
+                                    std::vector<bool>& aMatched, size_t& aRemaining) const
+{
+    for (std::vector<size_t>::const_iterator it = aCandidates.begin(); it != aCandidates.end(); it++)
+    {
+        if (!aMatched[*it] && mSelectors[*it]->match(apNode))
+        {
+            aMatched[*it] = true;
+            aRemaining--;
+        }
+    }
+}
+
+std::vector<bool> CSelectorIndex::matchAll(GumboNode* apRoot) const
+{
+    std::vector<bool> matched(mSelectors.size(), false);
+    size_t remaining = 0;
+    for (std::vector<CSelector*>::const_iterator it = mSelectors.begin(); it != mSelectors.end(); it++)
+    {
+        if (*it != NULL)
+        {
+            remaining++;
+        }
+    }
+    if (apRoot == NULL)
+    {
+        return matched;
+    }
+
+    // visit the nodes in the same order as CSelector::matchAll, only
+    // descending into elements, and stop once everything has matched
+    std::vector<GumboNode*> stack;
+    stack.push_back(apRoot);
+    while (!stack.empty() && remaining > 0)
+    {
+        GumboNode* node = stack.back();
+        stack.pop_back();
+
+        testCandidates(mUniversal, node, matched, remaining);
+
+        if (node->type != GUMBO_NODE_ELEMENT)
+        {
+            continue;
+        }
+
+        std::unordered_map<std::string, std::vector<size_t> >::const_iterator bucket;
+        bucket = mBuckets.find(CSelector::tagKey(node->v.element.tag));
+        if (bucket != mBuckets.end())
+        {
+            testCandidates(bucket->second, node, matched, remaining);
+        }
+
+        GumboAttribute* attr = findAttribute(node, "id");
+        if (attr)
+        {
+            bucket = mBuckets.find(CSelector::idKey(attr->value));
+            if (bucket != mBuckets.end())
+            {
+                testCandidates(bucket->second, node, matched, remaining);
+            }
+        }
+
+        attr = findAttribute(node, "class");
+        if (attr)
+        {
+            std::string value = attr->value;
+            size_t start = value.find_first_not_of(CLASS_SEPARATORS);
+            while (start != std::string::npos)
+            {
+                size_t end = value.find_first_of(CLASS_SEPARATORS, start);
+                if (end == std::string::npos)
+                {
+                    end = value.size();
+                }
+                bucket = mBuckets.find(CSelector::classKey(value.substr(start, end - start)));
+                if (bucket != mBuckets.end())
+                {
+                    testCandidates(bucket->second, node, matched, remaining);
+                }
+                start = value.find_first_not_of(CLASS_SEPARATORS, end);
+            }
+        }
+
+        for (unsigned int i = node->v.element.children.length; i > 0; i--)
+        {
+            stack.push_back((GumboNode*) node->v.element.children.data[i - 1]);
+        }
+    }
+    return matched;
+}
@@ -0,0 +1,95 @@
+/**********************************************************************************
+ **
+ **  SigilQuery for Gumbo
+ **
+ **  A C++ library that provides jQuery-like selectors for Google's Gumbo-Parser.
+ **  Selector engine is an implementation based on cascadia.
+ **
+ **  Based on: "gumbo-query" https://github.com/lazytiger/gumbo-query
+ **  With bug fixes, extensions and improvements
+ **
+ **  The MIT License (MIT)
+ **  Copyright (c) 2025 Kevin B. Hendricks, Stratford, Ontario Canada
+ **
+ **
+ **  Permission is hereby granted, free of charge, to any person obtaining a copy
+ **  of this software and associated documentation files (the "Software"), to deal
+ **  in the Software without restriction, including without limitation the rights
+ **  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ **  copies of the Software, and to permit persons to whom the Software is
+ **  furnished to do so, subject to the following conditions:
+ **
+ **  The above copyright notice and this permission notice shall be included in
+ **  all copies or substantial portions of the Software.
+ **
+ **  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ **  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ **  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ **  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ **  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ **  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ **  THE SOFTWARE.
+ **
+ **********************************************************************************/
+
+#ifndef CSELECTORINDEX_H_
+#define CSELECTORINDEX_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "gumbo.h"
+#include "gumbo_edit.h"
+
+class CSelector;
+
+// A set of selectors compiled once and bucketed by the id, class or tag
+// that the subject of each selector must carry, much like a browser style
+// engine, so that a whole document can be tested against all of them in
+// a single tree walk.  Once built it is read only and may be shared by
+// several threads.
+
+class CSelectorIndex
+{
+
+ public:
+
+    CSelectorIndex();
+
+    virtual ~CSelectorIndex();
+
+ public:
+
+    // compiles aSelector and returns its number in the index
+    size_t add(std::string aSelector);
+
+    size_t size() const;
+
+    // true if the selector could not be parsed
+    bool parseError(size_t i) const;
+
+    // walks the tree at apRoot once and returns for every selector in the
+    // index whether it matches any node, exactly as CSelection::find would
+    std::vector<bool> matchAll(GumboNode* apRoot) const;
+
+ private:
+
+    CSelectorIndex(const CSelectorIndex&);
+
+    CSelectorIndex& operator=(const CSelectorIndex&);
+
+    void testCandidates(const std::vector<size_t>& aCandidates, GumboNode* apNode,
+                        std::vector<bool>& aMatched, size_t& aRemaining) const;
+
+ private:
+
+    // NULL for selectors with parse errors
+    std::vector<CSelector*> mSelectors;
+
+    // selectors that have no key and must be tested against every node
+    std::vector<size_t> mUniversal;
+
+    std::unordered_map<std::string, std::vector<size_t> > mBuckets;
+};
+
+#endif /* CSELECTORINDEX_H_ */
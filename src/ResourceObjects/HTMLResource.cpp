@@ -22,7 +22,9 @@
 
 #include <memory>
 
+#include <QCache>
 #include <QFileInfo>
+#include <QMutexLocker>
 #include <QString>
 // #include <QDebug>
 
@@ -47,14 +49,29 @@ const QStringList RTL_LC = QStringList() << "ar" << "arc" << "dv" << "div" << "f
                                             "kur" << "ps" << "pus" << "snd" << "sd" <<
                                             "urd" << "ur" << "yi" << "yid"; 
 
+// The parsed trees handed out by GetParsedTree are only weakly held by
+// their resource. This book wide cache keeps the most recently used ones
+// alive, bounded by the approximate memory cost of the source text,
+// so that huge books do not end up holding a parse tree for every file.
+static const int PARSED_TREE_CACHE_MAX_COST = 128 * 1024 * 1024;
+static QMutex s_ParsedTreeCacheMutex;
+static QCache<const HTMLResource *, QSharedPointer<const GumboInterface> > s_ParsedTreeCache(PARSED_TREE_CACHE_MAX_COST);
+
 HTMLResource::HTMLResource(const QString &mainfolder, const QString &fullfilepath, FolderKeeper* Keeper,
                            QObject *parent)
     :
     XMLResource(mainfolder, fullfilepath, parent),
     m_Keeper(Keeper),
     m_LinkedBookPaths(QStringList()),
-    m_TOCCache("")
+    m_TOCCache(""),
+    m_ParsedTreeRevision(0)
+{
+}
+
+
+HTMLResource::~HTMLResource()
 {
+    ClearParsedTree();
 }
 
 
@@ -68,6 +85,7 @@ bool HTMLResource::LoadFromDisk()
     try {
         const QString &text = Utility::ReadUnicodeTextFile(GetFullPath());
         SetText(text);
+        MarkTextInSyncWithDisk();
         emit LoadedFromDisk();
         return true;
     } catch (CannotOpenFile&) {
@@ -81,6 +99,7 @@ void HTMLResource::SetText(const QString &text)
 {
     emit TextChanging();
 
+    ClearParsedTree();
     XMLResource::SetText(text);
 
     // Track resources whose change will necessitate an update of the BV and PV.
@@ -138,13 +157,50 @@ QStringList HTMLResource::GetLinkedJavascripts()
 }
 
 
+QSharedPointer<const GumboInterface> HTMLResource::GetParsedTree() const
+{
+    // grab the revision before the text so that a racing SetText can only
+    // make us reparse too often, never hand out a stale tree
+    quint64 revision = GetTextRevision();
+    QSharedPointer<const GumboInterface> tree;
+    {
+        QMutexLocker locker(&m_ParsedTreeMutex);
+        tree = m_ParsedTree.toStrongRef();
+        if (tree.isNull() || (m_ParsedTreeRevision != revision)) {
+            QSharedPointer<GumboInterface> gi(new GumboInterface(GetText(), GetEpubVersion()));
+            // parse now so that readers on other threads never race to build the tree
+            gi->parse();
+            tree = gi;
+            m_ParsedTree = tree;
+            m_ParsedTreeRevision = revision;
+        }
+    }
+    // the utf-8 source, the QString copy and the gumbo nodes together
+    // take several times the size of the text
+    int cost = qMax(1, static_cast<int>(qMin<qint64>(GetText().size() * 8, PARSED_TREE_CACHE_MAX_COST)));
+    QMutexLocker cachelocker(&s_ParsedTreeCacheMutex);
+    s_ParsedTreeCache.insert(this, new QSharedPointer<const GumboInterface>(tree), cost);
+    return tree;
+}
+
+
+void HTMLResource::ClearParsedTree()
+{
+    {
+        QMutexLocker locker(&m_ParsedTreeMutex);
+        m_ParsedTree.clear();
+    }
+    QMutexLocker cachelocker(&s_ParsedTreeCacheMutex);
+    s_ParsedTreeCache.remove(this);
+}
+
+
 QStringList HTMLResource::GetManifestProperties() const
 {
     QStringList properties;
     QReadLocker locker(&GetLock());
-    GumboInterface gi = GumboInterface(GetText(), GetEpubVersion());
-    gi.parse();
-    QStringList props = gi.get_all_properties();
+    QSharedPointer<const GumboInterface> gi = GetParsedTree();
+    QStringList props = gi->get_all_properties();
     props.removeDuplicates();
     if (props.contains("math")) properties.append("mathml");
     if (props.contains("svg")) properties.append("svg");
@@ -172,11 +228,10 @@ QStringList HTMLResource::GetPathsToLinkedResources()
     // Can NOT grab Read Lock here as this is also invoked in SetText which has write lock!
     // leading to instant lockup when renaming any resource
     // QReadLocker locker(&GetLock());
-    GumboInterface gi = GumboInterface(GetText(),GetEpubVersion());
-    gi.parse();
+    QSharedPointer<const GumboInterface> gi = GetParsedTree();
     QList<GumboTag> tags;
     tags << GUMBO_TAG_IMG << GUMBO_TAG_LINK << GUMBO_TAG_AUDIO << GUMBO_TAG_VIDEO;
-    const QList<GumboNode*> linked_rsc_nodes = gi.get_all_nodes_with_tags(tags);
+    const QList<GumboNode*> linked_rsc_nodes = gi->get_all_nodes_with_tags(tags);
     for (int i = 0; i < linked_rsc_nodes.count(); ++i) {
         GumboNode* node = linked_rsc_nodes.at(i);
 
@@ -212,9 +267,8 @@ QStringList HTMLResource::GetPathsToLinkedResources()
 
 QString HTMLResource::GetLanguageAttribute()
 {
-    GumboInterface gi = GumboInterface(GetText(),GetEpubVersion());
-    gi.parse();
-    QList<GumboNode*> htmltags = gi.get_all_nodes_with_tag(GUMBO_TAG_HTML);
+    QSharedPointer<const GumboInterface> gi = GetParsedTree();
+    QList<GumboNode*> htmltags = gi->get_all_nodes_with_tag(GUMBO_TAG_HTML);
     if (htmltags.count() != 1) return "";
     GumboNode* node = htmltags.at(0);
     QString lang="";
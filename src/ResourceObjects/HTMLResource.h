@@ -25,12 +25,16 @@
 #define HTMLRESOURCE_H
 
 #include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QWeakPointer>
 
 #include "Parsers/CSSInfo.h"
 #include "ResourceObjects/XMLResource.h"
 
 class QString;
 class FolderKeeper;
+class GumboInterface;
 
 /**
  * Represents an HTML file of the book.
@@ -57,6 +61,8 @@ public:
                  FolderKeeper* keeper,
                  QObject *parent = NULL);
 
+    ~HTMLResource();
+
     QString GetTOCCache();
     void    SetTOCCache(const QString & text);
     
@@ -99,6 +105,17 @@ public:
 
     QStringList GetManifestProperties() const;
 
+    /**
+     * Returns a fully parsed gumbo tree of the current text.
+     * The tree is shared between all callers and is only rebuilt
+     * when the text revision changes, so it must be treated as
+     * read only. Callers that need to edit the tree must still
+     * create their own GumboInterface.
+     *
+     * @return The shared parse tree of the resource's text.
+     */
+    QSharedPointer<const GumboInterface> GetParsedTree() const;
+
     bool DeleteCSStyles(QList<CSSInfo::CSSSelector *> css_selectors);
 
     QString GetLanguageAttribute();
@@ -119,6 +136,11 @@ private:
      */
     void TrackNewResources();
 
+    /**
+     * Drops any cached parse tree held for this resource.
+     */
+    void ClearParsedTree();
+
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
     ///////////////////////////////
@@ -127,6 +149,10 @@ private:
     QStringList m_LinkedBookPaths;
 
     QString m_TOCCache;
+
+    mutable QMutex m_ParsedTreeMutex;
+    mutable QWeakPointer<const GumboInterface> m_ParsedTree;
+    mutable quint64 m_ParsedTreeRevision;
 };
 
 #endif // HTMLRESOURCE_H
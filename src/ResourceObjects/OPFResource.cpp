@@ -132,7 +132,8 @@ OPFResource::OPFResource(const QString &mainfolder,
              QObject *parent)
   : XMLResource(mainfolder, fullfilepath, parent),
     m_NavResource(nullptr),
-    m_WarnedAboutVersion(false)
+    m_WarnedAboutVersion(false),
+    m_PackageRevision(0)
 {
     FillWithDefaultText(version);
     // Make sure the file exists on disk.
@@ -195,6 +196,7 @@ bool OPFResource::LoadFromDisk()
     try {
         const QString &text = Utility::ReadUnicodeTextFile(GetFullPath());
         SetText(text);
+        MarkTextInSyncWithDisk();
         emit LoadedFromDisk();
         return true;
     } catch (CannotOpenFile&) {
@@ -210,9 +212,8 @@ QList<Resource*> OPFResource::GetSpineOrderResources( const QList<Resource *> &r
     QString version = GetEpubVersion();
     bool nav_in_spine = isNavInSpine();
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     const QHash<QString, Resource*> id_mapping = GetManifestIDResourceMapping(resources, p);
     QList<Resource *> spine_order;
     for (int i = 0; i < p.m_spine.count(); ++i) {
@@ -240,9 +241,8 @@ QHash <Resource *, int>  OPFResource::GetReadingOrderAll( const QList <Resource
         nav_rsc = GetNavResource();
     }
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     if (nav_rsc) {
         nav_id = GetResourceManifestID(nav_rsc, p);
     }
@@ -275,18 +275,11 @@ bool OPFResource::isNavInSpine() const
 int OPFResource::GetReadingOrder(const HTMLResource *html_resource) const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     const Resource *resource = static_cast<const Resource *>(html_resource);
     QString resource_id = GetResourceManifestID(resource, p);
-    for (int i = 0; i < p.m_spine.count(); ++i) {
-        QString idref = p.m_spine.at(i).m_idref;
-        if (resource_id == idref) {
-            return i;
-        }
-    }
-    return -1;
+    return p.m_spinepos.value(resource_id, -1);
 }
 
 void OPFResource::MoveReadingOrder(const HTMLResource* from_resource, const HTMLResource* after_resource)
@@ -296,9 +289,7 @@ void OPFResource::MoveReadingOrder(const HTMLResource* from_resource, const HTML
     const Resource *after_res = static_cast<const Resource *>(after_resource);
     if (from_res == NULL || after_res == NULL) return;
 
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QString from_id = GetResourceManifestID(from_res, p);
     QString after_id = GetResourceManifestID(after_res, p);
 
@@ -327,9 +318,8 @@ void OPFResource::MoveReadingOrder(const HTMLResource* from_resource, const HTML
 QString OPFResource::GetMainIdentifierValue() const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     int i = GetMainIdentifier(p);
     if (i > -1) {
         return QString(p.m_metadata.at(i).m_content);
@@ -375,9 +365,8 @@ QString OPFResource::GetUUIDIdentifierValue()
 {
     EnsureUUIDIdentifierPresent();
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     for (int i=0; i < p.m_metadata.count(); ++i) {
         MetaEntry me = p.m_metadata.at(i);
         if(me.m_name.startsWith("dc:identifier")) {
@@ -397,9 +386,7 @@ QString OPFResource::GetUUIDIdentifierValue()
 void OPFResource::EnsureUUIDIdentifierPresent()
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     for (int i=0; i < p.m_metadata.count(); ++i) {
         MetaEntry me = p.m_metadata.at(i);
         if(me.m_name.startsWith("dc:identifier")) {
@@ -423,9 +410,7 @@ void OPFResource::EnsureUUIDIdentifierPresent()
 QString OPFResource::AddNCXItem(const QString &ncx_path, QString id)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QString ncx_bkpath = ncx_path.right(ncx_path.length() - GetFullPathToBookFolder().length() - 1);
     QString ncx_rel_path = Utility::buildRelativePath(GetRelativePath(), ncx_bkpath);
     int n = p.m_manifest.count();
@@ -444,9 +429,7 @@ QString OPFResource::AddNCXItem(const QString &ncx_path, QString id)
 void OPFResource::UpdateNCXOnSpine(const QString &new_ncx_id)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QString ncx_id = p.m_spineattr.m_atts.value(QString("toc"),"");
     if (new_ncx_id != ncx_id) {
         p.m_spineattr.m_atts[QString("toc")] = new_ncx_id;
@@ -457,9 +440,7 @@ void OPFResource::UpdateNCXOnSpine(const QString &new_ncx_id)
 void OPFResource::RemoveNCXOnSpine()
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     p.m_spineattr.m_atts.remove("toc");
     UpdateText(p);
 }
@@ -468,9 +449,7 @@ void OPFResource::RemoveNCXOnSpine()
 void OPFResource::UpdateNCXLocationInManifest(const NCXResource *ncx)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QString ncx_id = p.m_spineattr.m_atts.value(QString("toc"), "");
     int pos = p.m_idpos.value(ncx_id, -1);
     if (pos > -1) {
@@ -489,9 +468,7 @@ void OPFResource::UpdateNCXLocationInManifest(const NCXResource *ncx)
 void OPFResource::AddSigilVersionMeta()
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     for (int i=0; i < p.m_metadata.count(); ++i) {
         MetaEntry me = p.m_metadata.at(i);
         if ((me.m_name == "meta") && (me.m_atts.contains("name"))) {  
@@ -516,9 +493,8 @@ void OPFResource::AddSigilVersionMeta()
 bool OPFResource::IsCoverImage(const ImageResource *image_resource) const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     QString resource_id = GetResourceManifestID(image_resource, p);
     return IsCoverImageCheck(resource_id, p);
 }
@@ -538,9 +514,8 @@ bool OPFResource::IsCoverImageCheck(QString resource_id, const OPFParser & p) co
 bool OPFResource::CoverImageExists() const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     return GetCoverMeta(p) > -1;
 }
 
@@ -548,9 +523,8 @@ bool OPFResource::CoverImageExists() const
 QString OPFResource::GetCoverImagePath() const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     QString bkpath;
     int pos  = GetCoverMeta(p);
     if (pos > -1) {
@@ -577,9 +551,7 @@ void OPFResource::AutoFixWellFormedErrors()
 {
     QWriteLocker locker(&GetLock());
     const QStringList TEXT_EXTS = QStringList() << "htm" << "html" << "xhtml";
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     // auto fill in spine from manifest if completely empty
     if (p.m_spine.count() == 0) {
         std::vector< std::pair< QString, QString > > txts;
@@ -607,9 +579,8 @@ void OPFResource::AutoFixWellFormedErrors()
 QStringList OPFResource::GetSpineOrderBookPaths() const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     QStringList book_paths_in_reading_order;
     for (int i=0; i < p.m_spine.count(); ++i) {
         SpineEntry sp = p.m_spine.at(i);
@@ -628,9 +599,8 @@ QStringList OPFResource::GetMediaOverlayActiveClassSelectors() const
 {
     QReadLocker locker(&GetLock());
     QStringList activeclassselectors;
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     for (int i=0; i < p.m_metadata.count(); ++i) {
         if (p.m_metadata.at(i).m_name == "meta") {
             MetaEntry me = p.m_metadata.at(i);
@@ -671,9 +641,8 @@ QString OPFResource::GetPrimaryBookLanguage() const
 QList<MetaEntry> OPFResource::GetDCMetadata() const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     QList<MetaEntry> metadata;
     for (int i=0; i < p.m_metadata.count(); ++i) {
         if (p.m_metadata.at(i).m_name.startsWith("dc:")) {
@@ -688,9 +657,8 @@ QList<MetaEntry> OPFResource::GetDCMetadata() const
 QString OPFResource::GetMetadataXML() const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     return p.get_metadata_xml();
 }
 
@@ -710,9 +678,7 @@ QStringList OPFResource::GetDCMetadataValues(QString text) const
 void OPFResource::SetDCMetadata(const QList<MetaEntry> &metadata)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     // this will not work with refines so it needs to be fixed
     RemoveDCElements(p);
     foreach(MetaEntry book_meta, metadata) {
@@ -727,9 +693,7 @@ void OPFResource::SetDCMetadata(const QList<MetaEntry> &metadata)
 void OPFResource::AddResource(const Resource *resource)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     ManifestEntry me;
     me.m_id = GetUniqueID(GetValidID(resource->Filename()),p);
     me.m_href = Utility::URLEncodePath(GetRelativePathToResource(resource));
@@ -825,9 +789,7 @@ void OPFResource::AddCoverMetaForImage(const Resource *resource, OPFParser &p)
 
 void OPFResource::BulkAddResources(const QList<Resource*>resources) {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(), "application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     foreach(Resource * resource, resources) {
         ManifestEntry me;
         me.m_id = GetUniqueID(GetValidID(resource->Filename()), p);
@@ -852,9 +814,7 @@ void OPFResource::BulkAddResources(const QList<Resource*>resources) {
 void OPFResource::BulkRemoveResources(const QList<Resource *>resources)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     if (p.m_manifest.isEmpty()) return;
 
     foreach(Resource * resource, resources) {
@@ -902,9 +862,7 @@ void OPFResource::BulkRemoveResources(const QList<Resource *>resources)
 void OPFResource::RemoveResource(const Resource *resource)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     if (p.m_manifest.isEmpty()) return;
     QString href = Utility::URLEncodePath(GetRelativePathToResource(resource));
     int pos = p.m_hrefpos.value(href, -1);
@@ -949,9 +907,7 @@ void OPFResource::RemoveResource(const Resource *resource)
 void OPFResource::ClearSemanticCodesInGuide()
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     foreach(GuideEntry ge, p.m_guide) {
         p.m_guide.removeAt(0);
     }
@@ -964,9 +920,7 @@ void OPFResource::AddGuideSemanticCode(HTMLResource *html_resource, QString new_
     //first get primary book language
     QString lang = GetPrimaryBookLanguage();
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QString current_code = GetGuideSemanticCodeForResource(html_resource, p, tgt_id);
 
     if ((current_code != new_code) || !toggle) {
@@ -1044,9 +998,8 @@ QStringList OPFResource::GetAllGuideInfoByBookPath() const
 {
     QStringList guide_info;
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);    
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     if (p.m_guide.isEmpty()) return guide_info;
     for (int i=0; i < p.m_guide.count(); ++i) {
         QString rec;
@@ -1088,9 +1041,7 @@ void OPFResource::RemoveAllGuideReferencesForResource(const Resource *resource,
 void OPFResource::UpdateGuideFragments(QHash<QString,QString> &idupdates)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     for(int c=0; c < p.m_guide.size(); c++) {
         GuideEntry ge = p.m_guide.at(c);
         QString href = ge.m_href;
@@ -1123,9 +1074,7 @@ void OPFResource::UpdateGuideAfterMerge(QList<Resource*> &merged_resources, QHas
         merged_bookpaths << res->GetRelativePath();
     }
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     for(int c=0; c < p.m_guide.size(); c++) {
         GuideEntry ge = p.m_guide.at(c);
         QString href = ge.m_href;
@@ -1177,9 +1126,8 @@ void OPFResource::SetGuideSemanticCodeForResource(QString code, const Resource *
 QString OPFResource::GetGuideSemanticCodeForResource(const Resource *resource, QString tgt_id) const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     return GetGuideSemanticCodeForResource(resource, p, tgt_id);
 }
 
@@ -1194,9 +1142,8 @@ QString OPFResource::GetGuideSemanticNameForResource(Resource *resource, QString
 QHash <QString, QStringList>  OPFResource::GetSemanticCodeForPaths()
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
 
     QHash <QString, QStringList> semantic_codes;
     foreach(GuideEntry ge, p.m_guide) {
@@ -1220,9 +1167,8 @@ QHash <QString, QStringList>  OPFResource::GetSemanticCodeForPaths()
 QHash <QString, QStringList>  OPFResource::GetGuideSemanticNameForPaths()
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
 
     QHash <QString, QStringList> semantic_types;
     foreach(GuideEntry ge, p.m_guide) {
@@ -1258,9 +1204,7 @@ QHash <QString, QStringList>  OPFResource::GetGuideSemanticNameForPaths()
 void OPFResource::SetResourceAsCoverImage(ImageResource *image_resource)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QString resource_id = GetResourceManifestID(image_resource, p);
 
     // First deal with any previous covers by removing 
@@ -1296,9 +1240,7 @@ void OPFResource::UpdateSpineOrder(const QList<::HTMLResource *> html_files)
 {
     // bool contains_nav = html_files.contains(GetNavResource());
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QList<SpineEntry> new_spine;
     foreach(HTMLResource * html_resource, html_files) {
         const Resource *resource = static_cast<const Resource *>(html_resource);
@@ -1328,9 +1270,7 @@ void OPFResource::UpdateSpineOrder(const QList<::HTMLResource *> html_files)
 void OPFResource::ResourceRenamed(const Resource *resource, QString old_full_path)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     // first convert old_full_path to old_bkpath
     QString old_bkpath = old_full_path.right(old_full_path.length() - GetFullPathToBookFolder().length() - 1);
     QString old_href = Utility::URLEncodePath(Utility::buildRelativePath(GetRelativePath(), old_bkpath));
@@ -1386,10 +1326,7 @@ void OPFResource::ResourceRenamed(const Resource *resource, QString old_full_pat
 void OPFResource::ResourceMoved(const Resource *resource, QString old_full_path)
 {
     QWriteLocker locker(&GetLock());
-    // QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    QString source = GetText();
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     // first convert old_full_path to old_bkpath
     QString old_bkpath = old_full_path.right(old_full_path.length() - GetFullPathToBookFolder().length() - 1);
     QString old_href = Utility::URLEncodePath(Utility::buildRelativePath(GetRelativePath(), old_bkpath));
@@ -1415,9 +1352,7 @@ void OPFResource::BulkResourcesMoved(const QHash<QString, Resource *> movedDict)
 {
     QWriteLocker locker(&GetLock());
     QString opf_start_dir = Utility::startingDir(GetRelativePath());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
 
     // a move should not impact the id so leave the old unique manifest id unchanged
     for (int i=0; i < p.m_manifest.count(); ++i) {
@@ -1442,9 +1377,7 @@ void OPFResource::BulkResourcesRenamed(const QHash<QString, Resource *> renamedD
 {
     QWriteLocker locker(&GetLock());
     QString opf_start_dir = Utility::startingDir(GetRelativePath());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
 
     // a rename should not impact the id so leave the old unique manifest id unchanged
     for (int i=0; i < p.m_manifest.count(); ++i) {
@@ -1612,9 +1545,7 @@ QString OPFResource::AddModificationDateMeta()
     datetime = local.toString(Qt::ISODate);
 
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
 
     QString epubversion = GetEpubVersion();
     if (epubversion.startsWith('3')) {
@@ -1736,9 +1667,7 @@ QString OPFResource::GetResourceMimetype(const Resource *resource) const
 void OPFResource::UpdateManifestMediaTypes(const QList<Resource*> resources)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     foreach(Resource* resource, resources) {
         // QString absolute_file_path = resource->GetFullPath();
         // QString extension = QFileInfo(absolute_file_path).suffix().toLower();
@@ -1767,9 +1696,32 @@ void OPFResource::UpdateManifestMediaTypes(const QList<Resource*> resources)
 }
 
 
-void OPFResource::UpdateText(const OPFParser &p)
+// Reparses the OPF only if its text has changed since the model was last built.
+// The returned snapshot is immutable so it may safely outlive later updates.
+QSharedPointer<const OPFParser> OPFResource::GetPackage() const
+{
+    QMutexLocker locker(&m_PackageMutex);
+    quint64 revision = GetTextRevision();
+    if (m_Package.isNull() || (m_PackageRevision != revision)) {
+        QString source = CleanSource::ProcessXML(TextResource::GetText(),"application/oebps-package+xml");
+        OPFParser *p = new OPFParser();
+        p->parse(source);
+        m_Package = QSharedPointer<const OPFParser>(p);
+        m_PackageRevision = revision;
+    }
+    return m_Package;
+}
+
+
+// The text is written right away, as always, and the model it was
+// written from is kept for the new revision so it need not be reparsed.
+void OPFResource::UpdateText(OPFParser &p)
 {
+    p.rebuild_indexes();
     TextResource::SetText(p.convert_to_xml());
+    QMutexLocker locker(&m_PackageMutex);
+    m_Package = QSharedPointer<const OPFParser>(new OPFParser(p));
+    m_PackageRevision = GetTextRevision();
 }
 
 
@@ -1797,9 +1749,7 @@ QString OPFResource::ValidatePackageVersion(const QString& source)
 void OPFResource::UpdateManifestProperties(const QList<Resource*> resources)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     if (p.m_package.m_version != "3.0") {
         return;
     }
@@ -1852,9 +1802,8 @@ QString OPFResource::GetManifestPropertiesForResource(const Resource * resource)
     QString properties;
     if (!resource) return properties;
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     if (!p.m_package.m_version.startsWith("3")) {
         return properties;
     }
@@ -1876,9 +1825,8 @@ QHash <QString, QString>  OPFResource::GetManifestPropertiesForPaths()
         return manifest_properties_all;
     }
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    QSharedPointer<const OPFParser> package = GetPackage();
+    const OPFParser &p = *package;
     foreach(ManifestEntry me, p.m_manifest) {
         QString apath = Utility::URLDecodePath(me.m_href);
         if (me.m_atts.contains("properties")){
@@ -1904,9 +1852,7 @@ void OPFResource::SetNavResource(HTMLResource * nav_resource)
     // but do not overwrite any other existing properties
     if (m_NavResource) { 
         QWriteLocker locker(&GetLock());
-        QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-        OPFParser p;
-        p.parse(source);
+        OPFParser p = *GetPackage();
         QString href = Utility::URLEncodePath(GetRelativePathToResource(m_NavResource));
         int pos = p.m_hrefpos.value(href, -1);
         if ((pos >= 0) && (pos < p.m_manifest.count())) {
@@ -1928,9 +1874,7 @@ void OPFResource::SetNavResource(HTMLResource * nav_resource)
 void OPFResource::SetItemRefLinear(Resource * resource, bool linear)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QString resource_href_path = Utility::URLEncodePath(GetRelativePathToResource(resource));
     int pos = p.m_hrefpos.value(resource_href_path, -1);
     QString item_id = "";
@@ -1968,9 +1912,7 @@ void OPFResource::RebaseManifestIDs()
 void OPFResource::AppendResourceToSpine(const Resource* resource, bool nonlinear)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QString item_id = GetResourceManifestID(resource, p);
     // first remove any instance from the spine if one already exists
     for (int i=0; i < p.m_spine.count(); ++i) {
@@ -1994,9 +1936,7 @@ void OPFResource::AppendResourceToSpine(const Resource* resource, bool nonlinear
 void OPFResource::RemoveResourceFromSpine(const Resource* resource)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = *GetPackage();
     QString item_id = GetResourceManifestID(resource, p);
     if (!item_id.isEmpty()) {
         for (int i=0; i < p.m_spine.count(); ++i) {
@@ -26,6 +26,8 @@
 #define OPFRESOURCE_H
 
 #include <memory>
+#include <QMutex>
+#include <QSharedPointer>
 #include <QStringList>
 #include <QHash>
 #include <QString>
@@ -207,6 +209,12 @@ public slots:
 
 private:
 
+    /**
+     * Returns the parsed package model for the current OPF text.
+     * The OPF is only reparsed when its text has actually changed.
+     */
+    QSharedPointer<const OPFParser> GetPackage() const;
+
     /**
      * Determines if a cover image exists.
      *
@@ -285,7 +293,7 @@ private:
 
     QString GetResourceMimetype(const Resource *resource) const;
 
-    void UpdateText(const OPFParser &p);
+    void UpdateText(OPFParser &p);
 
     QString ValidatePackageVersion(const QString &source);
 
@@ -295,6 +303,13 @@ private:
 
     HTMLResource * m_NavResource;
     bool m_WarnedAboutVersion;
+
+    /**
+     * The parsed package model and the text revision it was built from.
+     */
+    mutable QRecursiveMutex m_PackageMutex;
+    mutable QSharedPointer<const OPFParser> m_Package;
+    mutable quint64 m_PackageRevision;
 };
 
 #endif // OPFRESOURCE_H
@@ -23,6 +23,7 @@
 #include <QtCore/QDir>
 #include <QtCore/QDateTime>
 #include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QString>
 #include <QtCore/QTimer>
 #include <QtWidgets/QFileIconProvider>
@@ -44,6 +45,7 @@ Resource::Resource(const QString &mainfolder, const QString &fullfilepath, QObje
     m_CurrentBookRelPath(""),
     m_EpubVersion("2.0"),
     m_MediaType(""),
+    m_WriteGeneration(1),
     m_ReadWriteLock(QReadWriteLock::Recursive)
 {
 }
@@ -267,6 +269,7 @@ bool Resource::LoadFromDisk()
 
 void Resource::SaveToDisk(bool book_wide_save)
 {
+    m_WriteGeneration.fetchAndAddOrdered(1);
     const QDateTime lastModifiedDate = QFileInfo(m_FullFilePath).lastModified();
 
     if (lastModifiedDate.isValid()) {
@@ -274,8 +277,38 @@ void Resource::SaveToDisk(bool book_wide_save)
     }
 }
 
+bool Resource::HasUnsavedChanges() const
+{
+    return false;
+}
+
+QString Resource::GetFileCRC32() const
+{
+    QFileInfo fileinfo(GetFullPath());
+    const QDateTime lastModifiedDate = fileinfo.lastModified();
+    qint64 modified = lastModifiedDate.isValid() ? lastModifiedDate.toMSecsSinceEpoch() : 0;
+    qint64 size = fileinfo.size();
+    quint64 generation = m_WriteGeneration.loadAcquire();
+    QMutexLocker locker(&m_FileCRC32Mutex);
+
+    if (m_FileCRC32.isEmpty() || (m_FileCRC32Generation != generation) ||
+        (m_FileCRC32Size != size) || (m_FileCRC32Modified != modified)) {
+        m_FileCRC32 = Utility::FileCRC32(fileinfo.filePath());
+        m_FileCRC32Generation = generation;
+        m_FileCRC32Size = size;
+        m_FileCRC32Modified = modified;
+    }
+    return m_FileCRC32;
+}
+
+quint64 Resource::GetWriteGeneration() const
+{
+    return m_WriteGeneration.loadAcquire();
+}
+
 void Resource::FileChangedOnDisk()
 {
+    m_WriteGeneration.fetchAndAddOrdered(1);
     QFileInfo latestFileInfo(m_FullFilePath);
     const QDateTime lastModifiedDate = latestFileInfo.lastModified();
     m_LastWrittenTo = lastModifiedDate.isValid() ? lastModifiedDate.toMSecsSinceEpoch() : 0;
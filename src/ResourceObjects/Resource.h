@@ -24,6 +24,8 @@
 #ifndef RESOURCE_H
 #define RESOURCE_H
 
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QUrl>
@@ -173,6 +175,24 @@ public:
     void SetSavedSize(const size_t info) { m_SavedSize = info; }
     size_t GetSavedSize() { return m_SavedSize; }
 
+    /**
+     * Returns the CRC32 of the resource's file on disk. The file is
+     * only read again when it was written since the last call
+     * (see GetWriteGeneration()) or its size or modification time
+     * no longer match. Safe to call from worker threads.
+     *
+     * @return The CRC32 as 8 hex digits, empty if the file can't be read.
+     */
+    QString GetFileCRC32() const;
+
+    /**
+     * Returns a counter that is bumped every time the resource's
+     * file is written to by Sigil or reported changed on disk.
+     *
+     * @return The current write generation.
+     */
+    quint64 GetWriteGeneration() const;
+
 
     /**
      * Returns a reference to the resource's ReadWriteLock.
@@ -229,6 +249,15 @@ public:
      */
     virtual void SaveToDisk(bool book_wide_save = false);
 
+    /**
+     * Returns true if the resource holds data in memory that has
+     * not yet been written to disk. The default implementation
+     * returns false since the resource data is not cached in memory.
+     *
+     * @return \c true if SaveToDisk() would write something new.
+     */
+    virtual bool HasUnsavedChanges() const;
+
     /**
      * Called by FolderKeeper when files get changed on disk.
      * May trigger a resource internal update if the files were not changed by Sigil.
@@ -354,6 +383,21 @@ private:
 
     size_t m_SavedSize = 0;
 
+    /**
+     * Bumped whenever the file is written to or changed on disk.
+     */
+    QAtomicInteger<quint64> m_WriteGeneration;
+
+    /**
+     * The file checksum cache used by GetFileCRC32(), with the
+     * write generation, size and modification time it was computed at.
+     */
+    mutable QMutex m_FileCRC32Mutex;
+    mutable QString m_FileCRC32;
+    mutable quint64 m_FileCRC32Generation = 0;
+    mutable qint64 m_FileCRC32Size = -1;
+    mutable qint64 m_FileCRC32Modified = -1;
+
     /**
      * The ReadWriteLock guarding access to the resource's data.
      */
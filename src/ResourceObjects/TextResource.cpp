@@ -31,92 +31,188 @@
 #include "ResourceObjects/TextResource.h"
 #include "sigil_exception.h"
 
+// Gives the text the way a QTextDocument hands it back through
+// TextDocument::toText() after a setPlainText(), which is what GetText()
+// always returned when every text went through the document: the line
+// and paragraph breaks ("\r\n", '\r', U+2028, U+2029 and the frame
+// markers U+FDD0/U+FDD1) all become '\n'. Text without any of them is
+// returned as is, sharing its data.
+static QString ToDocumentText(const QString &text)
+{
+    const QChar *begin = text.constData();
+    const QChar *end = begin + text.size();
+    const QChar *uc = begin;
+    for (; uc != end; ++uc) {
+        ushort c = uc->unicode();
+        if ((c == '\r') || (c == 0x2028) || (c == 0x2029) || (c == 0xfdd0) || (c == 0xfdd1)) {
+            break;
+        }
+    }
+    if (uc == end) {
+        return text;
+    }
+
+    QString result;
+    result.reserve(text.size());
+    result.append(begin, uc - begin);
+    for (; uc != end; ++uc) {
+        switch (uc->unicode()) {
+            case '\r':
+                // a "\r\n" pair is a single break
+                if ((uc + 1 != end) && ((uc + 1)->unicode() == '\n')) {
+                    ++uc;
+                }
+                result.append(QLatin1Char('\n'));
+                break;
+            case 0xfdd0:
+            case 0xfdd1:
+            case QChar::ParagraphSeparator:
+            case QChar::LineSeparator:
+                result.append(QLatin1Char('\n'));
+                break;
+            default:
+                result.append(*uc);
+        }
+    }
+    return result;
+}
+
 TextResource::TextResource(const QString &mainfolder, const QString &fullfilepath, QObject *parent)
     :
     Resource(mainfolder, fullfilepath, parent),
-    m_CacheInUse(false),
-    m_TextDocument(new TextDocument(this)),
-    m_IsLoaded(false)
+    m_DocumentEdited(false),
+    m_UpdatePending(false),
+    m_TextDocument(NULL),
+    m_IsLoaded(false),
+    m_TextRevision(0),
+    m_SettingTextInternal(false),
+    m_SavedTextRevision(Q_UINT64_C(0xFFFFFFFFFFFFFFFF))
 {
-    m_TextDocument->setDocumentLayout(new QPlainTextDocumentLayout(m_TextDocument));
-    connect(m_TextDocument, SIGNAL(contentsChanged()), this, SIGNAL(Modified()));
 }
 
 
 QString TextResource::GetText() const
 {
-    QMutexLocker locker(&m_CacheAccessMutex);
+    QMutexLocker locker(&m_TextAccessMutex);
 
-    if (m_CacheInUse) {
-        return m_Cache;
+    if (m_DocumentEdited) {
+        // pick up what was typed into Code View
+        m_Text = m_TextDocument->toText();
+        m_DocumentEdited = false;
     }
 
-    return m_TextDocument->toText();
+    return m_Text;
 }
 
 
 void TextResource::SetText(const QString &text)
 {
-    //   We need to delay updating the QTextDocument if SetText has
-    // been called from something other than the main GUI thread. Why?
+    //   The text is stored right away, but the QTextDocument (if the resource
+    // is open in a tab) can only be updated from the main GUI thread. Why?
     // Because a CodeView is probably connected to the text document,
     // and if we update it from a non-GUI thread, it will notify the
     // CodeView base class to update as well and that will crash us since
     // the base class derives from QWidget (and those can only be updated
     // in the GUI thread).
-    //   So we cache the text update into m_Cache and update the QTextDocument
-    // when we return to the GUI thread. The single-shot timer makes sure
-    // of that.
-    if (QThread::currentThread() == QApplication::instance()->thread()) {
-        SetTextInternal(text);
-    } else {
-        QMutexLocker locker(&m_CacheAccessMutex);
-        m_Cache = text;
+    //   So we delay updating the QTextDocument until we return to the GUI
+    // thread. The single-shot timer makes sure of that.
+    {
+        QString document_text = ToDocumentText(text);
+        QMutexLocker locker(&m_TextAccessMutex);
+        m_Text = document_text;
+        m_DocumentEdited = false;
+        m_IsLoaded = true;
+        m_TextRevision.fetchAndAddOrdered(1);
+    }
 
-        // We want to make sure we schedule only one delayed update
-        if (!m_CacheInUse) {
-            m_CacheInUse = true;
-            QTimer::singleShot(0, this, SLOT(DelayedUpdateToTextDocument()));
+    if (QThread::currentThread() == QApplication::instance()->thread()) {
+        {
+            QMutexLocker locker(&m_TextAccessMutex);
+            m_UpdatePending = true;
         }
+        DelayedUpdateToTextDocument();
+    } else {
+        ScheduleTextDocumentUpdate();
     }
 }
 
 
 TextDocument& TextResource::GetTextDocumentForWriting()
 {
-    Q_ASSERT(m_TextDocument);
+    Q_ASSERT(QThread::currentThread() == QApplication::instance()->thread());
+
+    if (!m_TextDocument) {
+        TextDocument *document = new TextDocument(this);
+        document->setDocumentLayout(new QPlainTextDocumentLayout(document));
+        m_SettingTextInternal = true;
+        document->setPlainText(GetText());
+        m_SettingTextInternal = false;
+        document->setModified(false);
+        connect(document, SIGNAL(contentsChanged()), this, SLOT(TextDocumentContentsChanged()));
+        connect(document, SIGNAL(contentsChanged()), this, SIGNAL(Modified()));
+        QMutexLocker locker(&m_TextAccessMutex);
+        m_TextDocument = document;
+        m_UpdatePending = false;
+    } else {
+        // catch up with text set from another thread
+        DelayedUpdateToTextDocument();
+    }
+
     return *m_TextDocument;
 }
 
 
+void TextResource::ReleaseTextDocument()
+{
+    if (!m_TextDocument) {
+        return;
+    }
+
+    // keep any edits made in Code View
+    GetText();
+
+    TextDocument *document = m_TextDocument;
+    {
+        QMutexLocker locker(&m_TextAccessMutex);
+        m_TextDocument = NULL;
+        m_DocumentEdited = false;
+    }
+    disconnect(document, 0, this, 0);
+    // the editor that showed it may still be going away
+    document->deleteLater();
+}
+
+
 void TextResource::SaveToDisk(bool book_wide_save)
 {
     {
         QWriteLocker locker(&GetLock());
 
-        if (!m_CacheInUse && !m_IsLoaded) {
+        if (!m_IsLoaded) {
             return;
         }
 
+        // grab the revision before the text so a concurrent edit
+        // leaves the resource marked as still having unsaved changes
+        quint64 revision = GetTextRevision();
+
         // We can't perform the document modified check
         // here because that causes problems with epub export
         // when the user has not changed the text file.
         // (some text files have placeholder text on disk)
 
         // But we always want to save the most up to date version
-
-        if (m_CacheInUse) {
-            Utility::WriteUnicodeTextFile(m_Cache, GetFullPath());
-        } else {
-            Utility::WriteUnicodeTextFile(GetText(), GetFullPath());
-        }
+        Utility::WriteUnicodeTextFile(GetText(), GetFullPath());
+        m_SavedTextRevision.storeRelease(revision);
     }
 
     if (!book_wide_save) {
         emit ResourceUpdatedOnDisk();
     }
 
-    m_TextDocument->setModified(false);
+    if (m_TextDocument) {
+        m_TextDocument->setModified(false);
+    }
     Resource::SaveToDisk(book_wide_save);
 }
 
@@ -144,10 +240,14 @@ void TextResource::InitialLoad()
       * it had been opened in a tab first.
       */
     QWriteLocker locker(&GetLock());
-    Q_ASSERT(m_TextDocument);
 
-    if (m_TextDocument->isEmpty() && QFile::exists(GetFullPath())) {
-        SetText(Utility::ReadUnicodeTextFile(GetFullPath()));
+    if (GetText().isEmpty() && QFile::exists(GetFullPath())) {
+        QString text = Utility::ReadUnicodeTextFile(GetFullPath());
+        SetText(text);
+        // a file whose breaks were changed still has to be written back
+        if (GetText() == text) {
+            MarkTextInSyncWithDisk();
+        }
     }
 }
 
@@ -161,15 +261,19 @@ bool TextResource::LoadFromDisk()
 {
     try {
         const QString &text = Utility::ReadUnicodeTextFile(GetFullPath());
-        QMutexLocker locker(&m_CacheAccessMutex);
-        m_Cache = text;
-
-        // We want to make sure we schedule only one delayed update
-        if (!m_CacheInUse) {
-            m_CacheInUse = true;
-            QTimer::singleShot(0, this, SLOT(DelayedUpdateToTextDocument()));
+        QString document_text = ToDocumentText(text);
+        {
+            QMutexLocker locker(&m_TextAccessMutex);
+            m_Text = document_text;
+            m_DocumentEdited = false;
+            m_IsLoaded = true;
+            m_TextRevision.fetchAndAddOrdered(1);
         }
-
+        // a file whose breaks were changed still has to be written back
+        if (document_text == text) {
+            MarkTextInSyncWithDisk();
+        }
+        ScheduleTextDocumentUpdate();
         return true;
     } catch (CannotOpenFile&) {
         // ?
@@ -179,30 +283,81 @@ bool TextResource::LoadFromDisk()
 }
 
 
+void TextResource::ScheduleTextDocumentUpdate()
+{
+    QMutexLocker locker(&m_TextAccessMutex);
+
+    // We want to make sure we schedule only one delayed update
+    if (!m_UpdatePending) {
+        m_UpdatePending = true;
+        QTimer::singleShot(0, this, SLOT(DelayedUpdateToTextDocument()));
+    }
+}
+
+
 void TextResource::DelayedUpdateToTextDocument()
 {
-    QMutexLocker locker(&m_CacheAccessMutex);
+    QString text;
+    {
+        QMutexLocker locker(&m_TextAccessMutex);
 
-    if (!m_CacheInUse) {
-        return;
+        if (!m_UpdatePending) {
+            return;
+        }
+
+        m_UpdatePending = false;
+        text = m_Text;
     }
 
-    SetTextInternal(m_Cache);
+    if (m_TextDocument) {
+        // emits Modified() through the document
+        SetTextInternal(text);
+    } else {
+        emit Modified();
+    }
 }
 
 
 void TextResource::SetTextInternal(const QString &text)
 {
+    // the revision was already bumped when this text was handed to us
+    m_SettingTextInternal = true;
     m_TextDocument->setPlainText(text);
+    m_SettingTextInternal = false;
     m_TextDocument->setModified(false);
-    // Our resource has now been loaded with some text
-    m_IsLoaded = true;
-    m_CacheInUse = false;
-    // Clear anything left in the cache
-    // m_Cache = "";
 }
 
 bool TextResource::IsLoaded()
 {
     return m_IsLoaded;
 }
+
+quint64 TextResource::GetTextRevision() const
+{
+    return m_TextRevision.loadAcquire();
+}
+
+void TextResource::TextDocumentContentsChanged()
+{
+    if (!m_SettingTextInternal) {
+        QMutexLocker locker(&m_TextAccessMutex);
+        m_DocumentEdited = true;
+        m_TextRevision.fetchAndAddOrdered(1);
+    }
+}
+
+bool TextResource::HasUnsavedChanges() const
+{
+    {
+        QMutexLocker locker(&m_TextAccessMutex);
+        if (!m_IsLoaded) {
+            return false;
+        }
+    }
+    return m_SavedTextRevision.loadAcquire() != m_TextRevision.loadAcquire();
+}
+
+void TextResource::MarkTextInSyncWithDisk()
+{
+    m_SavedTextRevision.storeRelease(m_TextRevision.loadAcquire());
+}
@@ -25,6 +25,7 @@
 #define TEXTRESOURCE_H
 
 #include <QtCore/QMutex>
+#include <QtCore/QAtomicInteger>
 #include "Widgets/TextDocument.h"
 #include "ResourceObjects/Resource.h"
 
@@ -34,6 +35,10 @@ class TextDocument;
 /**
  * A parent class for textual resources like CSS and SVG images.
  * Takes care of loading and caching content etc.
+ *
+ * The text itself is kept in a plain implicitly shared QString.
+ * A QTextDocument for it only exists while a tab has the resource
+ * open in Code View.
  */
 class TextResource : public Resource
 {
@@ -51,7 +56,8 @@ public:
     TextResource(const QString &mainfolder, const QString &fullfilepath, QObject *parent = NULL);
 
     /**
-     * Returns the text stored in the resource.
+     * Returns the text stored in the resource. This is a shallow
+     * copy of the stored text unless it was just edited in Code View.
      *
      * @return The resource text.
      */
@@ -64,17 +70,29 @@ public:
 
     /**
      * Returns a reference to the QTextDocument that can be read and written to
-     * in consumers. If you need just read access, use GetTextDocumentForReading().
+     * in consumers. The document is created on first use and kept until
+     * ReleaseTextDocument() is called. Edits made to it become the text
+     * of the resource.
      *
      * @warning Make sure to get a write lock externally before calling this function!
+     * @warning Only call this from the main thread.
      *
-     * @return A reference to the QTextDocument cache.
+     * @return A reference to the QTextDocument.
      */
     TextDocument &GetTextDocumentForWriting();
 
+    /**
+     * Drops the QTextDocument once no tab shows it anymore, after
+     * taking over any edits made to it. Only call this from the main thread.
+     */
+    void ReleaseTextDocument();
+
     // inherited
     void SaveToDisk(bool book_wide_save = false);
 
+    // inherited
+    virtual bool HasUnsavedChanges() const;
+
     /**
      * Loads the text content into the QTextDocument cache if
      * nothing has been loaded so far. This is not done automatically
@@ -84,20 +102,41 @@ public:
 
     bool IsLoaded();
 
+    /**
+     * Returns a counter that is bumped every time the text of the
+     * resource changes, whether through SetText() or by edits made
+     * directly to the QTextDocument. Caches derived from the text
+     * can use it to decide if they are still valid.
+     *
+     * @return The current text revision.
+     */
+    quint64 GetTextRevision() const;
+
     // inherited
     virtual ResourceType Type() const;
 
 protected:
     virtual bool LoadFromDisk();
 
+    /**
+     * Records that the current text is identical to the file on disk,
+     * for instance right after it was read from there.
+     */
+    void MarkTextInSyncWithDisk();
+
 private slots:
 
     /**
      * Performs the delayed update of m_TextDocument with the text
-     * stored in m_Cache.
+     * stored in m_Text.
      */
     void DelayedUpdateToTextDocument();
 
+    /**
+     * Bumps the text revision when the QTextDocument is edited directly.
+     */
+    void TextDocumentContentsChanged();
+
 private:
 
     /**
@@ -107,32 +146,62 @@ private:
      */
     void SetTextInternal(const QString &text);
 
+    /**
+     * Brings m_TextDocument (if any) up to date with m_Text from the
+     * main thread, where Modified() is emitted for the new text.
+     */
+    void ScheduleTextDocumentUpdate();
+
 
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
     ///////////////////////////////
 
     /**
-     * If \c true, then the m_Cache var is holding cached text.
+     * The text of the resource. Out of date only while
+     * m_DocumentEdited is set.
+     */
+    mutable QString m_Text;
+
+    /**
+     * If \c true, m_TextDocument was edited directly since m_Text was last updated.
      */
-    bool m_CacheInUse;
+    mutable bool m_DocumentEdited;
 
     /**
-     * The cached text used when threads are in use. @see SetText() internals.
+     * If \c true, a delayed update of m_TextDocument has been scheduled.
      */
-    QString m_Cache;
+    bool m_UpdatePending;
 
     /**
-     * The access mutex for the cache.
+     * The access mutex for the text.
      */
-    mutable QMutex m_CacheAccessMutex;
+    mutable QMutex m_TextAccessMutex;
 
     /**
-     * The syntax colored cache of the TextResource text content.
+     * The syntax colored copy of the text shown by Code View, NULL when
+     * the resource is not open in a tab.
      */
     TextDocument *m_TextDocument;
 
     bool m_IsLoaded;
+
+    /**
+     * The revision of the text content. @see GetTextRevision().
+     */
+    QAtomicInteger<quint64> m_TextRevision;
+
+    /**
+     * If \c true, the QTextDocument is being filled by SetTextInternal()
+     * and the revision has already been bumped for that text.
+     */
+    bool m_SettingTextInternal;
+
+    /**
+     * The text revision that was last written to or read from disk.
+     */
+    QAtomicInteger<quint64> m_SavedTextRevision;
+
 };
 
 #endif // TEXTRESOURCE_H
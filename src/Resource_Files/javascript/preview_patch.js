@@ -0,0 +1,114 @@
+// Applies the changes computed by DOMDiff to the body of the loaded page.
+// Every target is found and checked against the node names it was computed
+// for before anything is touched, so either the whole patch applies or
+// nothing changes and false is returned (Preview then reloads the page).
+function sigil_patch_document(ops) {
+    var NAMESPACES = {
+        "xml"   : "http://www.w3.org/XML/1998/namespace",
+        "xlink" : "http://www.w3.org/1999/xlink",
+        "epub"  : "http://www.idpf.org/2007/ops"
+    };
+
+    function name_of(node) {
+        return node.nodeType == 1 ? node.localName : node.nodeName;
+    }
+
+    // MathJax replaces each math element it typesets with a container
+    function matches(node, name, whole_node) {
+        if (!node) return false;
+        var found = name_of(node);
+        return found == name || (whole_node && name == "math" && found == "mjx-container");
+    }
+
+    function locate(path, names, whole_node) {
+        var node = document.body;
+        if (!node) return null;
+        for (var i = 0; i < path.length; i++) {
+            node = node.childNodes[path[i]];
+            if (!matches(node, names[i], whole_node && i == path.length - 1)) return null;
+        }
+        return node;
+    }
+
+    function parse(context, xhtml) {
+        var range = document.createRange();
+        range.selectNodeContents(context);
+        return range.createContextualFragment(xhtml);
+    }
+
+    function set_attributes(element, attributes) {
+        var wanted = {};
+        for (var i = 0; i < attributes.length; i++) {
+            wanted[attributes[i][0]] = true;
+        }
+        var current = Array.prototype.slice.call(element.attributes);
+        for (var i = 0; i < current.length; i++) {
+            if (!wanted[current[i].name]) element.removeAttributeNode(current[i]);
+        }
+        for (var i = 0; i < attributes.length; i++) {
+            var name = attributes[i][0];
+            var colon = name.indexOf(":");
+            if (colon == -1) {
+                element.setAttribute(name, attributes[i][1]);
+            } else {
+                element.setAttributeNS(NAMESPACES[name.substring(0, colon)], name, attributes[i][1]);
+            }
+        }
+    }
+
+    var jobs = [];
+    try {
+        for (var i = 0; i < ops.length; i++) {
+            var op = ops[i];
+            var job = { op: op, before: null, fragment: null };
+            job.target = locate(op.path, op.names, op.op == "remove" || op.op == "replace");
+            if (!job.target) return false;
+            if (op.op == "text" && job.target.nodeValue != op.old) return false;
+            if (op.op == "insert") {
+                if (op.before >= 0) {
+                    job.before = job.target.childNodes[op.before];
+                    if (!matches(job.before, op.before_name, false)) return false;
+                }
+                job.fragment = parse(job.target, op.value);
+            }
+            if (op.op == "replace") job.fragment = parse(job.target.parentNode, op.value);
+            jobs.push(job);
+        }
+    } catch (e) {
+        return false;
+    }
+
+    // last to first, so a node an insert goes in front of
+    // is only replaced after the insert is done
+    var parents = [];
+    for (var i = jobs.length - 1; i >= 0; i--) {
+        var job = jobs[i];
+        var target = job.target;
+        if (job.op.op == "insert") parents.push(target);
+        if (job.op.op == "replace" || job.op.op == "remove") parents.push(target.parentNode);
+        switch (job.op.op) {
+            case "text":
+                target.nodeValue = job.op.value;
+                break;
+            case "attributes":
+                set_attributes(target, job.op.attributes);
+                break;
+            case "replace":
+                target.parentNode.replaceChild(job.fragment, target);
+                break;
+            case "remove":
+                target.parentNode.removeChild(target);
+                break;
+            case "insert":
+                target.insertBefore(job.fragment, job.before);
+                break;
+        }
+    }
+
+    // merge the text nodes that ended up next to each other,
+    // the way the parser builds them when the page loads
+    for (var i = 0; i < parents.length; i++) {
+        parents[i].normalize();
+    }
+    return true;
+}
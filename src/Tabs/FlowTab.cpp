@@ -124,6 +124,11 @@ FlowTab::~FlowTab()
         m_wCodeView = 0;
     }
 
+    // nothing shows the text document anymore
+    if (!GetResourceWasDeleted()) {
+        m_HTMLResource->ReleaseTextDocument();
+    }
+
     m_HTMLResource = NULL;
 
 }
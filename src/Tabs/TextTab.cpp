@@ -63,6 +63,10 @@ TextTab::~TextTab()
         delete m_wCodeView;
         m_wCodeView = 0;
     }
+    // nothing shows the text document anymore
+    if (!GetResourceWasDeleted()) {
+        m_TextResource->ReleaseTextDocument();
+    }
 }
 
 void TextTab::UpdateCodeViewBookPath()
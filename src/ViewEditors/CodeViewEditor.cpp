@@ -201,7 +201,9 @@ QSize CodeViewEditor::sizeHint() const
 void CodeViewEditor::CustomSetDocument(TextDocument &ndocument)
 {
     SettingsStore settings;
+    disconnect(document(), SIGNAL(contentsChange(int, int, int)), this, SLOT(TrackTagListEdit(int, int, int)));
     setDocument(&ndocument);
+    connect(&ndocument, SIGNAL(contentsChange(int, int, int)), this, SLOT(TrackTagListEdit(int, int, int)));
     ndocument.setModified(false);
     if (m_Highlighter) {
         m_Highlighter->setDocument(&ndocument);
@@ -217,6 +219,7 @@ void CodeViewEditor::CustomSetDocument(TextDocument &ndocument)
     ResetFont();
     m_isLoadFinished = true;
     m_regen_taglist = true;
+    m_TagList.invalidate();
     if (settings.uiDoubleWidthTextCursor()) setCursorWidth(2);
     emit DocumentSet();
 }
@@ -969,7 +972,7 @@ bool CodeViewEditor::FindNext(const QString &search_regex,
                               bool marked_text,
                               int split_at)
 {
-    SPCRE *spcre = PCRECache::instance().getObject(search_regex);
+    QSharedPointer<SPCRE> spcre = PCRECache::instance().getObject(search_regex);
     SPCRE::MatchInfo match_info;
     QString txt = toPlainText();
     int start_offset = 0;
@@ -1067,7 +1070,7 @@ bool CodeViewEditor::FindNext(const QString &search_regex,
 
 int CodeViewEditor::Count(const QString &search_regex, Searchable::Direction direction, bool wrap, bool marked_text)
 {
-    SPCRE *spcre = PCRECache::instance().getObject(search_regex);
+    QSharedPointer<SPCRE> spcre = PCRECache::instance().getObject(search_regex);
     QString txt= toPlainText();
     int start = 0;
     int end = txt.length();
@@ -1094,7 +1097,7 @@ int CodeViewEditor::Count(const QString &search_regex, Searchable::Direction dir
 
 bool CodeViewEditor::ReplaceSelected(const QString &search_regex, const QString &replacement, Searchable::Direction direction, bool replace_current)
 {
-    SPCRE *spcre = PCRECache::instance().getObject(search_regex);
+    QSharedPointer<SPCRE> spcre = PCRECache::instance().getObject(search_regex);
     int selection_start = textCursor().selectionStart();
     int selection_end = textCursor().selectionEnd();
 
@@ -1186,7 +1189,7 @@ int CodeViewEditor::ReplaceAll(const QString &search_regex,
     }
     int marked_text_length = text.length();
 
-    SPCRE *spcre = PCRECache::instance().getObject(search_regex);
+    QSharedPointer<SPCRE> spcre = PCRECache::instance().getObject(search_regex);
     QList<SPCRE::MatchInfo> match_info = spcre->getEveryMatchInfo(text);
 
     // Run though all match offsets making the replacement in reverse order.
@@ -2363,6 +2366,11 @@ void CodeViewEditor::EmitFilteredCursorMoved()
     }
 }
 
+void CodeViewEditor::TrackTagListEdit(int position, int chars_removed, int chars_added)
+{
+    m_TagList.noteEdit(position, chars_removed, chars_added);
+}
+
 void CodeViewEditor::TextChangedFilter()
 {
     m_regen_taglist = true;
@@ -2446,7 +2454,7 @@ void CodeViewEditor::MaybeRegenerateTagList()
     
     if (m_regen_taglist) {
         // qDebug() << "regenerating tag list";
-        m_TagList.reloadLister(toPlainText());
+        m_TagList.updateLister(toPlainText());
         m_regen_taglist = false;
     }
 }
@@ -2456,8 +2464,6 @@ void CodeViewEditor::HighlightCurrentLine(bool highlight_tags)
 {
     QList<QTextEdit::ExtraSelection> extraSelections;
 
-    SettingsStore settings;
-
     // Draw the full width line color.
     QTextEdit::ExtraSelection selection_line;
     if (hasFocus()) {
@@ -2470,7 +2476,7 @@ void CodeViewEditor::HighlightCurrentLine(bool highlight_tags)
     selection_line.cursor.clearSelection();
     extraSelections.append(selection_line);
 
-    if (highlight_tags && settings.highlightOpenCloseTags()) {
+    if (highlight_tags && SettingsStore::snapshot()->highlightOpenCloseTags) {
 
         // If and only if cursor is inside a tag, highlight open and matching close
         // current cursor position is just before this char at position pos in text
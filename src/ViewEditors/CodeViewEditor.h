@@ -543,6 +543,12 @@ private slots:
      */
     void TextChangedFilter();
 
+    /**
+     * Records the region changed by an edit so the tag list
+     * only needs to be regenerated for that region.
+     */
+    void TrackTagListEdit(int position, int chars_removed, int chars_added);
+
     void PasteClipEntryFromName(const QString &name);
 
     /**
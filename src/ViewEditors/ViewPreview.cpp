@@ -104,6 +104,7 @@ ViewPreview::ViewPreview(QWidget *parent, bool setbackground)
       c_jQuery(Utility::ReadUnicodeTextFile(":/javascript/jquery-3.6.4.min.js")),
       c_jQueryScrollTo(Utility::ReadUnicodeTextFile(":/javascript/jquery.scrollTo-2.1.2-min.js")),
       c_GetCaretLocation(Utility::ReadUnicodeTextFile(":/javascript/book_view_current_location.js")),
+      c_PatchDocument(Utility::ReadUnicodeTextFile(":/javascript/preview_patch.js")),
       m_CaretLocationUpdate(QString()),
       m_CustomSetDocumentInProgress(false),
       m_pendingScrollToFragment(QString()),
@@ -572,11 +573,39 @@ void ViewPreview::ContinueCustomLoadAfterClear()
         m_using_cache_clear = false;
     }
 
+    page()->load(SaveInPreviewCache(m_xhtml_path, m_xhtml_to_load));
+}
+
+
+bool ViewPreview::PatchDocument(const QString &path, const QString &html, const QString &patch)
+{
+    if (!m_isLoadFinished || m_CustomSetDocumentInProgress) {
+        return false;
+    }
+
+    // the page must still be showing this document
+    if ((url().scheme() != "sigil") || (url().path() != QUrl::fromLocalFile(path).path())) {
+        return false;
+    }
+
+    DBG qDebug() << "PatchDocument: " << patch.length();
+    if (!EvaluateJavascript(c_PatchDocument + "sigil_patch_document(" + patch + ");").toBool()) {
+        return false;
+    }
+
+    // so a reload shows the patched page
+    SaveInPreviewCache(path, html);
+    return true;
+}
+
+
+QUrl ViewPreview::SaveInPreviewCache(const QString &path, const QString &html)
+{
     // Sigil may explode if there is no xmlns
     // on the <html> element. So we will silently add it if needed to ensure
     // no errors occur, to allow loading of html documents created outside of
     // Sigil as well as catering for section splits etc.
-    QString replaced_html = m_xhtml_to_load;
+    QString replaced_html = html;
     replaced_html = replaced_html.replace("<html>", "<html xmlns=\"http://www.w3.org/1999/xhtml\">");
 
     // Because of Chrome's silly 2MB url (GURL) size limit, we must create our own
@@ -591,12 +620,12 @@ void ViewPreview::ContinueCustomLoadAfterClear()
     // this exact xhtml, so store it in an application level cache so that
     // our sigil URLSchemeHandler can find it. 
     MainApplication *mainApplication = qobject_cast<MainApplication *>(qApp);
-    QUrl tgturl = QUrl::fromLocalFile(m_xhtml_path);
+    QUrl tgturl = QUrl::fromLocalFile(path);
     tgturl.setScheme("sigil");
     tgturl.setHost("");
     QString key = tgturl.toString();
     mainApplication->saveInPreviewCache(key, replaced_html);
-    page()->load(tgturl);
+    return tgturl;
 }
 
 
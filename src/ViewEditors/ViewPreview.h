@@ -51,6 +51,17 @@ public:
 
     void CustomSetDocument(const QString &path, const QString &html, bool clear_the_cache = false);
 
+    /**
+     * Applies a DOMDiff patch to the loaded page in place of loading html.
+     *
+     * @param path The path of the document the page must be showing.
+     * @param html The xhtml the page matches once patched.
+     * @param patch The patch as JSON.
+     * @return \c false if nothing was changed because the page is not
+     *         in the state the patch expects; load html instead.
+     */
+    bool PatchDocument(const QString &path, const QString &html, const QString &patch);
+
     bool IsLoadingFinished();
 
     QString GetHoverUrl();
@@ -203,6 +214,13 @@ private:
      */
     void ConnectSignalsToSlots();
 
+    /**
+     * Stores the xhtml where our URLSchemeHandler serves it from.
+     *
+     * @return The url to load it with.
+     */
+    QUrl SaveInPreviewCache(const QString &path, const QString &html);
+
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
     ///////////////////////////////
@@ -229,6 +247,12 @@ private:
      */
     const QString c_GetCaretLocation;
 
+    /**
+     * The JavaScript source code that
+     * applies DOMDiff patches to the page.
+     */
+    const QString c_PatchDocument;
+
     /**
      * Stores the JavaScript source code for the
      * caret location update.
@@ -59,6 +59,7 @@
 #include "Misc/WebProfileMgr.h"
 #include "Misc/CodepointNames.h"
 #include "Misc/PrettyPrintProps.h"
+#include "Parsers/GumboArena.h"
 #include "Widgets/CaretStyle.h"
 #include "sigil_constants.h"
 #include "sigil_exception.h"
@@ -363,6 +364,8 @@ void set_env_vars_if_needed(const QString& env_path)
 // Application entry point
 int main(int argc, char *argv[])
 {
+    // before anything can parse, gumbo's memory all has to come from here
+    GumboArena::InstallAllocator();
 
 #ifndef QT_DEBUG
     qInstallMessageHandler(MessageHandler);
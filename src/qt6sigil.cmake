@@ -62,6 +62,12 @@ if ( NOT DEFINED DISABLE_UPDATE_CHECK )
     set ( DISABLE_UPDATE_CHECK 0 )
 endif()
 
+# use -DBUILD_BENCHMARKS=1 to also build sigil-benchmarks, a developer tool
+# that times some of the hot paths against the code they replaced.
+if ( NOT DEFINED BUILD_BENCHMARKS )
+    set ( BUILD_BENCHMARKS 0 )
+endif()
+
 set( RAW_SOURCES ${MAIN_FILES} ${TAB_FILES} ${SOURCEUPDATE_FILES} ${BOOK_MANIPULATION_FILES} ${RESOURCE_OBJECT_FILES} ${DIALOG_FILES} ${WIDGET_FILES} ${EXPORTER_FILES} ${IMPORTER_FILES} ${MISC_FILES} ${MISC_EDITORS_FILES} ${QUERY_FILES} ${PARSERS_FILES} ${EMBEDPYTHON_FILES} ${SPCRE_FILES} ${VIEW_EDITOR_FILES} ${MAINUI_FILES} )
 
 #############################################################################
@@ -215,6 +221,22 @@ endif()
 
 target_link_libraries( ${PROJECT_NAME} ${LIBS_TO_LINK} )
 
+# The benchmarks are built from the same sources, just with their own main()
+if ( BUILD_BENCHMARKS )
+    set( BENCHMARK_FILES
+        Benchmarks/Benchmarks.h
+        Benchmarks/BenchmarkMain.cpp
+        Benchmarks/ReplaceBenchmark.cpp
+        Benchmarks/ExportBenchmark.cpp
+        Benchmarks/ArenaBenchmark.cpp
+        )
+    set( BENCHMARK_SOURCES ${ALL_SOURCES} )
+    list( REMOVE_ITEM BENCHMARK_SOURCES main.cpp )
+    source_group( "Benchmarks" FILES ${BENCHMARK_FILES} )
+    add_executable( sigil-benchmarks ${BENCHMARK_SOURCES} ${BENCHMARK_FILES} )
+    target_link_libraries( sigil-benchmarks ${LIBS_TO_LINK} )
+endif()
+
 #############################################################################
 
 # needed for correct static header inclusion